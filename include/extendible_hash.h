@@ -0,0 +1,86 @@
+#ifndef EXTENDIBLE_HASH_H
+#define EXTENDIBLE_HASH_H
+
+#define EXTENDIBLE_HASH_API
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "hash_table.h"
+
+#define EXTENDIBLE_HASH_DEFAULT_SEGMENT_SLOTS (1024u)
+#define EXTENDIBLE_HASH_MIN_SEGMENT_SLOTS     (16u)
+
+// live entries plus tombstones a segment takes before it splits (or is
+// rebuilt when most of it is tombstones)
+#define EXTENDIBLE_HASH_MAX_LOAD_FACTOR (0.75)
+
+// the directory never goes past 2^EXTENDIBLE_HASH_MAX_DEPTH entries
+#define EXTENDIBLE_HASH_MAX_DEPTH (40u)
+
+typedef struct extendible_hash_struct extendible_hash;
+typedef struct extendible_hash_snapshot_struct extendible_hash_snapshot;
+
+typedef struct extendible_hash_stats_struct
+{
+	size_t size;
+	size_t segments;        // live segments, plus one spare once a split happened
+	uint8_t global_depth;
+	size_t bytes;           // directory and segments, values not included
+	size_t copied_segments; // segments copied on write because a snapshot shared them
+} extendible_hash_stats;
+
+// Extendible hashing: a directory of 2^global_depth pointers, indexed by
+// the top bits of a mix of the key, to fixed-size open-addressed segments
+// probed with hash_fn and the usual HASH_PROBING_METHOD_* (double hashing
+// drops hash_utils' tetrahedral term, so every probe sequence covers a
+// power-of-two segment). A full
+// segment splits in two on its next directory bit and nothing else moves;
+// the directory only doubles when that segment was already as deep as it.
+// Growing allocates one segment (and sometimes the pointer array), never
+// a second copy of the table. Values are copied in like in hash_table.
+// The table is not thread safe, snapshots are (see below).
+EXTENDIBLE_HASH_API
+extendible_hash* extendible_hash_create(size_t segment_slots, hash_function_t hash_fn,
+										uint8_t prob_method);
+
+// false when out of memory or at the deepest directory, the table then
+// still holds everything it held before
+EXTENDIBLE_HASH_API
+bool extendible_hash_insert(ssize_t key, const void* value, size_t value_size,
+							extendible_hash* table);
+
+EXTENDIBLE_HASH_API
+void* extendible_hash_get(ssize_t key, extendible_hash* table);
+
+EXTENDIBLE_HASH_API
+bool extendible_hash_remove(ssize_t key, extendible_hash* table);
+
+EXTENDIBLE_HASH_API
+size_t extendible_hash_size(const extendible_hash* table);
+
+EXTENDIBLE_HASH_API
+extendible_hash_stats extendible_hash_get_stats(const extendible_hash* table);
+
+EXTENDIBLE_HASH_API
+void extendible_hash_release(extendible_hash** pptable);
+
+// Point-in-time, read-only view of the table in O(1): the snapshot shares
+// the directory, segments and values. The table copies the directory on
+// its next write and a segment on the first write to it, values are never
+// written in place, so a snapshot sees no change and needs no lock; it can
+// be read and released from any thread while the table goes on.
+// Snapshots must be taken from the thread that writes the table.
+EXTENDIBLE_HASH_API
+extendible_hash_snapshot* extendible_hash_snapshot_create(const extendible_hash* table);
+
+EXTENDIBLE_HASH_API
+const void* extendible_hash_snapshot_get(ssize_t key, const extendible_hash_snapshot* snapshot);
+
+EXTENDIBLE_HASH_API
+size_t extendible_hash_snapshot_size(const extendible_hash_snapshot* snapshot);
+
+EXTENDIBLE_HASH_API
+void extendible_hash_snapshot_release(extendible_hash_snapshot** ppsnapshot);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef EXTERNAL_SORT_H
+#define EXTERNAL_SORT_H
+
+#define EXTERNAL_SORT_API
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "heap_utils.h"
+
+#define EXTERNAL_SORT_DEFAULT_MEMORY_BUDGET  ((size_t) 256u << 20)
+#define EXTERNAL_SORT_DEFAULT_IO_BUFFER_SIZE ((size_t) 4u << 20)
+#define EXTERNAL_SORT_DEFAULT_TEMP_DIR       "."
+
+// longest temp file path that will be generated
+#define EXTERNAL_SORT_MAX_PATH (4096u)
+
+typedef struct external_sort_config_struct
+{
+	size_t memory_budget;  // bytes for the in-memory runs and the merge buffers
+	size_t io_buffer_size; // stdio buffer of every file opened by the sort
+	const char* temp_dir;  // where the sorted runs are spilled
+} external_sort_config;
+
+// Sorts a file of fixed-size records (elem_size bytes each) into
+// output_path, never holding more than memory_budget bytes of records.
+// Runs of memory_budget bytes are sorted with intro_sort and spilled to
+// temp_dir, then combined by kway_merge; when there are more
+// runs than buffers fit in the budget, the merge takes several passes.
+// config may be NULL (or have zero fields) to use the defaults.
+EXTERNAL_SORT_API
+bool external_sort(const char* input_path, const char* output_path,
+				   size_t elem_size, comparator cmp,
+				   const external_sort_config* config);
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef HASH_AGGREGATE_H
+#define HASH_AGGREGATE_H
+
+#define HASH_AGGREGATE_API
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "hash_table.h"
+
+// rows hashed, prefetched and then aggregated together
+#define HASH_AGGREGATE_BATCH_SIZE (64u)
+
+#define HASH_AGGREGATE_MAX_LOAD_FACTOR (0.5)
+
+// below this many rows hash_aggregate_parallel stays on the calling thread
+#define HASH_AGGREGATE_DEFAULT_CUTOFF ((size_t) 1u << 16)
+
+// every aggregate of a group, stored inline in the table slot
+typedef struct hash_aggregate_group_struct
+{
+	int64_t key;
+	int64_t sum; // wraps around on overflow
+	int64_t min;
+	int64_t max;
+	uint64_t count; // 0 = free slot
+} hash_aggregate_group;
+
+typedef struct hash_aggregate_partition_struct
+{
+	hash_aggregate_group* slots;
+	size_t size;
+	size_t capacity; // power of two
+} hash_aggregate_partition;
+
+// Open-addressed group-by table split into partitions by the top bits of
+// a mix of the key; within a partition the slot comes from hash_fptr and
+// the usual HASH_PROBING_METHOD_*. Partitions grow on their own.
+typedef struct hash_aggregate_struct
+{
+	hash_aggregate_partition* partitions;
+	size_t npartitions; // power of two
+	uint8_t partition_bits;
+	hash_function_t hash_fptr;
+	hash_prob_method_t hash_prob_method;
+} hash_aggregate;
+
+typedef struct hash_aggregate_config_struct
+{
+	size_t nthreads;    // 0 = number of online cores
+	size_t cutoff;      // 0 = HASH_AGGREGATE_DEFAULT_CUTOFF
+	size_t npartitions; // 0 = a few per thread
+} hash_aggregate_config;
+
+HASH_AGGREGATE_API
+hash_aggregate* hash_aggregate_create(size_t expected_groups, size_t npartitions,
+									  hash_function_t hash_fn, uint8_t prob_method);
+
+// Adds n rows: COUNT, SUM, MIN and MAX of values[i] grouped by keys[i].
+// Keys are hashed a batch at a time and their slots prefetched before the
+// groups are found or inserted. values may be NULL to only count, then
+// sum, min and max stay 0.
+HASH_AGGREGATE_API
+bool hash_aggregate_update(const int64_t* keys, const int64_t* values, size_t n,
+						   hash_aggregate* aggregate);
+
+// folds every group of from into into, the partition counts may differ
+HASH_AGGREGATE_API
+bool hash_aggregate_merge(const hash_aggregate* from, hash_aggregate* into);
+
+HASH_AGGREGATE_API
+const hash_aggregate_group* hash_aggregate_find(int64_t key, const hash_aggregate* aggregate);
+
+HASH_AGGREGATE_API
+size_t hash_aggregate_size(const hash_aggregate* aggregate);
+
+// copies the groups, in no particular order, to out (hash_aggregate_size
+// elements), returns how many were written
+HASH_AGGREGATE_API
+size_t hash_aggregate_export(const hash_aggregate* aggregate, hash_aggregate_group* out);
+
+// Multi-threaded hash_aggregate_update of n rows into a new table: every
+// thread aggregates a range of rows into its own partitioned table, then
+// each partition is merged across threads by one thread. The groups do
+// not depend on the thread count. config may be NULL to use the defaults.
+HASH_AGGREGATE_API
+hash_aggregate* hash_aggregate_parallel(const int64_t* keys, const int64_t* values, size_t n,
+										hash_function_t hash_fn, uint8_t prob_method,
+										const hash_aggregate_config* config);
+
+HASH_AGGREGATE_API
+void hash_aggregate_release(hash_aggregate** ppaggregate);
+
+#endif
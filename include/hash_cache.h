@@ -0,0 +1,62 @@
+#ifndef HASH_CACHE_H
+#define HASH_CACHE_H
+
+#define HASH_CACHE_API
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "hash_table.h"
+
+// slots per cached entry: live entries never pass half of the table, the
+// rest is room for the tombstones eviction leaves behind
+#define HASH_CACHE_SLOTS_PER_ENTRY (2u)
+#define HASH_CACHE_MAX_LOAD_FACTOR (0.75)
+
+typedef struct hash_cache_struct
+{
+	hash_table* table;
+	size_t max_entries;
+	size_t value_size;
+	size_t hand;      // CLOCK hand, a slot index
+	size_t evictions;
+} hash_cache;
+
+// what put pushed out; value is the caller's to free
+typedef struct hash_cache_eviction_struct
+{
+	ssize_t key;
+	void* value;
+	bool evicted;
+} hash_cache_eviction;
+
+// Bounded lookup cache: a hash_table that never grows past max_entries,
+// evicting with CLOCK. Every slot carries a reference bit that a hit sets;
+// on a full insert the hand sweeps the slots, clearing set bits and
+// evicting the first entry whose bit is clear. A hit is a hash_table_get
+// plus one byte store, there are no lists to maintain.
+HASH_CACHE_API
+hash_cache* hash_cache_create(size_t max_entries, size_t value_size,
+							  hash_function_t hash_fn, uint8_t prob_method);
+
+// the cached value (value_size bytes) or NULL, marks the entry referenced
+HASH_CACHE_API
+void* hash_cache_get(ssize_t key, hash_cache* cache);
+
+// inserts or replaces key; when the cache is full and key is new, one
+// entry is evicted first and reported in evicted (may be NULL, then its
+// value is freed)
+HASH_CACHE_API
+bool hash_cache_put(ssize_t key, const void* value, hash_cache* cache,
+					hash_cache_eviction* evicted);
+
+HASH_CACHE_API
+bool hash_cache_remove(ssize_t key, hash_cache* cache);
+
+HASH_CACHE_API
+size_t hash_cache_size(const hash_cache* cache);
+
+HASH_CACHE_API
+void hash_cache_release(hash_cache** ppcache);
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef HASH_JOIN_H
+#define HASH_JOIN_H
+
+#define HASH_JOIN_API
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "hash_table.h"
+
+// target size of one partition's table, about half of a common L2
+#define HASH_JOIN_DEFAULT_PARTITION_BYTES ((size_t) 256u << 10)
+
+// partitions of one pass, more than this cost TLB misses on the scatter.
+// A partition still over twice partition_bytes is split once more (up to
+// as many pieces again), so partitions stay cache-sized up to about
+// 2^24 * partition_bytes of build side; only duplicated keys can keep a
+// piece bigger.
+#define HASH_JOIN_MAX_RADIX_BITS (12u)
+
+// probe rows hashed and prefetched together
+#define HASH_JOIN_BATCH_SIZE (32u)
+
+// below this many rows (both sides) the join stays on the calling thread
+#define HASH_JOIN_DEFAULT_CUTOFF ((size_t) 1u << 16)
+
+typedef struct hash_join_pair_struct
+{
+	size_t build; // row of build_keys
+	size_t probe; // row of probe_keys
+} hash_join_pair;
+
+typedef struct hash_join_config_struct
+{
+	size_t nthreads;        // 0 = number of online cores
+	size_t cutoff;          // 0 = HASH_JOIN_DEFAULT_CUTOFF
+	size_t partition_bytes; // 0 = HASH_JOIN_DEFAULT_PARTITION_BYTES
+} hash_join_config;
+
+// Equi-join of two key columns: emits a pair for every build row and
+// probe row with the same key (duplicates on both sides included), in no
+// particular order, into out. Both sides are radix partitioned on a mix
+// of the key so every partition's build rows fit in a small open-addressed
+// table (hash_fn and a HASH_PROBING_METHOD_*), then the partitions are
+// built and probed in batches by all threads. The first pass is parallel,
+// an oversized partition is split again by the thread that takes it.
+// *nmatches receives the number of matches; when that is over
+// out_capacity only out_capacity of them are written and false returned,
+// as on allocation failure. config may be NULL to use the defaults.
+HASH_JOIN_API
+bool hash_join(const int64_t* build_keys, size_t nbuild,
+			   const int64_t* probe_keys, size_t nprobe,
+			   hash_join_pair* out, size_t out_capacity, size_t* nmatches,
+			   hash_function_t hash_fn, uint8_t prob_method,
+			   const hash_join_config* config);
+
+#endif
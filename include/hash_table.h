@@ -12,6 +12,15 @@
 #define HASH_TABLE_MIN_LOAD_FACTOR  (0.125)
 #define HASH_TABLE_CAPACITY_FACTOR  (0x2)
 
+// Probe counting is for the benchmarks: it stores to the table on every
+// lookup, which slows the hot path and makes concurrent gets race. Build
+// hash_table.c with HASH_TABLE_COUNT_PROBES defined to fill nprobes.
+#ifdef HASH_TABLE_COUNT_PROBES
+#define HASH_TABLE_PROBE(table) (++(table)->nprobes)
+#else
+#define HASH_TABLE_PROBE(table) ((void) 0)
+#endif
+
 #define HASH_PROBING_METHOD_LINEAR 	  		(0x00000001)
 #define HASH_PROBING_METHOD_QUADRATIC 		(0x00000002)
 #define HASH_PROBING_METHOD_DOUBLE_HASHING  (0x00000003)
@@ -25,13 +34,17 @@ typedef struct hash_entry_struct
 	ssize_t key;
 	void* value;
 	uint8_t status;
+	uint8_t referenced; // CLOCK bit of hash_cache, fits in the padding
 } hash_entry;
 
 typedef struct hash_table_struct
 {
 	hash_entry* data;
 	size_t size;
+	size_t deleted; // tombstones, they lengthen probe chains until a rehash
 	size_t capacity;
+	size_t nprobes; // slots inspected by insert and search, see HASH_TABLE_COUNT_PROBES
+	double max_load_factor;
 	hash_function_t hash_fptr;
 	hash_prob_method_t hash_prob_method;
 } hash_table;
@@ -92,10 +105,18 @@ void* HASH_TABLE_API hash_table_get(ssize_t key, hash_table* htable_ptr);
 
 bool HASH_TABLE_API hash_table_remove(ssize_t key, hash_table* htable_ptr);
 
+// removes the occupied entry returned by hash_table_search, saving the
+// second lookup of hash_table_remove
+void HASH_TABLE_API hash_table_erase(hash_table* htable_ptr, hash_entry* bucket);
+
 void HASH_TABLE_API hash_table_release(hash_table** pphtable);
 
 double HASH_TABLE_API hash_table_load_factor(hash_table* htable_ptr);
 
+// load factor past which insert grows the table (HASH_TABLE_MAX_LOAD_FACTOR
+// by default), must be in (0, 1)
+bool HASH_TABLE_API hash_table_set_max_load_factor(hash_table* htable_ptr, double max_load_factor);
+
 bool HASH_TABLE_API hash_table_shrink(hash_table** pphtable, size_t value_size,
 					  				  size_t* ncollisions_ptr, double min_load_factor);
 
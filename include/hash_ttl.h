@@ -0,0 +1,68 @@
+#ifndef HASH_TTL_H
+#define HASH_TTL_H
+
+#define HASH_TTL_API
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "hash_table.h"
+#include "scoped_heap.h"
+
+// deadline of entries that never expire
+#define HASH_TTL_NEVER (UINT64_MAX)
+
+typedef struct hash_ttl_struct
+{
+	hash_table* table;   // values are a hash_ttl_record followed by the value
+	scoped_heap* timers; // (deadline, key), earliest deadline on top
+	size_t value_size;
+	uint8_t* scratch;    // record being inserted
+} hash_ttl;
+
+// header of every value in the table, the value starts right after it
+typedef struct hash_ttl_record_struct
+{
+	uint64_t deadline;
+	scoped_heap_handle timer; // SCOPED_HEAP_INVALID_HANDLE when it never expires
+} hash_ttl_record;
+
+// Key-value store whose entries may carry a deadline. Deadlines are kept
+// in a scoped_heap next to the hash_table, every entry holding the
+// handle of its timer, so changing or dropping a deadline is O(log n).
+// Time is whatever unit the caller uses; an entry is expired once now
+// reaches its deadline.
+HASH_TTL_API
+hash_ttl* hash_ttl_create(size_t nelems, size_t value_size,
+						  hash_function_t hash_fn, uint8_t prob_method);
+
+// inserts or replaces key, deadline HASH_TTL_NEVER for no expiry
+HASH_TTL_API
+bool hash_ttl_put(ssize_t key, const void* value, uint64_t deadline, hash_ttl* ttl);
+
+// the value, or NULL when missing or expired at now (an expired entry is
+// removed on the spot)
+HASH_TTL_API
+void* hash_ttl_get(ssize_t key, uint64_t now, hash_ttl* ttl);
+
+// moves the deadline of an entry live at now, HASH_TTL_NEVER makes it
+// permanent. An entry already expired at now is removed as hash_ttl_get
+// does and false is returned, so an expired value is never revived.
+HASH_TTL_API
+bool hash_ttl_set_deadline(ssize_t key, uint64_t deadline, uint64_t now, hash_ttl* ttl);
+
+HASH_TTL_API
+bool hash_ttl_remove(ssize_t key, hash_ttl* ttl);
+
+// removes every entry whose deadline is <= now and returns how many, in
+// O(k log n) for k expired entries: only the timers that fire are touched
+HASH_TTL_API
+size_t hash_ttl_expire_until(uint64_t now, hash_ttl* ttl);
+
+HASH_TTL_API
+size_t hash_ttl_size(const hash_ttl* ttl);
+
+HASH_TTL_API
+void hash_ttl_release(hash_ttl** ppttl);
+
+#endif
@@ -69,8 +69,9 @@ static inline size_t hash_by_fold(ssize_t key, size_t m)
     size_t group_size = get_digit_count(m, 10u);
     size_t group_sum = 0;
 
-    static char key_str[32] = {0};
-    static char group[32] = {0};
+    // locals: static buffers kept digits of earlier calls past the group
+    char key_str[32] = {0};
+    char group[32] = {0};
 
     size_t key_str_len = (sizeof(key_str) / sizeof(*key_str)) - 1u;
 	size_t index = 0;
@@ -82,6 +83,7 @@ static inline size_t hash_by_fold(ssize_t key, size_t m)
         if (index + group_size <= key_str_len)
         {
             strncpy(group, key_str + index, group_size);
+            group[group_size] = '\0';
             group_sum += strtoull(group, NULL, 10);
         }
     }
@@ -91,6 +93,7 @@ static inline size_t hash_by_fold(ssize_t key, size_t m)
         size_t offset = (index - group_size);
         size_t size = key_str_len - offset;
         strncpy(group, key_str + offset, size);
+        group[size] = '\0';
         group_sum += strtoull(group, NULL, 10);
     }
 
@@ -101,7 +104,10 @@ static inline size_t hash_by_mul(ssize_t key, size_t m)
 {
 	double value = (key & HASH_SSIZE_MAX) * HASH_MAGIC_NUMBER;
 	value -= (ssize_t) value;
-	return (size_t) ceil(m * value);
+
+	// floor(m * frac(k * A)), ceil could give m itself
+	size_t index = (size_t)(m * value);
+	return index < m ? index : m - 1u;
 }
 
 // https://en.wikipedia.org/wiki/Fowler%E2%80%93Noll%E2%80%93Vo_hash_function
@@ -141,13 +147,11 @@ static inline size_t hash_prob_method_quadratic(ssize_t key, size_t k,
 {
 	key &= HASH_SSIZE_MAX;
 
-	const double c1 = 0.5;
-	const double c2 = 0.5;
-
-	const size_t x1 = (size_t)(c1 * k);
-	const size_t x2 = (size_t)(c2 * (k * k));
+	// c1 = c2 = 1/2 gives the triangular numbers k(k + 1)/2, which visit
+	// every slot of a power-of-two table; rounding both halves down did not
+	const size_t x = (k * (k + 1u)) >> 1;
 
-	return (h(key, m) + x1 + x2) % m;
+	return (h(key, m) + x) % m;
 }
 
 static inline size_t hash_prob_method_double_hashing(ssize_t key, size_t k,
@@ -188,12 +192,12 @@ digit_deviation_pair* prehash_by_digit_analisys(size_t ndigits, uint32_t* keyset
 		uint32_t number = *beg;
 
 		size_t number_digit_count = get_digit_count(number, 10u);
-		snprintf(digit_str, sizeof(digit_str), "%hhu", number);
+		snprintf(digit_str, sizeof(digit_str), "%lu", (unsigned long) number);
 
 		for (size_t digit_index = 0; digit_index != number_digit_count; ++digit_index)
 		{
 			uint8_t kdigit = digit_str[digit_index] - '0';
-			++digits[digit_index][kdigit - 1];
+			++digits[digit_index][kdigit];
 		}
 	}
 
@@ -209,8 +213,19 @@ digit_deviation_pair* prehash_by_digit_analisys(size_t ndigits, uint32_t* keyset
 		ddp[i].digit = i;
 	}
 
-	// sort deviation table in increasing order of deviation
-	heap_sort(ddp, ddp + HASH_MAX_DIGIT_RANGE, sizeof(digit_deviation_pair), digit_deviation_pair_comparison);
+	// sort deviation table in increasing order of deviation, the table is
+	// tiny and fixed-size so a sorting network does it without any calls
+	size_t npairs = 0u;
+	const uint8_t* pairs = sort_network_pairs(HASH_MAX_DIGIT_RANGE, &npairs);
+
+	for (size_t p = 0; p < npairs; ++p)
+	{
+		digit_deviation_pair a = ddp[pairs[2 * p]];
+		digit_deviation_pair b = ddp[pairs[2 * p + 1]];
+		bool swap = b.deviation < a.deviation;
+		ddp[pairs[2 * p]] = swap ? b : a;
+		ddp[pairs[2 * p + 1]] = swap ? a : b;
+	}
 
 	return memdup(ddp, sizeof(digit_deviation_pair) * HASH_MAX_DIGIT_RANGE);
 }
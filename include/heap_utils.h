@@ -47,7 +47,7 @@ static HEAP_API void heap_upper(void* begin, void* end,
 
 	while (index && cmp(first, second, elem_size))
 	{
-		iter_swap(first, second, elem_size);
+		iter_swap_inplace(first, second, elem_size);
 
 		index = index_parent;
 		index_parent = heap_parent(index);
@@ -92,8 +92,8 @@ static HEAP_API void heap_down(void* begin, void* end,
 		if (largest == index)
 			break;
 
-		iter_swap((uint8_t *)begin + (index * elem_size),
-				 (uint8_t *)begin + (largest * elem_size), elem_size);
+		iter_swap_inplace((uint8_t *)begin + (index * elem_size),
+						  (uint8_t *)begin + (largest * elem_size), elem_size);
 
 		index = largest;
 		lchild = heap_left(index);
@@ -123,8 +123,185 @@ static HEAP_API void heap_pop(void* begin, void* end,
 			  		  		  size_t elem_size, comparator cmp)
 {
 	uint8_t* prev_end = (uint8_t *)end - (1 * elem_size);
-	iter_swap(begin, prev_end, elem_size);
+	iter_swap_inplace(begin, prev_end, elem_size);
 	heap_down(begin, prev_end, 0, elem_size, cmp);
 }
 
+// Bottom-up ("Floyd") sift: the hole at root is walked down to a leaf
+// along the cmp-first children (one comparison per level), then value
+// climbs back up, never past root. Elements are moved, not swapped.
+// value must not live inside [begin, begin + n); returns its position.
+static HEAP_API size_t heap_sift_bottom_up(void* begin, size_t n, size_t root,
+										   size_t elem_size, comparator cmp,
+										   const void* value)
+{
+	uint8_t* base = (uint8_t *)begin;
+	size_t hole = root;
+
+	for (size_t child = heap_left(hole); child < n; child = heap_left(hole))
+	{
+		if (child + 1 < n && cmp(base + ((child + 1) * elem_size),
+								 base + (child * elem_size), elem_size))
+		{
+			++child;
+		}
+
+		iter_copy(base + (hole * elem_size), base + (child * elem_size), elem_size);
+		hole = child;
+	}
+
+	// the leaf is usually close to where value belongs, few steps back up
+	while (hole > root)
+	{
+		size_t parent = heap_parent(hole);
+		if (!cmp(value, base + (parent * elem_size), elem_size))
+			break;
+
+		iter_copy(base + (hole * elem_size), base + (parent * elem_size), elem_size);
+		hole = parent;
+	}
+
+	iter_copy(base + (hole * elem_size), value, elem_size);
+	return hole;
+}
+
+// heap_construct with bottom-up sifts, scratch holds one element
+static HEAP_API void heap_construct_bottom_up(void* begin, void* end,
+											  size_t elem_size, comparator cmp,
+											  void* scratch)
+{
+	size_t n = (size_t)((uint8_t *)end - (uint8_t *)begin) / elem_size;
+
+	for (size_t index = n >> 1; index; --index)
+	{
+		iter_copy(scratch, (uint8_t *)begin + ((index - 1) * elem_size), elem_size);
+		heap_sift_bottom_up(begin, n, index - 1, elem_size, cmp, scratch);
+	}
+}
+
+// Indexed variants: handles[pos] is the handle stored at heap position pos
+// and positions[handle] its current position, both are kept up to date
+// on every swap so an element can be found again in O(1).
+static HEAP_API void heap_index_swap(void* begin, size_t first, size_t second,
+									 size_t elem_size, size_t* handles, size_t* positions)
+{
+	iter_swap_inplace((uint8_t *)begin + (first * elem_size),
+					  (uint8_t *)begin + (second * elem_size), elem_size);
+
+	size_t first_handle = handles[first];
+	size_t second_handle = handles[second];
+
+	handles[first] = second_handle;
+	handles[second] = first_handle;
+	positions[second_handle] = first;
+	positions[first_handle] = second;
+}
+
+// returns the final position of the element
+static HEAP_API size_t heap_upper_indexed(void* begin, void* end,
+										  size_t index, size_t elem_size, comparator cmp,
+										  size_t* handles, size_t* positions)
+{
+	while (index)
+	{
+		size_t index_parent = heap_parent(index);
+
+		if (!cmp((uint8_t *)begin + (index * elem_size),
+				 (uint8_t *)begin + (index_parent * elem_size), elem_size))
+		{
+			break;
+		}
+
+		heap_index_swap(begin, index, index_parent, elem_size, handles, positions);
+		index = index_parent;
+	}
+
+	return index;
+}
+
+// returns the final position of the element
+static HEAP_API size_t heap_down_indexed(void* begin, void* end,
+										 size_t index, size_t elem_size, comparator cmp,
+										 size_t* handles, size_t* positions)
+{
+	size_t n = (size_t)((uint8_t *)end - (uint8_t *)begin) / elem_size;
+
+	for (;;)
+	{
+		size_t lchild = heap_left(index);
+		size_t rchild = heap_right(index);
+		size_t largest = index;
+
+		if (lchild < n && cmp((uint8_t *)begin + (lchild * elem_size),
+							  (uint8_t *)begin + (index * elem_size), elem_size))
+		{
+			largest = lchild;
+		}
+
+		if (rchild < n && cmp((uint8_t *)begin + (rchild * elem_size),
+							  (uint8_t *)begin + (largest * elem_size), elem_size))
+		{
+			largest = rchild;
+		}
+
+		if (largest == index)
+			return index;
+
+		heap_index_swap(begin, index, largest, elem_size, handles, positions);
+		index = largest;
+	}
+}
+
+static HEAP_API void heap_construct_indexed(void* begin, void* end,
+											size_t elem_size, comparator cmp,
+											size_t* handles, size_t* positions)
+{
+	size_t n = (size_t)((uint8_t *)end - (uint8_t *)begin) / elem_size;
+
+	for (size_t index = n >> 1; index; --index)
+		heap_down_indexed(begin, end, index - 1, elem_size, cmp, handles, positions);
+}
+
+// heap_sift_bottom_up that keeps handles/positions in sync, value_handle
+// is the handle of value
+static HEAP_API size_t heap_sift_bottom_up_indexed(void* begin, size_t n, size_t root,
+												   size_t elem_size, comparator cmp,
+												   const void* value, size_t value_handle,
+												   size_t* handles, size_t* positions)
+{
+	uint8_t* base = (uint8_t *)begin;
+	size_t hole = root;
+
+	for (size_t child = heap_left(hole); child < n; child = heap_left(hole))
+	{
+		if (child + 1 < n && cmp(base + ((child + 1) * elem_size),
+								 base + (child * elem_size), elem_size))
+		{
+			++child;
+		}
+
+		iter_copy(base + (hole * elem_size), base + (child * elem_size), elem_size);
+		handles[hole] = handles[child];
+		positions[handles[hole]] = hole;
+		hole = child;
+	}
+
+	while (hole > root)
+	{
+		size_t parent = heap_parent(hole);
+		if (!cmp(value, base + (parent * elem_size), elem_size))
+			break;
+
+		iter_copy(base + (hole * elem_size), base + (parent * elem_size), elem_size);
+		handles[hole] = handles[parent];
+		positions[handles[hole]] = hole;
+		hole = parent;
+	}
+
+	iter_copy(base + (hole * elem_size), value, elem_size);
+	handles[hole] = value_handle;
+	positions[value_handle] = hole;
+	return hole;
+}
+
 #endif
@@ -0,0 +1,100 @@
+#ifndef INDIRECT_SORT_H
+#define INDIRECT_SORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "iter_utils.h"
+#include "radix_sort.h"
+
+// maps a record onto an unsigned key, records are ordered by ascending key
+typedef uint64_t(*sort_key_projection)(const void* elem);
+
+// order-preserving projections for signed and floating point fields
+static inline uint64_t sort_key_from_i64(int64_t value)
+{
+	return (uint64_t) value ^ ((uint64_t) 1u << 63);
+}
+
+static inline uint64_t sort_key_from_f64(double value)
+{
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return (bits >> 63) ? ~bits : (bits | ((uint64_t) 1u << 63));
+}
+
+// moves every record to its final place following the cycles of the
+// permutation (order[i] = current position of the record that belongs
+// at i), each record is copied once plus one copy per cycle
+static void indirect_sort_permute(uint8_t* base, size_t* order, size_t n,
+								  size_t elem_size, uint8_t* tmp)
+{
+	for (size_t start = 0; start < n; ++start)
+	{
+		if (order[start] == start)
+			continue;
+
+		memcpy(tmp, base + (start * elem_size), elem_size);
+
+		size_t hole = start;
+		size_t next = order[hole];
+
+		while (next != start)
+		{
+			memcpy(base + (hole * elem_size), base + (next * elem_size), elem_size);
+			order[hole] = hole;
+			hole = next;
+			next = order[hole];
+		}
+
+		memcpy(base + (hole * elem_size), tmp, elem_size);
+		order[hole] = hole;
+	}
+}
+
+// Stable sort of big records: a compact (key, index) array is built with
+// proj and radix sorted, then the records are moved in a single pass.
+// Returns false if the temporary arrays cannot be allocated.
+static bool indirect_sort(void* begin, void* end, size_t elem_size,
+						  sort_key_projection proj)
+{
+	if (!begin || !end || !elem_size || !proj)
+		return false;
+
+	uint8_t* base = (uint8_t *) begin;
+	size_t n = (size_t)((uint8_t *)end - base) / elem_size;
+
+	if (n < 2)
+		return true;
+
+	uint64_t* keys = (uint64_t *) malloc(n * sizeof(uint64_t));
+	size_t* order = (size_t *) malloc(n * sizeof(size_t));
+	uint8_t* tmp = (uint8_t *) malloc(elem_size);
+
+	bool success = keys && order && tmp;
+
+	if (success)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			keys[i] = proj(base + (i * elem_size));
+			order[i] = i;
+		}
+
+		success = radix_sort_kv_u64(keys, keys + n, order, sizeof(size_t),
+									RADIX_SORT_DIGIT_BITS_11);
+	}
+
+	if (success)
+		indirect_sort_permute(base, order, n, elem_size, tmp);
+
+	free(keys);
+	free(order);
+	free(tmp);
+
+	return success;
+}
+
+#endif
@@ -29,4 +29,70 @@ static void iter_swap(void* first, void* second, size_t elem_size)
 	free(tmp);
 }
 
+static inline void iter_copy(void* dest, const void* src, size_t elem_size)
+{
+	// constant sizes let the compiler emit a single load/store
+	switch (elem_size)
+	{
+		case 4:
+			memcpy(dest, src, 4);
+			break;
+		case 8:
+			memcpy(dest, src, 8);
+			break;
+		default:
+			memcpy(dest, src, elem_size);
+			break;
+	}
+}
+
+// iter_swap without the heap allocation, swaps in small stack chunks
+static inline void iter_swap_inplace(void* first, void* second, size_t elem_size)
+{
+	uint8_t* a = (uint8_t *) first;
+	uint8_t* b = (uint8_t *) second;
+	uint8_t tmp[64];
+
+	switch (elem_size)
+	{
+		case 4:
+			memcpy(tmp, a, 4);
+			memcpy(a, b, 4);
+			memcpy(b, tmp, 4);
+			return;
+		case 8:
+			memcpy(tmp, a, 8);
+			memcpy(a, b, 8);
+			memcpy(b, tmp, 8);
+			return;
+		default:
+			break;
+	}
+
+	while (elem_size)
+	{
+		size_t chunk = elem_size < sizeof(tmp) ? elem_size : sizeof(tmp);
+
+		memcpy(tmp, a, chunk);
+		memcpy(a, b, chunk);
+		memcpy(b, tmp, chunk);
+
+		a += chunk;
+		b += chunk;
+		elem_size -= chunk;
+	}
+}
+
+static void iter_reverse(void* begin, void* end, size_t elem_size)
+{
+	uint8_t* first = (uint8_t *) begin;
+	uint8_t* last = (uint8_t *) end;
+
+	while (first != last && first != (last -= elem_size))
+	{
+		iter_swap_inplace(first, last, elem_size);
+		first += elem_size;
+	}
+}
+
 #endif
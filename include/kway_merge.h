@@ -0,0 +1,81 @@
+#ifndef KWAY_MERGE_H
+#define KWAY_MERGE_H
+
+#define KWAY_MERGE_API
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "heap_utils.h"
+
+// records handed to the sink per call
+#define KWAY_MERGE_DEFAULT_OUTPUT_BUFFER (4096u)
+
+// from this many runs on a loser tree replaces the scoped_heap, it needs
+// one comparison per level instead of two
+#define KWAY_MERGE_DEFAULT_LOSER_TREE_THRESHOLD (8u)
+
+typedef struct kway_source_struct kway_source;
+
+// refills [cur, end) of an exhausted source, returns how many records
+// are now available (0 once the source is done)
+typedef size_t(*kway_refill)(kway_source* source);
+
+// receives size bytes of merged records (always whole records),
+// returning false aborts the merge
+typedef bool(*kway_sink)(void* ctx, const void* records, size_t size);
+
+// sorted input cursor: a memory range or a buffered reader
+struct kway_source_struct
+{
+	const uint8_t* cur;
+	const uint8_t* end;
+	kway_refill refill; // NULL for memory ranges
+	void* ctx;
+	uint8_t* buffer;
+	size_t buffer_elems;
+	size_t elem_size;
+};
+
+// sink context of kway_sink_memory, records are appended at cur
+typedef struct kway_memory_sink_struct
+{
+	uint8_t* cur;
+	uint8_t* end;
+} kway_memory_sink;
+
+typedef struct kway_merge_config_struct
+{
+	size_t output_buffer_elems;   // 0 = KWAY_MERGE_DEFAULT_OUTPUT_BUFFER
+	size_t loser_tree_threshold;  // 0 = KWAY_MERGE_DEFAULT_LOSER_TREE_THRESHOLD
+} kway_merge_config;
+
+KWAY_MERGE_API
+kway_source kway_source_from_memory(const void* begin, const void* end);
+
+// reads elem_size records from file in blocks of buffer_elems
+KWAY_MERGE_API
+bool kway_source_from_file(kway_source* source, FILE* file,
+						   size_t elem_size, size_t buffer_elems);
+
+KWAY_MERGE_API
+void kway_source_release(kway_source* source);
+
+// ctx is a FILE*
+KWAY_MERGE_API
+bool kway_sink_file(void* ctx, const void* records, size_t size);
+
+// ctx is a kway_memory_sink*
+KWAY_MERGE_API
+bool kway_sink_memory(void* ctx, const void* records, size_t size);
+
+// Merges k sorted sources (same ordering convention as intro_sort) into
+// one sorted stream. Stable: equal records come out in source order.
+// config may be NULL to use the defaults.
+KWAY_MERGE_API
+bool kway_merge(kway_source* sources, size_t k, size_t elem_size, comparator cmp,
+				kway_sink sink, void* sink_ctx, const kway_merge_config* config);
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef MULTI_QUEUE_H
+#define MULTI_QUEUE_H
+
+#define MULTI_QUEUE_API
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "heap_utils.h"
+
+// c in the usual c * P queues for P threads
+#define MULTI_QUEUE_DEFAULT_FACTOR (2u)
+
+// failed try-locks before a push or pop blocks on a queue
+#define MULTI_QUEUE_MAX_ATTEMPTS (16u)
+
+#define MULTI_QUEUE_CACHE_LINE (64u)
+
+typedef struct multi_queue_struct multi_queue;
+
+// Relaxed concurrent priority queue: nqueues independently locked
+// scoped_heaps. Push goes to a random queue and pop takes the better top
+// of two random queues, so pops return one of the best elements rather
+// than the best. Same comparator convention as scoped_heap (less_than_i32
+// pops small values first).
+MULTI_QUEUE_API
+multi_queue* multi_queue_create(size_t nqueues, uint32_t elem_size, comparator cmp);
+
+MULTI_QUEUE_API
+bool multi_queue_push(multi_queue* mq, const void* element);
+
+// copies the popped element into out, returns false when the queue is empty
+MULTI_QUEUE_API
+bool multi_queue_pop(multi_queue* mq, void* out);
+
+MULTI_QUEUE_API
+size_t multi_queue_size(multi_queue* mq);
+
+MULTI_QUEUE_API
+void multi_queue_release(multi_queue** ppmq);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef PARALLEL_SORT_H
+#define PARALLEL_SORT_H
+
+#define PARALLEL_SORT_API
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "heap_utils.h"
+
+// below this many elements the sort runs sequentially (intro_sort)
+#define PARALLEL_SORT_DEFAULT_CUTOFF (1u << 16)
+
+// how many merge tasks each thread gets per round, more tasks smooth
+// out uneven chunks at the cost of extra co-rank searches
+#define PARALLEL_SORT_TASKS_PER_THREAD (2u)
+
+typedef struct parallel_sort_config_struct
+{
+	size_t nthreads; // 0 = number of online cores
+	size_t cutoff;   // 0 = PARALLEL_SORT_DEFAULT_CUTOFF
+} parallel_sort_config;
+
+PARALLEL_SORT_API
+size_t parallel_sort_hardware_threads(void);
+
+// Parallel merge sort: every thread intro_sorts a chunk, then the chunks
+// are merged pairwise, each merge split by co-rank so all threads take
+// part until the last round. Same ordering convention as intro_sort.
+// config may be NULL to use the defaults.
+PARALLEL_SORT_API
+bool parallel_sort(void* begin, void* end, size_t elem_size,
+				   comparator cmp, const parallel_sort_config* config);
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#define PERF_COUNTERS_API
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define PERF_COUNTER_CYCLES        (0u)
+#define PERF_COUNTER_INSTRUCTIONS  (1u)
+#define PERF_COUNTER_L1D_MISSES    (2u)
+#define PERF_COUNTER_LLC_MISSES    (3u)
+#define PERF_COUNTER_BRANCH_MISSES (4u)
+#define PERF_COUNTER_DTLB_MISSES   (5u)
+#define PERF_COUNTERS_COUNT        (6u)
+
+typedef struct perf_counters_struct perf_counters;
+
+// values of one measured region, available[i] is false for counters the
+// kernel, the CPU or the permissions did not give us
+typedef struct perf_counters_sample_struct
+{
+	uint64_t values[PERF_COUNTERS_COUNT];
+	bool available[PERF_COUNTERS_COUNT];
+} perf_counters_sample;
+
+// Hardware counters of the calling thread and the threads it creates
+// afterwards, user space only, through perf_event_open on Linux. Never
+// fails because counters are missing: a handle with nothing available is
+// returned instead (and always on other systems). NULL only when out of
+// memory.
+PERF_COUNTERS_API
+perf_counters* perf_counters_create(void);
+
+// true when at least one counter could be opened
+PERF_COUNTERS_API
+bool perf_counters_any(const perf_counters* counters);
+
+PERF_COUNTERS_API
+const char* perf_counters_name(size_t counter);
+
+// resets and starts every available counter
+PERF_COUNTERS_API
+void perf_counters_begin(perf_counters* counters);
+
+// stops the counters and reads the region since perf_counters_begin,
+// values are scaled up when the kernel had to multiplex them
+PERF_COUNTERS_API
+void perf_counters_end(perf_counters* counters, perf_counters_sample* sample);
+
+PERF_COUNTERS_API
+void perf_counters_release(perf_counters** ppcounters);
+
+#endif
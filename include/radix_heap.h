@@ -0,0 +1,40 @@
+#ifndef RADIX_HEAP_H
+#define RADIX_HEAP_H
+
+#define RADIX_HEAP_API
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// one bucket for keys equal to the last popped one, plus one per bit
+#define RADIX_HEAP_BUCKETS (65u)
+
+#define RADIX_HEAP_INITIAL_BUCKET_CAPACITY (16u)
+
+typedef struct radix_heap_struct radix_heap;
+
+// Monotone min-priority queue on uint64_t keys (uint32_t keys just widen),
+// each carrying an elem_size payload (elem_size may be 0). Keys pushed
+// must not be smaller than the last popped key. Entries are bucketed by
+// the highest bit where they differ from that key, so push is O(1) and
+// pop amortizes to O(log C) moves without calling a comparator.
+RADIX_HEAP_API
+radix_heap* radix_heap_create(uint32_t elem_size);
+
+// fails when key is below the last popped key
+RADIX_HEAP_API
+bool radix_heap_push(radix_heap* heap, uint64_t key, const void* element);
+
+// pops the smallest key; key and element (elem_size bytes) may be NULL,
+// returns false when the heap is empty
+RADIX_HEAP_API
+bool radix_heap_pop(radix_heap* heap, uint64_t* key, void* element);
+
+RADIX_HEAP_API
+size_t radix_heap_size(radix_heap* heap);
+
+RADIX_HEAP_API
+void radix_heap_release(radix_heap** ppheap);
+
+#endif
@@ -0,0 +1,483 @@
+#ifndef RADIX_SORT_H
+#define RADIX_SORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "iter_utils.h"
+
+#define RADIX_SORT_DIGIT_BITS_8  (8u)
+#define RADIX_SORT_DIGIT_BITS_11 (11u)
+#define RADIX_SORT_DIGIT_BITS_16 (16u)
+
+// inputs bigger than this are split MSD-first into buckets before the LSD passes
+#ifndef RADIX_SORT_MSD_THRESHOLD
+	#define RADIX_SORT_MSD_THRESHOLD (1u << 22)
+#endif
+
+// MSD recursion stops once a bucket has at most this many keys (~L2 sized)
+#ifndef RADIX_SORT_MSD_BUCKET_SIZE
+	#define RADIX_SORT_MSD_BUCKET_SIZE (1u << 16)
+#endif
+
+// buckets this small are finished by insertion sort
+#define RADIX_SORT_SMALL_SIZE (64u)
+
+#define RADIX_KEY_UNSIGNED (0x00000001)
+#define RADIX_KEY_SIGNED   (0x00000002)
+#define RADIX_KEY_FLOAT    (0x00000003)
+
+typedef struct radix_sort_state_struct
+{
+	size_t key_size;
+	size_t value_size;
+	uint8_t digit_bits;
+	size_t* counts;     // histograms shared by every LSD run
+	uint8_t* value_key; // one value, used by insertion sort
+} radix_sort_state;
+
+static inline uint64_t radix_load_key(const uint8_t* ptr, size_t key_size)
+{
+	if (key_size == sizeof(uint32_t))
+	{
+		uint32_t key;
+		memcpy(&key, ptr, sizeof(key));
+		return key;
+	}
+
+	uint64_t key;
+	memcpy(&key, ptr, sizeof(key));
+	return key;
+}
+
+static inline void radix_store_key(uint8_t* ptr, uint64_t key, size_t key_size)
+{
+	if (key_size == sizeof(uint32_t))
+	{
+		uint32_t narrow = (uint32_t) key;
+		memcpy(ptr, &narrow, sizeof(narrow));
+	}
+	else
+		memcpy(ptr, &key, sizeof(key));
+}
+
+// maps signed and IEEE-754 keys onto unsigned keys with the same order
+static void radix_key_transform(void* keys, size_t n, size_t key_size,
+								uint8_t kind, bool forward)
+{
+	if (kind == RADIX_KEY_UNSIGNED)
+		return;
+
+	uint8_t* iter = (uint8_t *) keys;
+	uint64_t sign = (uint64_t) 1u << ((key_size * 8u) - 1u);
+	uint64_t mask = key_size == sizeof(uint32_t) ? UINT32_MAX : UINT64_MAX;
+
+	for (size_t i = 0; i < n; ++i, iter += key_size)
+	{
+		uint64_t key = radix_load_key(iter, key_size);
+
+		if (kind == RADIX_KEY_SIGNED)
+			key ^= sign;
+		else if (forward)
+			key = (key & sign) ? (~key & mask) : (key | sign);
+		else
+			key = (key & sign) ? (key & ~sign) : (~key & mask);
+
+		radix_store_key(iter, key, key_size);
+	}
+}
+
+static void radix_insertion_sort(uint8_t* keys, uint8_t* values, size_t n,
+								 const radix_sort_state* state)
+{
+	size_t key_size = state->key_size;
+	size_t value_size = state->value_size;
+
+	for (size_t i = 1; i < n; ++i)
+	{
+		uint64_t key = radix_load_key(keys + (i * key_size), key_size);
+		size_t j = i;
+
+		if (radix_load_key(keys + ((j - 1) * key_size), key_size) <= key)
+			continue;
+
+		if (values)
+			iter_copy(state->value_key, values + (i * value_size), value_size);
+
+		do
+		{
+			iter_copy(keys + (j * key_size), keys + ((j - 1) * key_size), key_size);
+			if (values)
+				iter_copy(values + (j * value_size), values + ((j - 1) * value_size), value_size);
+			--j;
+		} while (j && radix_load_key(keys + ((j - 1) * key_size), key_size) > key);
+
+		radix_store_key(keys + (j * key_size), key, key_size);
+		if (values)
+			iter_copy(values + (j * value_size), state->value_key, value_size);
+	}
+}
+
+// LSD passes over the low key_bits bits, digits that are equal for every
+// key are skipped. Returns true when the result ended up in the scratch
+// buffers instead of keys/values.
+static bool radix_sort_lsd(uint8_t* keys, uint8_t* key_tmp,
+						   uint8_t* values, uint8_t* value_tmp,
+						   size_t n, unsigned key_bits, uint8_t digit_bits,
+						   const radix_sort_state* state)
+{
+	size_t key_size = state->key_size;
+	size_t value_size = state->value_size;
+	size_t nbuckets = (size_t) 1u << digit_bits;
+	uint64_t mask = nbuckets - 1u;
+	unsigned passes = (key_bits + digit_bits - 1u) / digit_bits;
+	size_t* counts = state->counts;
+
+	memset(counts, 0, passes * nbuckets * sizeof(size_t));
+
+	// one read of the input builds the histogram of every digit
+	if (key_size == sizeof(uint32_t))
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			uint64_t key = radix_load_key(keys + (i * sizeof(uint32_t)), sizeof(uint32_t));
+			for (unsigned p = 0; p < passes; ++p)
+				++counts[(p * nbuckets) + ((key >> (p * digit_bits)) & mask)];
+		}
+	}
+	else
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			uint64_t key = radix_load_key(keys + (i * sizeof(uint64_t)), sizeof(uint64_t));
+			for (unsigned p = 0; p < passes; ++p)
+				++counts[(p * nbuckets) + ((key >> (p * digit_bits)) & mask)];
+		}
+	}
+
+	bool in_tmp = false;
+
+	for (unsigned p = 0; p < passes; ++p)
+	{
+		size_t* offsets = counts + (p * nbuckets);
+		unsigned shift = p * digit_bits;
+		bool trivial = false;
+		size_t sum = 0u;
+
+		for (size_t d = 0; d < nbuckets; ++d)
+		{
+			size_t count = offsets[d];
+			trivial = trivial || count == n;
+			offsets[d] = sum;
+			sum += count;
+		}
+
+		if (trivial)
+			continue;
+
+		uint8_t* src  = in_tmp ? key_tmp : keys;
+		uint8_t* dest = in_tmp ? keys : key_tmp;
+		uint8_t* vsrc  = in_tmp ? value_tmp : values;
+		uint8_t* vdest = in_tmp ? values : value_tmp;
+
+		if (values)
+		{
+			for (size_t i = 0; i < n; ++i)
+			{
+				uint64_t key = radix_load_key(src + (i * key_size), key_size);
+				size_t pos = offsets[(key >> shift) & mask]++;
+
+				radix_store_key(dest + (pos * key_size), key, key_size);
+				iter_copy(vdest + (pos * value_size), vsrc + (i * value_size), value_size);
+			}
+		}
+		else if (key_size == sizeof(uint32_t))
+		{
+			for (size_t i = 0; i < n; ++i)
+			{
+				uint64_t key = radix_load_key(src + (i * sizeof(uint32_t)), sizeof(uint32_t));
+				size_t pos = offsets[(key >> shift) & mask]++;
+				radix_store_key(dest + (pos * sizeof(uint32_t)), key, sizeof(uint32_t));
+			}
+		}
+		else
+		{
+			for (size_t i = 0; i < n; ++i)
+			{
+				uint64_t key = radix_load_key(src + (i * sizeof(uint64_t)), sizeof(uint64_t));
+				size_t pos = offsets[(key >> shift) & mask]++;
+				radix_store_key(dest + (pos * sizeof(uint64_t)), key, sizeof(uint64_t));
+			}
+		}
+
+		in_tmp = !in_tmp;
+	}
+
+	return in_tmp;
+}
+
+// sorts the low key_bits bits of keys in place, the scratch buffers have
+// the same size as the input and may be clobbered
+static bool radix_sort_range(uint8_t* keys, uint8_t* key_tmp,
+							 uint8_t* values, uint8_t* value_tmp,
+							 size_t n, unsigned key_bits,
+							 const radix_sort_state* state)
+{
+	size_t key_size = state->key_size;
+	size_t value_size = state->value_size;
+
+	if (!key_bits)
+		return true;
+
+	if (n <= RADIX_SORT_SMALL_SIZE)
+	{
+		radix_insertion_sort(keys, values, n, state);
+		return true;
+	}
+
+	if (n <= RADIX_SORT_MSD_BUCKET_SIZE || key_bits <= state->digit_bits)
+	{
+		// small ranges use small digits, clearing big histograms would dominate
+		uint8_t digit_bits = n <= RADIX_SORT_MSD_BUCKET_SIZE ? RADIX_SORT_DIGIT_BITS_8
+															 : state->digit_bits;
+
+		if (radix_sort_lsd(keys, key_tmp, values, value_tmp, n, key_bits, digit_bits, state))
+		{
+			memcpy(keys, key_tmp, n * key_size);
+			if (values)
+				memcpy(values, value_tmp, n * value_size);
+		}
+
+		return true;
+	}
+
+	uint8_t digit_bits = state->digit_bits;
+	size_t nbuckets = (size_t) 1u << digit_bits;
+	uint64_t mask = nbuckets - 1u;
+	unsigned shift = key_bits - digit_bits;
+
+	size_t* offsets = (size_t *) calloc(nbuckets + 1, sizeof(size_t));
+	if (!offsets)
+		return false;
+
+	for (size_t i = 0; i < n; ++i)
+		++offsets[((radix_load_key(keys + (i * key_size), key_size) >> shift) & mask) + 1];
+
+	bool trivial = false;
+	for (size_t d = 1; d <= nbuckets; ++d)
+	{
+		trivial = trivial || offsets[d] == n;
+		offsets[d] += offsets[d - 1];
+	}
+
+	if (trivial)
+	{
+		free(offsets);
+		return radix_sort_range(keys, key_tmp, values, value_tmp, n, shift, state);
+	}
+
+	size_t* cursor = (size_t *) malloc(nbuckets * sizeof(size_t));
+	if (!cursor)
+	{
+		free(offsets);
+		return false;
+	}
+
+	memcpy(cursor, offsets, nbuckets * sizeof(size_t));
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		uint64_t key = radix_load_key(keys + (i * key_size), key_size);
+		size_t pos = cursor[(key >> shift) & mask]++;
+
+		radix_store_key(key_tmp + (pos * key_size), key, key_size);
+		if (values)
+			iter_copy(value_tmp + (pos * value_size), values + (i * value_size), value_size);
+	}
+
+	free(cursor);
+
+	// every bucket is now contiguous in the scratch buffers and is sorted
+	// there, using the matching slice of the input as its own scratch
+	bool success = true;
+
+	for (size_t d = 0; d < nbuckets && success; ++d)
+	{
+		size_t first = offsets[d];
+		size_t count = offsets[d + 1] - first;
+
+		if (count < 2)
+			continue;
+
+		success = radix_sort_range(key_tmp + (first * key_size), keys + (first * key_size),
+								   values ? value_tmp + (first * value_size) : NULL,
+								   values ? values + (first * value_size) : NULL,
+								   count, shift, state);
+	}
+
+	free(offsets);
+
+	memcpy(keys, key_tmp, n * key_size);
+	if (values)
+		memcpy(values, value_tmp, n * value_size);
+
+	return success;
+}
+
+static bool radix_sort_impl(void* keys, size_t n, size_t key_size, uint8_t kind,
+							void* values, size_t value_size, uint8_t digit_bits)
+{
+	if (!keys || !digit_bits || digit_bits > RADIX_SORT_DIGIT_BITS_16)
+		return false;
+
+	if (n < 2)
+		return true;
+
+	if (!values || !value_size)
+	{
+		values = NULL;
+		value_size = 0u;
+	}
+
+	unsigned key_bits = (unsigned)(key_size * 8u);
+	size_t passes = (key_bits + digit_bits - 1u) / digit_bits;
+
+	// room for the requested digits and for the 8 bit digits of small buckets
+	size_t ncounts = passes << digit_bits;
+	size_t nsmall_counts = (key_bits / RADIX_SORT_DIGIT_BITS_8) << RADIX_SORT_DIGIT_BITS_8;
+
+	if (ncounts < nsmall_counts)
+		ncounts = nsmall_counts;
+
+	radix_sort_state state =
+	{
+		.key_size = key_size,
+		.value_size = value_size,
+		.digit_bits = digit_bits,
+		.counts = (size_t *) malloc(ncounts * sizeof(size_t)),
+		.value_key = values ? (uint8_t *) malloc(value_size) : NULL
+	};
+
+	uint8_t* key_tmp = (uint8_t *) malloc(n * key_size);
+	uint8_t* value_tmp = values ? (uint8_t *) malloc(n * value_size) : NULL;
+
+	bool success = state.counts && key_tmp && (!values || (value_tmp && state.value_key));
+
+	if (success)
+	{
+		radix_key_transform(keys, n, key_size, kind, true);
+
+		if (n > RADIX_SORT_MSD_THRESHOLD)
+		{
+			success = radix_sort_range((uint8_t *) keys, key_tmp, (uint8_t *) values,
+									   value_tmp, n, key_bits, &state);
+		}
+		else if (n <= RADIX_SORT_SMALL_SIZE)
+		{
+			radix_insertion_sort((uint8_t *) keys, (uint8_t *) values, n, &state);
+		}
+		else if (radix_sort_lsd((uint8_t *) keys, key_tmp, (uint8_t *) values,
+								value_tmp, n, key_bits, digit_bits, &state))
+		{
+			memcpy(keys, key_tmp, n * key_size);
+			if (values)
+				memcpy(values, value_tmp, n * value_size);
+		}
+
+		radix_key_transform(keys, n, key_size, kind, false);
+	}
+
+	free(state.counts);
+	free(state.value_key);
+	free(key_tmp);
+	free(value_tmp);
+
+	return success;
+}
+
+// Ascending, stable radix sorts. digit_bits is usually one of the
+// RADIX_SORT_DIGIT_BITS_* values (any width in 1..16 works). The kv
+// variants move values[i] (value_size bytes each) along with keys[i].
+
+static bool radix_sort_u32(uint32_t* begin, uint32_t* end, uint8_t digit_bits)
+{
+	return radix_sort_impl(begin, (size_t)(end - begin), sizeof(uint32_t),
+						   RADIX_KEY_UNSIGNED, NULL, 0u, digit_bits);
+}
+
+static bool radix_sort_u64(uint64_t* begin, uint64_t* end, uint8_t digit_bits)
+{
+	return radix_sort_impl(begin, (size_t)(end - begin), sizeof(uint64_t),
+						   RADIX_KEY_UNSIGNED, NULL, 0u, digit_bits);
+}
+
+static bool radix_sort_i32(int32_t* begin, int32_t* end, uint8_t digit_bits)
+{
+	return radix_sort_impl(begin, (size_t)(end - begin), sizeof(int32_t),
+						   RADIX_KEY_SIGNED, NULL, 0u, digit_bits);
+}
+
+static bool radix_sort_i64(int64_t* begin, int64_t* end, uint8_t digit_bits)
+{
+	return radix_sort_impl(begin, (size_t)(end - begin), sizeof(int64_t),
+						   RADIX_KEY_SIGNED, NULL, 0u, digit_bits);
+}
+
+static bool radix_sort_f32(float* begin, float* end, uint8_t digit_bits)
+{
+	return radix_sort_impl(begin, (size_t)(end - begin), sizeof(float),
+						   RADIX_KEY_FLOAT, NULL, 0u, digit_bits);
+}
+
+static bool radix_sort_f64(double* begin, double* end, uint8_t digit_bits)
+{
+	return radix_sort_impl(begin, (size_t)(end - begin), sizeof(double),
+						   RADIX_KEY_FLOAT, NULL, 0u, digit_bits);
+}
+
+static bool radix_sort_kv_u32(uint32_t* begin, uint32_t* end, void* values,
+							  size_t value_size, uint8_t digit_bits)
+{
+	return radix_sort_impl(begin, (size_t)(end - begin), sizeof(uint32_t),
+						   RADIX_KEY_UNSIGNED, values, value_size, digit_bits);
+}
+
+static bool radix_sort_kv_u64(uint64_t* begin, uint64_t* end, void* values,
+							  size_t value_size, uint8_t digit_bits)
+{
+	return radix_sort_impl(begin, (size_t)(end - begin), sizeof(uint64_t),
+						   RADIX_KEY_UNSIGNED, values, value_size, digit_bits);
+}
+
+static bool radix_sort_kv_i32(int32_t* begin, int32_t* end, void* values,
+							  size_t value_size, uint8_t digit_bits)
+{
+	return radix_sort_impl(begin, (size_t)(end - begin), sizeof(int32_t),
+						   RADIX_KEY_SIGNED, values, value_size, digit_bits);
+}
+
+static bool radix_sort_kv_i64(int64_t* begin, int64_t* end, void* values,
+							  size_t value_size, uint8_t digit_bits)
+{
+	return radix_sort_impl(begin, (size_t)(end - begin), sizeof(int64_t),
+						   RADIX_KEY_SIGNED, values, value_size, digit_bits);
+}
+
+static bool radix_sort_kv_f32(float* begin, float* end, void* values,
+							  size_t value_size, uint8_t digit_bits)
+{
+	return radix_sort_impl(begin, (size_t)(end - begin), sizeof(float),
+						   RADIX_KEY_FLOAT, values, value_size, digit_bits);
+}
+
+static bool radix_sort_kv_f64(double* begin, double* end, void* values,
+							  size_t value_size, uint8_t digit_bits)
+{
+	return radix_sort_impl(begin, (size_t)(end - begin), sizeof(double),
+						   RADIX_KEY_FLOAT, values, value_size, digit_bits);
+}
+
+#endif
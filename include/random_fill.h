@@ -0,0 +1,38 @@
+#ifndef RANDOM_FILL_H
+#define RANDOM_FILL_H
+
+#define RANDOM_FILL_API
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "random_utils.h"
+
+// elements per stream: chunk c is generated by the seed's generator
+// jumped c times, whatever thread happens to produce it
+#define RANDOM_FILL_CHUNK_SIZE ((size_t) 1u << 16)
+
+// below this many elements the fill stays on the calling thread
+#define RANDOM_FILL_DEFAULT_CUTOFF ((size_t) 1u << 20)
+
+typedef struct random_fill_config_struct
+{
+	size_t nthreads; // 0 = number of online cores
+	size_t cutoff;   // 0 = RANDOM_FILL_DEFAULT_CUTOFF
+} random_fill_config;
+
+// Fills [begin, end) with xoshiro256** values uniform in [0, bound)
+// (bound 0 = the whole uint32_t range) on several threads. The output
+// only depends on seed, never on the thread count, so runs repeat.
+// config may be NULL to use the defaults.
+RANDOM_FILL_API
+bool random_fill_u32(uint32_t* begin, uint32_t* end, uint32_t bound,
+					 uint64_t seed, const random_fill_config* config);
+
+// same as random_fill_u32 over the whole uint64_t range
+RANDOM_FILL_API
+bool random_fill_u64(uint64_t* begin, uint64_t* end,
+					 uint64_t seed, const random_fill_config* config);
+
+#endif
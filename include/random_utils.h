@@ -0,0 +1,114 @@
+#ifndef RANDOM_UTILS_H
+#define RANDOM_UTILS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// xoshiro256** (Blackman & Vigna): 256 bits of state, period 2^256 - 1,
+// a few cycles per 64-bit output. xoshiro256_jump advances a generator
+// by 2^128 steps, so streams split by jumps never overlap in practice.
+typedef struct xoshiro256_struct
+{
+	uint64_t s[4];
+} xoshiro256;
+
+static inline uint64_t xoshiro256_rotl(uint64_t x, unsigned k)
+{
+	return (x << k) | (x >> (64u - k));
+}
+
+// splitmix64, spreads a plain seed over the whole state
+static inline uint64_t splitmix64_next(uint64_t* state)
+{
+	uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+static inline xoshiro256 xoshiro256_seed(uint64_t seed)
+{
+	xoshiro256 rng;
+
+	// splitmix64 never gives four zeros in a row, the state is valid
+	for (size_t i = 0; i < 4u; ++i)
+		rng.s[i] = splitmix64_next(&seed);
+
+	return rng;
+}
+
+static inline uint64_t xoshiro256_next(xoshiro256* rng)
+{
+	uint64_t* s = rng->s;
+	uint64_t result = xoshiro256_rotl(s[1] * 5u, 7u) * 9u;
+	uint64_t t = s[1] << 17;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = xoshiro256_rotl(s[3], 45u);
+
+	return result;
+}
+
+// equivalent to 2^128 calls to xoshiro256_next
+static inline void xoshiro256_jump(xoshiro256* rng)
+{
+	static const uint64_t jump[4] =
+	{
+		0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL,
+		0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL
+	};
+
+	uint64_t s[4] = { 0u, 0u, 0u, 0u };
+
+	for (size_t i = 0; i < 4u; ++i)
+	{
+		for (unsigned b = 0; b < 64u; ++b)
+		{
+			if (jump[i] & ((uint64_t) 1u << b))
+			{
+				s[0] ^= rng->s[0];
+				s[1] ^= rng->s[1];
+				s[2] ^= rng->s[2];
+				s[3] ^= rng->s[3];
+			}
+
+			xoshiro256_next(rng);
+		}
+	}
+
+	for (size_t i = 0; i < 4u; ++i)
+		rng->s[i] = s[i];
+}
+
+// uniform in [0, bound), bound > 0. Lemire's multiply-shift, rejecting
+// the few products that would bias the low values.
+static inline uint32_t xoshiro256_bounded32(xoshiro256* rng, uint32_t bound)
+{
+	uint64_t m = (xoshiro256_next(rng) >> 32) * bound;
+	uint32_t low = (uint32_t) m;
+
+	if (low < bound)
+	{
+		uint32_t threshold = (uint32_t)(-bound) % bound;
+
+		while (low < threshold)
+		{
+			m = (xoshiro256_next(rng) >> 32) * bound;
+			low = (uint32_t) m;
+		}
+	}
+
+	return (uint32_t)(m >> 32);
+}
+
+// uniform in [0, 1) with 53 random bits
+static inline double xoshiro256_double(xoshiro256* rng)
+{
+	return (double)(xoshiro256_next(rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+#endif
@@ -10,6 +10,18 @@
 
 #define SCOPED_HEAP_CAPACITY_FACTOR 0x2
 
+#define SCOPED_HEAP_INVALID_HANDLE ((scoped_heap_handle) 0)
+
+// how scoped_heap_pop restores the heap: the classic sift-down compares
+// both children at every level, the bottom-up one walks the hole to a leaf
+// with one comparison per level and moves the last element back up from
+// there, roughly half the comparisons for expensive comparators
+#define SCOPED_HEAP_POP_TOP_DOWN  (0u)
+#define SCOPED_HEAP_POP_BOTTOM_UP (1u)
+
+// stable reference to a pushed element, valid until it is popped or erased
+typedef size_t scoped_heap_handle;
+
 typedef struct scoped_heap_struct
 {
 	uint8_t* begin;
@@ -17,6 +29,9 @@ typedef struct scoped_heap_struct
 	uint32_t elem_size;
 	size_t capacity;
 	comparator cmp_fptr;
+	size_t* handles;   // heap position -> handle, free handles past the end
+	size_t* positions; // handle -> heap position
+	uint8_t pop_method; // SCOPED_HEAP_POP_*, top-down by default
 } scoped_heap;
 
 typedef void(*scoped_heap_action)(const uint8_t* elem_ptr);
@@ -34,8 +49,39 @@ scoped_heap* scoped_heap_create(const void* src, size_t size,
 SCOPED_HEAP_API
 size_t scoped_heap_size(scoped_heap* scpheap_ptr);
 
+// returns SCOPED_HEAP_INVALID_HANDLE on failure
+SCOPED_HEAP_API
+scoped_heap_handle scoped_heap_push(scoped_heap* scpheap_ptr, const void* element);
+
+// appends count elements, then either sifts each one up or re-heapifies
+// the whole array, whichever is cheaper for the batch size. handles_out
+// (may be NULL) receives one handle per element.
+SCOPED_HEAP_API
+bool scoped_heap_push_range(scoped_heap* scpheap_ptr, const void* src, size_t count,
+							scoped_heap_handle* handles_out);
+
+// moves every element of src into dest in O(n), src is left empty
+SCOPED_HEAP_API
+bool scoped_heap_merge(scoped_heap* dest, scoped_heap* src);
+
+// handle of the element at the top, SCOPED_HEAP_INVALID_HANDLE when empty
+SCOPED_HEAP_API
+scoped_heap_handle scoped_heap_top_handle(scoped_heap* scpheap_ptr);
+
+SCOPED_HEAP_API
+void* scoped_heap_get(scoped_heap* scpheap_ptr, scoped_heap_handle handle);
+
+// replaces the element (or, with element == NULL, restores the heap after
+// it was changed in place through scoped_heap_get) in O(log n)
+SCOPED_HEAP_API
+bool scoped_heap_update(scoped_heap* scpheap_ptr, scoped_heap_handle handle,
+						const void* element);
+
+SCOPED_HEAP_API
+bool scoped_heap_erase(scoped_heap* scpheap_ptr, scoped_heap_handle handle);
+
 SCOPED_HEAP_API
-bool scoped_heap_push(scoped_heap* scpheap_ptr, const void* element);
+bool scoped_heap_set_pop_method(scoped_heap* scpheap_ptr, uint8_t pop_method);
 
 SCOPED_HEAP_API
 void* scoped_heap_pop(scoped_heap* scpheap_ptr);
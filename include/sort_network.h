@@ -0,0 +1,312 @@
+#ifndef SORT_NETWORK_H
+#define SORT_NETWORK_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "heap_utils.h"
+#include "iter_utils.h"
+
+#ifdef __AVX2__
+	#include <immintrin.h>
+#endif
+
+// largest block the networks below sort
+#define SORT_NETWORK_MAX_SIZE (16u)
+
+// Batcher odd-even merge networks for 2..16 elements, pruned from the
+// next power of two. Each pair (i, j), i < j, is a compare-exchange that
+// leaves the smaller value at i; pairs of one network run in order.
+static const uint8_t sort_network_table[][2] =
+{
+	// 2 elements, 1 comparators
+	{ 0, 1 },
+	// 3 elements, 3 comparators
+	{ 0, 1 }, { 0, 2 }, { 1, 2 },
+	// 4 elements, 5 comparators
+	{ 0, 1 }, { 2, 3 }, { 0, 2 }, { 1, 3 }, { 1, 2 },
+	// 5 elements, 9 comparators
+	{ 0, 1 }, { 2, 3 }, { 0, 2 }, { 1, 3 }, { 1, 2 }, { 0, 4 }, { 2, 4 }, { 1, 2 },
+	{ 3, 4 },
+	// 6 elements, 12 comparators
+	{ 0, 1 }, { 2, 3 }, { 4, 5 }, { 0, 2 }, { 1, 3 }, { 1, 2 }, { 0, 4 }, { 1, 5 },
+	{ 2, 4 }, { 3, 5 }, { 1, 2 }, { 3, 4 },
+	// 7 elements, 16 comparators
+	{ 0, 1 }, { 2, 3 }, { 4, 5 }, { 0, 2 }, { 1, 3 }, { 4, 6 }, { 1, 2 }, { 5, 6 },
+	{ 0, 4 }, { 1, 5 }, { 2, 6 }, { 2, 4 }, { 3, 5 }, { 1, 2 }, { 3, 4 }, { 5, 6 },
+	// 8 elements, 19 comparators
+	{ 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 }, { 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 },
+	{ 1, 2 }, { 5, 6 }, { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 }, { 2, 4 }, { 3, 5 },
+	{ 1, 2 }, { 3, 4 }, { 5, 6 },
+	// 9 elements, 28 comparators
+	{ 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 }, { 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 },
+	{ 1, 2 }, { 5, 6 }, { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 }, { 2, 4 }, { 3, 5 },
+	{ 1, 2 }, { 3, 4 }, { 5, 6 }, { 0, 8 }, { 4, 8 }, { 2, 4 }, { 3, 5 }, { 6, 8 },
+	{ 1, 2 }, { 3, 4 }, { 5, 6 }, { 7, 8 },
+	// 10 elements, 32 comparators
+	{ 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 }, { 8, 9 }, { 0, 2 }, { 1, 3 }, { 4, 6 },
+	{ 5, 7 }, { 1, 2 }, { 5, 6 }, { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 }, { 2, 4 },
+	{ 3, 5 }, { 1, 2 }, { 3, 4 }, { 5, 6 }, { 0, 8 }, { 1, 9 }, { 4, 8 }, { 5, 9 },
+	{ 2, 4 }, { 3, 5 }, { 6, 8 }, { 7, 9 }, { 1, 2 }, { 3, 4 }, { 5, 6 }, { 7, 8 },
+	// 11 elements, 38 comparators
+	{ 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 }, { 8, 9 }, { 0, 2 }, { 1, 3 }, { 4, 6 },
+	{ 5, 7 }, { 8, 10 }, { 1, 2 }, { 5, 6 }, { 9, 10 }, { 0, 4 }, { 1, 5 }, { 2, 6 },
+	{ 3, 7 }, { 2, 4 }, { 3, 5 }, { 1, 2 }, { 3, 4 }, { 5, 6 }, { 9, 10 }, { 0, 8 },
+	{ 1, 9 }, { 2, 10 }, { 4, 8 }, { 5, 9 }, { 6, 10 }, { 2, 4 }, { 3, 5 }, { 6, 8 },
+	{ 7, 9 }, { 1, 2 }, { 3, 4 }, { 5, 6 }, { 7, 8 }, { 9, 10 },
+	// 12 elements, 42 comparators
+	{ 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 }, { 8, 9 }, { 10, 11 }, { 0, 2 }, { 1, 3 },
+	{ 4, 6 }, { 5, 7 }, { 8, 10 }, { 9, 11 }, { 1, 2 }, { 5, 6 }, { 9, 10 }, { 0, 4 },
+	{ 1, 5 }, { 2, 6 }, { 3, 7 }, { 2, 4 }, { 3, 5 }, { 1, 2 }, { 3, 4 }, { 5, 6 },
+	{ 9, 10 }, { 0, 8 }, { 1, 9 }, { 2, 10 }, { 3, 11 }, { 4, 8 }, { 5, 9 }, { 6, 10 },
+	{ 7, 11 }, { 2, 4 }, { 3, 5 }, { 6, 8 }, { 7, 9 }, { 1, 2 }, { 3, 4 }, { 5, 6 },
+	{ 7, 8 }, { 9, 10 },
+	// 13 elements, 48 comparators
+	{ 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 }, { 8, 9 }, { 10, 11 }, { 0, 2 }, { 1, 3 },
+	{ 4, 6 }, { 5, 7 }, { 8, 10 }, { 9, 11 }, { 1, 2 }, { 5, 6 }, { 9, 10 }, { 0, 4 },
+	{ 1, 5 }, { 2, 6 }, { 3, 7 }, { 8, 12 }, { 2, 4 }, { 3, 5 }, { 10, 12 }, { 1, 2 },
+	{ 3, 4 }, { 5, 6 }, { 9, 10 }, { 11, 12 }, { 0, 8 }, { 1, 9 }, { 2, 10 }, { 3, 11 },
+	{ 4, 12 }, { 4, 8 }, { 5, 9 }, { 6, 10 }, { 7, 11 }, { 2, 4 }, { 3, 5 }, { 6, 8 },
+	{ 7, 9 }, { 10, 12 }, { 1, 2 }, { 3, 4 }, { 5, 6 }, { 7, 8 }, { 9, 10 }, { 11, 12 },
+	// 14 elements, 53 comparators
+	{ 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 }, { 8, 9 }, { 10, 11 }, { 12, 13 }, { 0, 2 },
+	{ 1, 3 }, { 4, 6 }, { 5, 7 }, { 8, 10 }, { 9, 11 }, { 1, 2 }, { 5, 6 }, { 9, 10 },
+	{ 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 }, { 8, 12 }, { 9, 13 }, { 2, 4 }, { 3, 5 },
+	{ 10, 12 }, { 11, 13 }, { 1, 2 }, { 3, 4 }, { 5, 6 }, { 9, 10 }, { 11, 12 }, { 0, 8 },
+	{ 1, 9 }, { 2, 10 }, { 3, 11 }, { 4, 12 }, { 5, 13 }, { 4, 8 }, { 5, 9 }, { 6, 10 },
+	{ 7, 11 }, { 2, 4 }, { 3, 5 }, { 6, 8 }, { 7, 9 }, { 10, 12 }, { 11, 13 }, { 1, 2 },
+	{ 3, 4 }, { 5, 6 }, { 7, 8 }, { 9, 10 }, { 11, 12 },
+	// 15 elements, 59 comparators
+	{ 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 }, { 8, 9 }, { 10, 11 }, { 12, 13 }, { 0, 2 },
+	{ 1, 3 }, { 4, 6 }, { 5, 7 }, { 8, 10 }, { 9, 11 }, { 12, 14 }, { 1, 2 }, { 5, 6 },
+	{ 9, 10 }, { 13, 14 }, { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 }, { 8, 12 }, { 9, 13 },
+	{ 10, 14 }, { 2, 4 }, { 3, 5 }, { 10, 12 }, { 11, 13 }, { 1, 2 }, { 3, 4 }, { 5, 6 },
+	{ 9, 10 }, { 11, 12 }, { 13, 14 }, { 0, 8 }, { 1, 9 }, { 2, 10 }, { 3, 11 }, { 4, 12 },
+	{ 5, 13 }, { 6, 14 }, { 4, 8 }, { 5, 9 }, { 6, 10 }, { 7, 11 }, { 2, 4 }, { 3, 5 },
+	{ 6, 8 }, { 7, 9 }, { 10, 12 }, { 11, 13 }, { 1, 2 }, { 3, 4 }, { 5, 6 }, { 7, 8 },
+	{ 9, 10 }, { 11, 12 }, { 13, 14 },
+	// 16 elements, 63 comparators
+	{ 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 }, { 8, 9 }, { 10, 11 }, { 12, 13 }, { 14, 15 },
+	{ 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 }, { 8, 10 }, { 9, 11 }, { 12, 14 }, { 13, 15 },
+	{ 1, 2 }, { 5, 6 }, { 9, 10 }, { 13, 14 }, { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 },
+	{ 8, 12 }, { 9, 13 }, { 10, 14 }, { 11, 15 }, { 2, 4 }, { 3, 5 }, { 10, 12 }, { 11, 13 },
+	{ 1, 2 }, { 3, 4 }, { 5, 6 }, { 9, 10 }, { 11, 12 }, { 13, 14 }, { 0, 8 }, { 1, 9 },
+	{ 2, 10 }, { 3, 11 }, { 4, 12 }, { 5, 13 }, { 6, 14 }, { 7, 15 }, { 4, 8 }, { 5, 9 },
+	{ 6, 10 }, { 7, 11 }, { 2, 4 }, { 3, 5 }, { 6, 8 }, { 7, 9 }, { 10, 12 }, { 11, 13 },
+	{ 1, 2 }, { 3, 4 }, { 5, 6 }, { 7, 8 }, { 9, 10 }, { 11, 12 }, { 13, 14 }
+};
+
+// network of n elements is sort_network_table[offsets[n]..offsets[n + 1])
+static const uint16_t sort_network_offsets[SORT_NETWORK_MAX_SIZE + 2] =
+{
+	0, 0, 0, 1, 4, 9, 18, 30, 46, 65, 93, 125, 163, 205, 253, 306, 365, 428
+};
+
+// returns the compare-exchange pairs of the n-element network (flattened,
+// 2 * *npairs indexes), NULL when n is out of range
+static inline const uint8_t* sort_network_pairs(size_t n, size_t* npairs)
+{
+	if (n > SORT_NETWORK_MAX_SIZE)
+		return NULL;
+
+	*npairs = (size_t)(sort_network_offsets[n + 1] - sort_network_offsets[n]);
+	return (const uint8_t *) sort_network_table + (2u * sort_network_offsets[n]);
+}
+
+// Generic network over any records, cmp follows the intro_sort convention
+// (less_than_i32 => ascending). Returns false for n > SORT_NETWORK_MAX_SIZE.
+static bool sort_network(void* begin, size_t n, size_t elem_size, comparator cmp)
+{
+	size_t npairs = 0u;
+	const uint8_t* pairs = sort_network_pairs(n, &npairs);
+	if (!pairs)
+		return false;
+
+	uint8_t* base = (uint8_t *) begin;
+
+	for (size_t p = 0; p < npairs; ++p)
+	{
+		uint8_t* first = base + (pairs[2 * p] * elem_size);
+		uint8_t* second = base + (pairs[2 * p + 1] * elem_size);
+
+		if (cmp(second, first, elem_size))
+			iter_swap_inplace(first, second, elem_size);
+	}
+
+	return true;
+}
+
+// Typed branchless kernels, ascending: the min/max of every pair compile
+// to conditional moves, no comparator calls and no branches to mispredict.
+// NaNs are unordered and may end up anywhere.
+#define SORT_NETWORK_DEFINE_SCALAR(suffix, type)								\
+static inline void sort_network_scalar_##suffix(type* v, size_t n)			\
+{																			\
+	size_t npairs = 0u;														\
+	const uint8_t* pairs = sort_network_pairs(n, &npairs);					\
+	if (!pairs)																\
+		return;																\
+																			\
+	for (size_t p = 0; p < npairs; ++p)										\
+	{																		\
+		type a = v[pairs[2 * p]];											\
+		type b = v[pairs[2 * p + 1]];										\
+		bool swap = b < a;													\
+		v[pairs[2 * p]] = swap ? b : a;										\
+		v[pairs[2 * p + 1]] = swap ? a : b;									\
+	}																		\
+}
+
+SORT_NETWORK_DEFINE_SCALAR(i32, int32_t)
+SORT_NETWORK_DEFINE_SCALAR(i64, int64_t)
+SORT_NETWORK_DEFINE_SCALAR(f32, float)
+SORT_NETWORK_DEFINE_SCALAR(f64, double)
+
+#undef SORT_NETWORK_DEFINE_SCALAR
+
+#ifdef __AVX2__
+
+// In-register bitonic sort of 8 lanes: step s pairs lane i with lane
+// partner[s][i] and lanes set in take_max[s] keep the larger value. The
+// last three steps alone merge a bitonic register.
+static const int32_t sort_network_avx2_partner[6][8] =
+{
+	{ 1, 0, 3, 2, 5, 4, 7, 6 },
+	{ 2, 3, 0, 1, 6, 7, 4, 5 },
+	{ 1, 0, 3, 2, 5, 4, 7, 6 },
+	{ 4, 5, 6, 7, 0, 1, 2, 3 },
+	{ 2, 3, 0, 1, 6, 7, 4, 5 },
+	{ 1, 0, 3, 2, 5, 4, 7, 6 }
+};
+
+static const int32_t sort_network_avx2_take_max[6][8] =
+{
+	{ 0, -1, -1, 0, 0, -1, -1, 0 },
+	{ 0, 0, -1, -1, -1, -1, 0, 0 },
+	{ 0, -1, 0, -1, -1, 0, -1, 0 },
+	{ 0, 0, 0, 0, -1, -1, -1, -1 },
+	{ 0, 0, -1, -1, 0, 0, -1, -1 },
+	{ 0, -1, 0, -1, 0, -1, 0, -1 }
+};
+
+static inline __m256i sort_network_avx2_steps_i32(__m256i v, size_t first_step)
+{
+	for (size_t s = first_step; s < 6u; ++s)
+	{
+		__m256i partner_index = _mm256_loadu_si256((const __m256i *) sort_network_avx2_partner[s]);
+		__m256i take_max = _mm256_loadu_si256((const __m256i *) sort_network_avx2_take_max[s]);
+
+		__m256i partner = _mm256_permutevar8x32_epi32(v, partner_index);
+		v = _mm256_blendv_epi8(_mm256_min_epi32(v, partner), _mm256_max_epi32(v, partner), take_max);
+	}
+
+	return v;
+}
+
+static inline __m256 sort_network_avx2_steps_f32(__m256 v, size_t first_step)
+{
+	for (size_t s = first_step; s < 6u; ++s)
+	{
+		__m256i partner_index = _mm256_loadu_si256((const __m256i *) sort_network_avx2_partner[s]);
+		__m256 take_max = _mm256_castsi256_ps(
+			_mm256_loadu_si256((const __m256i *) sort_network_avx2_take_max[s]));
+
+		__m256 partner = _mm256_permutevar8x32_ps(v, partner_index);
+		v = _mm256_blendv_ps(_mm256_min_ps(v, partner), _mm256_max_ps(v, partner), take_max);
+	}
+
+	return v;
+}
+
+// blocks are padded with the largest value up to 8 or 16 lanes, two
+// sorted registers are merged by reversing one and splitting min/max
+static inline void sort_network_avx2_i32(int32_t* v, size_t n)
+{
+	int32_t lanes[16];
+	for (size_t i = 0; i < 16u; ++i)
+		lanes[i] = i < n ? v[i] : INT32_MAX;
+
+	__m256i lo = sort_network_avx2_steps_i32(_mm256_loadu_si256((const __m256i *) lanes), 0u);
+
+	if (n > 8u)
+	{
+		__m256i hi = sort_network_avx2_steps_i32(_mm256_loadu_si256((const __m256i *)(lanes + 8)), 0u);
+		hi = _mm256_permutevar8x32_epi32(hi, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+
+		__m256i smaller = _mm256_min_epi32(lo, hi);
+		hi = sort_network_avx2_steps_i32(_mm256_max_epi32(lo, hi), 3u);
+		lo = sort_network_avx2_steps_i32(smaller, 3u);
+
+		_mm256_storeu_si256((__m256i *)(lanes + 8), hi);
+	}
+
+	_mm256_storeu_si256((__m256i *) lanes, lo);
+	memcpy(v, lanes, n * sizeof(int32_t));
+}
+
+static inline void sort_network_avx2_f32(float* v, size_t n)
+{
+	float lanes[16];
+	for (size_t i = 0; i < 16u; ++i)
+		lanes[i] = i < n ? v[i] : INFINITY;
+
+	__m256 lo = sort_network_avx2_steps_f32(_mm256_loadu_ps(lanes), 0u);
+
+	if (n > 8u)
+	{
+		__m256 hi = sort_network_avx2_steps_f32(_mm256_loadu_ps(lanes + 8), 0u);
+		hi = _mm256_permutevar8x32_ps(hi, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+
+		__m256 smaller = _mm256_min_ps(lo, hi);
+		hi = sort_network_avx2_steps_f32(_mm256_max_ps(lo, hi), 3u);
+		lo = sort_network_avx2_steps_f32(smaller, 3u);
+
+		_mm256_storeu_ps(lanes + 8, hi);
+	}
+
+	_mm256_storeu_ps(lanes, lo);
+	memcpy(v, lanes, n * sizeof(float));
+}
+
+#endif
+
+// ascending sort of up to SORT_NETWORK_MAX_SIZE values, larger n is ignored
+static inline void sort_network_i32(int32_t* v, size_t n)
+{
+#ifdef __AVX2__
+	if (n > 4u && n <= SORT_NETWORK_MAX_SIZE)
+	{
+		sort_network_avx2_i32(v, n);
+		return;
+	}
+#endif
+
+	sort_network_scalar_i32(v, n);
+}
+
+static inline void sort_network_f32(float* v, size_t n)
+{
+#ifdef __AVX2__
+	if (n > 4u && n <= SORT_NETWORK_MAX_SIZE)
+	{
+		sort_network_avx2_f32(v, n);
+		return;
+	}
+#endif
+
+	sort_network_scalar_f32(v, n);
+}
+
+static inline void sort_network_i64(int64_t* v, size_t n)
+{
+	sort_network_scalar_i64(v, n);
+}
+
+static inline void sort_network_f64(double* v, size_t n)
+{
+	sort_network_scalar_f64(v, n);
+}
+
+#endif
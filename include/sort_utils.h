@@ -3,12 +3,20 @@
 
 #include "heap_utils.h"
 #include "iter_utils.h"
+#include "compare_utils.h"
+#include "sort_network.h"
 
 #define POINTER_SIZE sizeof(void *)
 
+// elements up to this size get their temporary on the stack
+#define SORT_STACK_BUFFER_SIZE (64u)
+
 static void heap_sort(void* begin, void* end,
 			  		  size_t elem_size, comparator cmp)
 {
+	if ((size_t)((uint8_t *)end - (uint8_t *)begin) < 2u * elem_size)
+		return;
+
 	heap_construct(begin, end, elem_size, cmp);
 
 	uint8_t* end_ptr = (uint8_t *)end;
@@ -16,15 +24,52 @@ static void heap_sort(void* begin, void* end,
 
 	for (uint8_t* iter = prev_end; iter != begin; iter = iter_prev(iter, elem_size))
 	{
-		iter_swap(begin, iter, elem_size);
+		iter_swap_inplace(begin, iter, elem_size);
 		end_ptr = iter_prev(end_ptr, elem_size);
 		heap_down(begin, end_ptr, 0, elem_size, cmp);
 	}
 }
 
+// heap_sort on bottom-up sifts: about half the comparisons and moves
+// instead of swaps, worth it when cmp is expensive. Same ordering
+// convention as heap_sort (greater_than_i32 => ascending).
+static void heap_sort_bottom_up(void* begin, void* end,
+								size_t elem_size, comparator cmp)
+{
+	uint8_t* base = (uint8_t *) begin;
+	size_t n = (size_t)((uint8_t *)end - base) / elem_size;
+
+	if (n < 2)
+		return;
+
+	uint8_t buffer[SORT_STACK_BUFFER_SIZE];
+	uint8_t* tmp = buffer;
+
+	if (elem_size > SORT_STACK_BUFFER_SIZE)
+	{
+		tmp = (uint8_t *) malloc(elem_size);
+		if (!tmp) return;
+	}
+
+	heap_construct_bottom_up(begin, end, elem_size, cmp, tmp);
+
+	for (size_t last = n - 1; last; --last)
+	{
+		// the top moves to its final slot, the old last element refills the hole
+		iter_copy(tmp, base + (last * elem_size), elem_size);
+		iter_copy(base + (last * elem_size), base, elem_size);
+		heap_sift_bottom_up(base, last, 0, elem_size, cmp, tmp);
+	}
+
+	if (tmp != buffer) free(tmp);
+}
+
 static void insertion_sort(void* begin, void* end,
 			  		  	   size_t elem_size, comparator cmp)
 {
+	if ((size_t)((uint8_t *)end - (uint8_t *)begin) < 2u * elem_size)
+		return;
+
 	bool b = elem_size > POINTER_SIZE;
 	static uint8_t buffer[POINTER_SIZE] = {0};
 	uint8_t* key = &buffer[0];
@@ -58,4 +103,962 @@ static void insertion_sort(void* begin, void* end,
 	if (b) free(key);
 }
 
+static bool is_sorted(const void* begin, const void* end,
+					  size_t elem_size, comparator cmp)
+{
+	const uint8_t* iter = (const uint8_t *) begin;
+	const uint8_t* last = (const uint8_t *) end;
+
+	if (iter == last)
+		return true;
+
+	for (const uint8_t* next = iter + elem_size; next != last; iter = next, next += elem_size)
+		if (cmp(next, iter, elem_size))
+			return false;
+
+	return true;
+}
+
+// intro_sort orders [begin, end) so that cmp(a, b) holds whenever a must
+// come before b (less_than_i32 => ascending), the same convention as
+// insertion_sort.
+#define INTRO_SORT_INSERTION_THRESHOLD (24u)
+#define INTRO_SORT_NINTHER_THRESHOLD   (128u)
+#define INTRO_SORT_PARTIAL_INSERTION_LIMIT (8u)
+
+static inline uint8_t* sort_at(uint8_t* base, size_t index, size_t elem_size)
+{
+	return base + (index * elem_size);
+}
+
+static inline size_t sort_log2(size_t n)
+{
+	size_t log = 0u;
+
+	while (n >>= 1u)
+		++log;
+
+	return log;
+}
+
+static void sort_insertion(uint8_t* base, size_t n, size_t elem_size,
+						   comparator cmp, uint8_t* key)
+{
+	for (size_t i = 1; i < n; ++i)
+	{
+		uint8_t* iter = sort_at(base, i, elem_size);
+		uint8_t* prev = iter - elem_size;
+
+		if (!cmp(iter, prev, elem_size))
+			continue;
+
+		iter_copy(key, iter, elem_size);
+
+		do
+		{
+			iter_copy(iter, prev, elem_size);
+			iter = prev;
+			prev -= elem_size;
+		} while (iter != base && cmp(key, prev, elem_size));
+
+		iter_copy(iter, key, elem_size);
+	}
+}
+
+// insertion sort that gives up after a few moves, used to finish
+// ranges that a partition left (almost) untouched
+static bool sort_partial_insertion(uint8_t* base, size_t n, size_t elem_size,
+								   comparator cmp, uint8_t* key)
+{
+	size_t moves = 0u;
+
+	for (size_t i = 1; i < n; ++i)
+	{
+		uint8_t* iter = sort_at(base, i, elem_size);
+		uint8_t* prev = iter - elem_size;
+
+		if (!cmp(iter, prev, elem_size))
+			continue;
+
+		iter_copy(key, iter, elem_size);
+
+		do
+		{
+			iter_copy(iter, prev, elem_size);
+			iter = prev;
+			prev -= elem_size;
+			++moves;
+		} while (iter != base && cmp(key, prev, elem_size));
+
+		iter_copy(iter, key, elem_size);
+
+		if (moves > INTRO_SORT_PARTIAL_INSERTION_LIMIT)
+			return false;
+	}
+
+	return true;
+}
+
+static void sort_heap_sift(uint8_t* base, size_t index, size_t n,
+						   size_t elem_size, comparator cmp, uint8_t* hole)
+{
+	// max-heap under cmp, elements move into the hole instead of swapping
+	iter_copy(hole, sort_at(base, index, elem_size), elem_size);
+
+	for (size_t child = heap_left(index); child < n; child = heap_left(index))
+	{
+		if (child + 1 < n && cmp(sort_at(base, child, elem_size),
+								 sort_at(base, child + 1, elem_size), elem_size))
+		{
+			++child;
+		}
+
+		if (!cmp(hole, sort_at(base, child, elem_size), elem_size))
+			break;
+
+		iter_copy(sort_at(base, index, elem_size), sort_at(base, child, elem_size), elem_size);
+		index = child;
+	}
+
+	iter_copy(sort_at(base, index, elem_size), hole, elem_size);
+}
+
+static void sort_heap_fallback(uint8_t* base, size_t n, size_t elem_size,
+							   comparator cmp, uint8_t* hole)
+{
+	for (size_t index = n >> 1; index; --index)
+		sort_heap_sift(base, index - 1, n, elem_size, cmp, hole);
+
+	for (size_t last = n - 1; last; --last)
+	{
+		iter_swap_inplace(base, sort_at(base, last, elem_size), elem_size);
+		sort_heap_sift(base, 0, last, elem_size, cmp, hole);
+	}
+}
+
+static void sort_three(uint8_t* a, uint8_t* b, uint8_t* c,
+					   size_t elem_size, comparator cmp)
+{
+	if (cmp(b, a, elem_size))
+		iter_swap_inplace(a, b, elem_size);
+
+	if (cmp(c, b, elem_size))
+	{
+		iter_swap_inplace(b, c, elem_size);
+
+		if (cmp(b, a, elem_size))
+			iter_swap_inplace(a, b, elem_size);
+	}
+}
+
+// moves the pivot (median of three, or ninther for big ranges) to base[0]
+static void intro_sort_choose_pivot(uint8_t* base, size_t n,
+									size_t elem_size, comparator cmp)
+{
+	size_t mid = n >> 1;
+
+	if (n > INTRO_SORT_NINTHER_THRESHOLD)
+	{
+		sort_three(sort_at(base, 0, elem_size), sort_at(base, mid, elem_size),
+				   sort_at(base, n - 1, elem_size), elem_size, cmp);
+		sort_three(sort_at(base, 1, elem_size), sort_at(base, mid - 1, elem_size),
+				   sort_at(base, n - 2, elem_size), elem_size, cmp);
+		sort_three(sort_at(base, 2, elem_size), sort_at(base, mid + 1, elem_size),
+				   sort_at(base, n - 3, elem_size), elem_size, cmp);
+		sort_three(sort_at(base, mid - 1, elem_size), sort_at(base, mid, elem_size),
+				   sort_at(base, mid + 1, elem_size), elem_size, cmp);
+	}
+	else
+	{
+		sort_three(sort_at(base, 1, elem_size), sort_at(base, mid, elem_size),
+				   sort_at(base, n - 1, elem_size), elem_size, cmp);
+	}
+
+	iter_swap_inplace(base, sort_at(base, mid, elem_size), elem_size);
+}
+
+// Hoare partition around base[0], returns the final pivot index
+static size_t intro_sort_partition(uint8_t* base, size_t n, size_t elem_size,
+								   comparator cmp, bool* already_partitioned)
+{
+	size_t i = 1;
+	size_t j = n - 1;
+	bool swapped = false;
+
+	for (;;)
+	{
+		while (i <= j && cmp(sort_at(base, i, elem_size), base, elem_size))
+			++i;
+
+		while (i <= j && cmp(base, sort_at(base, j, elem_size), elem_size))
+			--j;
+
+		if (i >= j)
+			break;
+
+		iter_swap_inplace(sort_at(base, i, elem_size), sort_at(base, j, elem_size), elem_size);
+		swapped = true;
+		++i;
+		--j;
+	}
+
+	if (j)
+		iter_swap_inplace(base, sort_at(base, j, elem_size), elem_size);
+
+	*already_partitioned = !swapped;
+	return j;
+}
+
+// with network_leaf (ascending int32 only) blocks end in the branchless
+// network instead of insertion sort, so partitioning stops at its size
+static void intro_sort_loop(uint8_t* base, size_t n, size_t elem_size,
+							comparator cmp, size_t depth_limit, uint8_t* tmp,
+							bool network_leaf)
+{
+	size_t leaf_size = network_leaf ? SORT_NETWORK_MAX_SIZE : INTRO_SORT_INSERTION_THRESHOLD;
+
+	while (n > leaf_size)
+	{
+		if (!depth_limit)
+		{
+			sort_heap_fallback(base, n, elem_size, cmp, tmp);
+			return;
+		}
+
+		--depth_limit;
+
+		intro_sort_choose_pivot(base, n, elem_size, cmp);
+
+		bool already_partitioned = false;
+		size_t pivot = intro_sort_partition(base, n, elem_size, cmp, &already_partitioned);
+
+		uint8_t* right = sort_at(base, pivot + 1, elem_size);
+		size_t left_n = pivot;
+		size_t right_n = n - pivot - 1;
+
+		bool unbalanced = left_n < (n >> 3) || right_n < (n >> 3);
+
+		if (unbalanced)
+		{
+			// break up patterns that defeat the pivot selection
+			if (left_n >= INTRO_SORT_INSERTION_THRESHOLD)
+			{
+				iter_swap_inplace(base, sort_at(base, left_n >> 2, elem_size), elem_size);
+				iter_swap_inplace(sort_at(base, left_n - 1, elem_size),
+								  sort_at(base, left_n - (left_n >> 2), elem_size), elem_size);
+			}
+
+			if (right_n >= INTRO_SORT_INSERTION_THRESHOLD)
+			{
+				iter_swap_inplace(right, sort_at(right, right_n >> 2, elem_size), elem_size);
+				iter_swap_inplace(sort_at(right, right_n - 1, elem_size),
+								  sort_at(right, right_n - (right_n >> 2), elem_size), elem_size);
+			}
+		}
+		else if (already_partitioned &&
+				 sort_partial_insertion(base, left_n, elem_size, cmp, tmp) &&
+				 sort_partial_insertion(right, right_n, elem_size, cmp, tmp))
+		{
+			return;
+		}
+
+		// recurse into the smaller side, loop on the bigger one
+		if (left_n < right_n)
+		{
+			intro_sort_loop(base, left_n, elem_size, cmp, depth_limit, tmp, network_leaf);
+			base = right;
+			n = right_n;
+		}
+		else
+		{
+			intro_sort_loop(right, right_n, elem_size, cmp, depth_limit, tmp, network_leaf);
+			n = left_n;
+		}
+	}
+
+	if (network_leaf)
+		sort_network_i32((int32_t *) base, n);
+	else
+		sort_insertion(base, n, elem_size, cmp, tmp);
+}
+
+static void intro_sort_run(void* begin, void* end, size_t elem_size,
+						   comparator cmp, bool network_leaf)
+{
+	uint8_t* base = (uint8_t *) begin;
+	size_t n = (size_t)((uint8_t *)end - base) / elem_size;
+
+	if (n < 2)
+		return;
+
+	// fast paths for ranges that are already sorted or reversed
+	size_t ascending = 1;
+	while (ascending < n && !cmp(sort_at(base, ascending, elem_size),
+								 sort_at(base, ascending - 1, elem_size), elem_size))
+	{
+		++ascending;
+	}
+
+	if (ascending == n)
+		return;
+
+	if (ascending == 1)
+	{
+		size_t descending = 1;
+		while (descending < n && !cmp(sort_at(base, descending - 1, elem_size),
+									  sort_at(base, descending, elem_size), elem_size))
+		{
+			++descending;
+		}
+
+		if (descending == n)
+		{
+			iter_reverse(begin, end, elem_size);
+			return;
+		}
+	}
+
+	uint8_t buffer[SORT_STACK_BUFFER_SIZE];
+	uint8_t* tmp = buffer;
+
+	if (elem_size > SORT_STACK_BUFFER_SIZE)
+	{
+		tmp = (uint8_t *) malloc(elem_size);
+		if (!tmp) return;
+	}
+
+	intro_sort_loop(base, n, elem_size, cmp, sort_log2(n) << 1, tmp, network_leaf);
+
+	if (tmp != buffer) free(tmp);
+}
+
+static void intro_sort(void* begin, void* end,
+					   size_t elem_size, comparator cmp)
+{
+	intro_sort_run(begin, end, elem_size, cmp, false);
+}
+
+// intro_sort of int32 values in ascending order, the small blocks end in
+// sort_network_i32. Comparator pointers cannot tell this case apart (a
+// static less_than_i32 has one address per translation unit), so it has
+// its own entry point.
+static void intro_sort_i32(int32_t* begin, int32_t* end)
+{
+	intro_sort_run(begin, end, sizeof(int32_t), less_than_i32, sizeof(int) == sizeof(int32_t));
+}
+
+// Introselect: reorders [begin, end) so that nth holds the element a full
+// sort would put there, nothing before it comes after it and nothing
+// after it comes before it. Average O(n), depth-limited like intro_sort.
+static void nth_element(void* begin, void* nth, void* end,
+						size_t elem_size, comparator cmp)
+{
+	uint8_t* base = (uint8_t *) begin;
+	size_t n = (size_t)((uint8_t *)end - base) / elem_size;
+	size_t k = (size_t)((uint8_t *)nth - base) / elem_size;
+
+	if (k >= n)
+		return;
+
+	uint8_t buffer[SORT_STACK_BUFFER_SIZE];
+	uint8_t* tmp = buffer;
+
+	if (elem_size > SORT_STACK_BUFFER_SIZE)
+	{
+		tmp = (uint8_t *) malloc(elem_size);
+		if (!tmp) return;
+	}
+
+	size_t depth_limit = sort_log2(n) << 1;
+
+	while (n > INTRO_SORT_INSERTION_THRESHOLD)
+	{
+		if (!depth_limit)
+			break;
+
+		--depth_limit;
+
+		intro_sort_choose_pivot(base, n, elem_size, cmp);
+
+		bool already_partitioned = false;
+		size_t pivot = intro_sort_partition(base, n, elem_size, cmp, &already_partitioned);
+
+		if (pivot == k)
+		{
+			n = 0u;
+			break;
+		}
+
+		if (k < pivot)
+			n = pivot;
+		else
+		{
+			base = sort_at(base, pivot + 1, elem_size);
+			k -= pivot + 1;
+			n -= pivot + 1;
+		}
+	}
+
+	// small range, or too many bad pivots: finish with a guaranteed sort
+	if (n > INTRO_SORT_INSERTION_THRESHOLD)
+		sort_heap_fallback(base, n, elem_size, cmp, tmp);
+	else if (n > 1)
+		sort_insertion(base, n, elem_size, cmp, tmp);
+
+	if (tmp != buffer) free(tmp);
+}
+
+// sorts the first (middle - begin) elements of what a full sort would
+// produce, the order of [middle, end) is unspecified
+static void partial_sort(void* begin, void* middle, void* end,
+						 size_t elem_size, comparator cmp)
+{
+	if (middle == begin)
+		return;
+
+	uint8_t* last = (uint8_t *) middle - elem_size;
+
+	nth_element(begin, last, end, elem_size, cmp);
+	intro_sort(begin, last, elem_size, cmp);
+}
+
+// Stable, run-adaptive merge sort (timsort): natural runs are found and
+// extended to a minimum length with binary insertion, then merged with
+// galloping. Same cmp convention as intro_sort; equal elements keep their
+// order. Merges use a scratch buffer of up to half the input and fall back
+// to rotation-based in-place merges when it is smaller than that.
+#define MERGE_SORT_MIN_MERGE  (32u)
+#define MERGE_SORT_MIN_GALLOP (7u)
+#define MERGE_SORT_MAX_RUNS   (128u)
+
+// scratch cap of merge_sort_stable, bigger merges run in place
+#ifndef MERGE_SORT_MAX_BUFFER_SIZE
+	#define MERGE_SORT_MAX_BUFFER_SIZE ((size_t) 256u << 20)
+#endif
+
+typedef struct merge_sort_state_struct
+{
+	uint8_t* base;
+	size_t elem_size;
+	comparator cmp;
+	uint8_t* buffer;
+	size_t buffer_elems;
+	size_t min_gallop;
+	size_t run_start[MERGE_SORT_MAX_RUNS];
+	size_t run_len[MERGE_SORT_MAX_RUNS];
+	size_t nruns;
+} merge_sort_state;
+
+// Finds how many elements of base[0, n) go before key: with right set the
+// ones not after it (upper bound), otherwise the ones before it (lower
+// bound). Probes 1, 3, 7... from the start, or from the end with from_end,
+// then binary searches the last gap.
+static size_t merge_sort_gallop(const uint8_t* key, const uint8_t* base, size_t n,
+								size_t elem_size, comparator cmp, bool right, bool from_end)
+{
+	#define MERGE_SORT_BEFORE(i) (right ? !cmp(key, sort_at((uint8_t *) base, (i), elem_size), elem_size) \
+										: cmp(sort_at((uint8_t *) base, (i), elem_size), key, elem_size))
+
+	size_t lo = 0u;
+	size_t hi = n;
+
+	if (!from_end)
+	{
+		size_t ofs = 1u;
+		while (ofs <= n && MERGE_SORT_BEFORE(ofs - 1))
+		{
+			lo = ofs;
+			ofs = (ofs << 1) + 1u;
+		}
+
+		hi = ofs <= n ? ofs - 1u : n;
+	}
+	else
+	{
+		size_t ofs = 1u;
+		while (ofs <= n && !MERGE_SORT_BEFORE(n - ofs))
+		{
+			hi = n - ofs;
+			ofs = (ofs << 1) + 1u;
+		}
+
+		lo = ofs <= n ? n - ofs + 1u : 0u;
+	}
+
+	while (lo < hi)
+	{
+		size_t mid = lo + ((hi - lo) >> 1);
+
+		if (MERGE_SORT_BEFORE(mid))
+			lo = mid + 1u;
+		else
+			hi = mid;
+	}
+
+	#undef MERGE_SORT_BEFORE
+
+	return lo;
+}
+
+// 32..64, so n / minrun is a power of two or just below one
+static size_t merge_sort_min_run(size_t n)
+{
+	size_t extra = 0u;
+
+	while (n >= 2u * MERGE_SORT_MIN_MERGE)
+	{
+		extra |= n & 1u;
+		n >>= 1;
+	}
+
+	return n + extra;
+}
+
+// length of the run at base, strictly descending runs are reversed
+static size_t merge_sort_count_run(uint8_t* base, size_t n, size_t elem_size, comparator cmp)
+{
+	if (n < 2)
+		return n;
+
+	size_t len = 2u;
+
+	if (cmp(sort_at(base, 1, elem_size), base, elem_size))
+	{
+		while (len < n && cmp(sort_at(base, len, elem_size), sort_at(base, len - 1, elem_size), elem_size))
+			++len;
+
+		iter_reverse(base, sort_at(base, len, elem_size), elem_size);
+	}
+	else
+	{
+		while (len < n && !cmp(sort_at(base, len, elem_size), sort_at(base, len - 1, elem_size), elem_size))
+			++len;
+	}
+
+	return len;
+}
+
+// base[0, sorted) is sorted, inserts the rest after their equals
+static void merge_sort_binary_insertion(uint8_t* base, size_t n, size_t sorted,
+										size_t elem_size, comparator cmp, uint8_t* tmp)
+{
+	for (size_t i = sorted; i < n; ++i)
+	{
+		uint8_t* elem = sort_at(base, i, elem_size);
+		size_t pos = merge_sort_gallop(elem, base, i, elem_size, cmp, true, true);
+
+		if (pos == i)
+			continue;
+
+		iter_copy(tmp, elem, elem_size);
+		memmove(sort_at(base, pos + 1, elem_size), sort_at(base, pos, elem_size), (i - pos) * elem_size);
+		iter_copy(sort_at(base, pos, elem_size), tmp, elem_size);
+	}
+}
+
+// a = [0, len1) and b = [len1, len1 + len2), len1 <= buffer_elems: a goes
+// to the buffer and the merge fills the range front to back
+static void merge_sort_merge_lo(merge_sort_state* state, uint8_t* a, size_t len1, size_t len2)
+{
+	size_t elem_size = state->elem_size;
+	comparator cmp = state->cmp;
+
+	memcpy(state->buffer, a, len1 * elem_size);
+
+	uint8_t* c1 = state->buffer;
+	uint8_t* c2 = a + (len1 * elem_size);
+	uint8_t* dest = a;
+	size_t min_gallop = state->min_gallop;
+
+	while (len1 && len2)
+	{
+		size_t wins1 = 0u;
+		size_t wins2 = 0u;
+
+		// one element at a time until one side keeps winning
+		while (len1 && len2 && (wins1 | wins2) < min_gallop)
+		{
+			if (cmp(c2, c1, elem_size))
+			{
+				iter_copy(dest, c2, elem_size);
+				c2 += elem_size;
+				--len2;
+				++wins2;
+				wins1 = 0u;
+			}
+			else
+			{
+				iter_copy(dest, c1, elem_size);
+				c1 += elem_size;
+				--len1;
+				++wins1;
+				wins2 = 0u;
+			}
+
+			dest += elem_size;
+		}
+
+		// galloping: copy whole blocks found by exponential search
+		while (len1 && len2)
+		{
+			size_t k1 = merge_sort_gallop(c2, c1, len1, elem_size, cmp, true, false);
+			memcpy(dest, c1, k1 * elem_size);
+			dest += k1 * elem_size;
+			c1 += k1 * elem_size;
+			len1 -= k1;
+
+			if (!len1)
+				break;
+
+			iter_copy(dest, c2, elem_size);
+			dest += elem_size;
+			c2 += elem_size;
+
+			if (!--len2)
+				break;
+
+			size_t k2 = merge_sort_gallop(c1, c2, len2, elem_size, cmp, false, false);
+			memmove(dest, c2, k2 * elem_size);
+			dest += k2 * elem_size;
+			c2 += k2 * elem_size;
+			len2 -= k2;
+
+			if (!len2)
+				break;
+
+			iter_copy(dest, c1, elem_size);
+			dest += elem_size;
+			c1 += elem_size;
+
+			if (!--len1)
+				break;
+
+			min_gallop -= min_gallop > 1u;
+
+			if (k1 < MERGE_SORT_MIN_GALLOP && k2 < MERGE_SORT_MIN_GALLOP)
+			{
+				min_gallop += 2u;
+				break;
+			}
+		}
+	}
+
+	// the rest of b is already in place
+	if (len1)
+		memcpy(dest, c1, len1 * elem_size);
+
+	state->min_gallop = min_gallop ? min_gallop : 1u;
+}
+
+// mirror of merge_sort_merge_lo for len2 <= buffer_elems: b goes to the
+// buffer and the merge fills the range back to front
+static void merge_sort_merge_hi(merge_sort_state* state, uint8_t* a, size_t len1, size_t len2)
+{
+	size_t elem_size = state->elem_size;
+	comparator cmp = state->cmp;
+
+	uint8_t* b = a + (len1 * elem_size);
+	memcpy(state->buffer, b, len2 * elem_size);
+
+	// cursors point one past the last unmerged element of each side
+	uint8_t* c1 = b;
+	uint8_t* c2 = state->buffer + (len2 * elem_size);
+	uint8_t* dest = b + (len2 * elem_size);
+	size_t min_gallop = state->min_gallop;
+
+	while (len1 && len2)
+	{
+		size_t wins1 = 0u;
+		size_t wins2 = 0u;
+
+		while (len1 && len2 && (wins1 | wins2) < min_gallop)
+		{
+			dest -= elem_size;
+
+			// on ties the element of b is the later one
+			if (cmp(c2 - elem_size, c1 - elem_size, elem_size))
+			{
+				c1 -= elem_size;
+				iter_copy(dest, c1, elem_size);
+				--len1;
+				++wins1;
+				wins2 = 0u;
+			}
+			else
+			{
+				c2 -= elem_size;
+				iter_copy(dest, c2, elem_size);
+				--len2;
+				++wins2;
+				wins1 = 0u;
+			}
+		}
+
+		while (len1 && len2)
+		{
+			// elements of a that go after the last of b
+			size_t k1 = len1 - merge_sort_gallop(c2 - elem_size, a, len1, elem_size, cmp, true, true);
+			dest -= k1 * elem_size;
+			c1 -= k1 * elem_size;
+			memmove(dest, c1, k1 * elem_size);
+			len1 -= k1;
+
+			if (!len1)
+				break;
+
+			dest -= elem_size;
+			c2 -= elem_size;
+			iter_copy(dest, c2, elem_size);
+
+			if (!--len2)
+				break;
+
+			// elements of b that go after the last of a
+			size_t k2 = len2 - merge_sort_gallop(c1 - elem_size, state->buffer, len2, elem_size, cmp, false, true);
+			dest -= k2 * elem_size;
+			c2 -= k2 * elem_size;
+			memcpy(dest, c2, k2 * elem_size);
+			len2 -= k2;
+
+			if (!len2)
+				break;
+
+			dest -= elem_size;
+			c1 -= elem_size;
+			iter_copy(dest, c1, elem_size);
+
+			if (!--len1)
+				break;
+
+			min_gallop -= min_gallop > 1u;
+
+			if (k1 < MERGE_SORT_MIN_GALLOP && k2 < MERGE_SORT_MIN_GALLOP)
+			{
+				min_gallop += 2u;
+				break;
+			}
+		}
+	}
+
+	// the rest of a is already in place
+	if (len2)
+		memcpy(a, state->buffer, len2 * elem_size);
+
+	state->min_gallop = min_gallop ? min_gallop : 1u;
+}
+
+// merges the adjacent sorted ranges a = [0, len1) and b = [len1, len1 + len2)
+static void merge_sort_merge(merge_sort_state* state, uint8_t* a, size_t len1, size_t len2)
+{
+	size_t elem_size = state->elem_size;
+	comparator cmp = state->cmp;
+
+	for (;;)
+	{
+		// the rotation below can leave either side empty, and b is then
+		// one past the range: nothing to merge, and *b must not be read
+		if (!len1 || !len2)
+			return;
+
+		uint8_t* b = a + (len1 * elem_size);
+
+		// the head of a and the tail of b are already in place
+		size_t skip = merge_sort_gallop(b, a, len1, elem_size, cmp, true, false);
+		a += skip * elem_size;
+		len1 -= skip;
+
+		if (!len1)
+			return;
+
+		len2 = merge_sort_gallop(sort_at(a, len1 - 1, elem_size), b, len2, elem_size, cmp, false, true);
+
+		if (!len2)
+			return;
+
+		if (len1 <= len2 && len1 <= state->buffer_elems)
+		{
+			merge_sort_merge_lo(state, a, len1, len2);
+			return;
+		}
+
+		if (len2 < len1 && len2 <= state->buffer_elems)
+		{
+			merge_sort_merge_hi(state, a, len1, len2);
+			return;
+		}
+
+		// too big for the buffer: split both halves around a pivot, rotate
+		// the middle into place and merge each side separately
+		size_t cut1 = 0u;
+		size_t cut2 = 0u;
+
+		if (len1 >= len2)
+		{
+			cut1 = len1 >> 1;
+			cut2 = merge_sort_gallop(sort_at(a, cut1, elem_size), b, len2, elem_size, cmp, false, false);
+		}
+		else
+		{
+			cut2 = len2 >> 1;
+			cut1 = merge_sort_gallop(sort_at(b, cut2, elem_size), a, len1, elem_size, cmp, true, false);
+		}
+
+		uint8_t* first = sort_at(a, cut1, elem_size);
+		uint8_t* last = sort_at(b, cut2, elem_size);
+
+		iter_reverse(first, b, elem_size);
+		iter_reverse(b, last, elem_size);
+		iter_reverse(first, last, elem_size);
+
+		// recurse on the smaller side, loop on the bigger one
+		uint8_t* mid = sort_at(a, cut1 + cut2, elem_size);
+		size_t left1 = cut1, left2 = cut2;
+		size_t right1 = len1 - cut1, right2 = len2 - cut2;
+
+		if (left1 + left2 < right1 + right2)
+		{
+			merge_sort_merge(state, a, left1, left2);
+			a = mid;
+			len1 = right1;
+			len2 = right2;
+		}
+		else
+		{
+			merge_sort_merge(state, mid, right1, right2);
+			len1 = left1;
+			len2 = left2;
+		}
+	}
+}
+
+static void merge_sort_merge_at(merge_sort_state* state, size_t i)
+{
+	merge_sort_merge(state, sort_at(state->base, state->run_start[i], state->elem_size),
+					 state->run_len[i], state->run_len[i + 1]);
+
+	state->run_len[i] += state->run_len[i + 1];
+
+	if (i + 3 == state->nruns)
+	{
+		state->run_start[i + 1] = state->run_start[i + 2];
+		state->run_len[i + 1] = state->run_len[i + 2];
+	}
+
+	--state->nruns;
+}
+
+// keeps run lengths growing at least like Fibonacci numbers from the top
+// of the stack down, so the stack stays logarithmic and merges balanced
+static void merge_sort_collapse(merge_sort_state* state)
+{
+	size_t* len = state->run_len;
+
+	while (state->nruns > 1)
+	{
+		size_t i = state->nruns - 2;
+
+		if ((i > 0 && len[i - 1] <= len[i] + len[i + 1]) ||
+			(i > 1 && len[i - 2] <= len[i - 1] + len[i]))
+		{
+			if (len[i - 1] < len[i + 1])
+				--i;
+		}
+		else if (len[i] > len[i + 1])
+			break;
+
+		merge_sort_merge_at(state, i);
+	}
+}
+
+// merge_sort_stable with a caller-supplied scratch buffer of buffer_elems
+// elements (any size, 0 included); (n + 1) / 2 elements keep every merge
+// linear. Returns false only if elem_size > SORT_STACK_BUFFER_SIZE, the
+// buffer is empty and the one-element temporary cannot be allocated.
+static bool merge_sort_stable_buffer(void* begin, void* end, size_t elem_size, comparator cmp,
+									 void* buffer, size_t buffer_elems)
+{
+	uint8_t* base = (uint8_t *) begin;
+	size_t n = (size_t)((uint8_t *)end - base) / elem_size;
+
+	if (n < 2)
+		return true;
+
+	if (!buffer)
+		buffer_elems = 0u;
+
+	uint8_t stack_buffer[SORT_STACK_BUFFER_SIZE];
+	uint8_t* tmp = buffer_elems ? (uint8_t *) buffer : stack_buffer;
+
+	if (!buffer_elems && elem_size > SORT_STACK_BUFFER_SIZE)
+	{
+		tmp = (uint8_t *) malloc(elem_size);
+		if (!tmp) return false;
+	}
+
+	merge_sort_state* state = &(merge_sort_state){
+		.base = base,
+		.elem_size = elem_size,
+		.cmp = cmp,
+		.buffer = (uint8_t *) buffer,
+		.buffer_elems = buffer_elems,
+		.min_gallop = MERGE_SORT_MIN_GALLOP
+	};
+
+	size_t min_run = merge_sort_min_run(n);
+
+	for (size_t start = 0; start < n; )
+	{
+		uint8_t* run = sort_at(base, start, elem_size);
+		size_t remaining = n - start;
+		size_t len = merge_sort_count_run(run, remaining, elem_size, cmp);
+
+		// short runs are extended to min_run with binary insertion
+		if (len < min_run)
+		{
+			size_t forced = remaining < min_run ? remaining : min_run;
+			merge_sort_binary_insertion(run, forced, len, elem_size, cmp, tmp);
+			len = forced;
+		}
+
+		state->run_start[state->nruns] = start;
+		state->run_len[state->nruns] = len;
+		++state->nruns;
+
+		merge_sort_collapse(state);
+		start += len;
+	}
+
+	while (state->nruns > 1)
+	{
+		size_t i = state->nruns - 2;
+
+		if (i > 0 && state->run_len[i - 1] < state->run_len[i + 1])
+			--i;
+
+		merge_sort_merge_at(state, i);
+	}
+
+	if (tmp != stack_buffer && tmp != buffer) free(tmp);
+	return true;
+}
+
+// allocates up to (n + 1) / 2 elements of scratch (capped at
+// MERGE_SORT_MAX_BUFFER_SIZE bytes) and falls back to in-place merges
+// when that is not possible
+static bool merge_sort_stable(void* begin, void* end, size_t elem_size, comparator cmp)
+{
+	size_t n = (size_t)((uint8_t *)end - (uint8_t *)begin) / elem_size;
+	size_t buffer_elems = (n + 1) >> 1;
+
+	if (buffer_elems > MERGE_SORT_MAX_BUFFER_SIZE / elem_size)
+		buffer_elems = MERGE_SORT_MAX_BUFFER_SIZE / elem_size;
+
+	void* buffer = n >= 2 && buffer_elems ? malloc(buffer_elems * elem_size) : NULL;
+
+	bool success = merge_sort_stable_buffer(begin, end, elem_size, cmp,
+											buffer, buffer ? buffer_elems : 0u);
+	free(buffer);
+	return success;
+}
+
 #endif
@@ -0,0 +1,20 @@
+#ifndef TOP_K_H
+#define TOP_K_H
+
+#define TOP_K_API
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "heap_utils.h"
+
+// Streams [begin, end) once and writes the min(k, n) elements that a full
+// sort (same convention as intro_sort) would put first into out, in sorted
+// order. Keeps a bounded scoped_heap of the k best elements seen so far
+// whose top is the worst of them, so most elements cost one comparison:
+// O(k) memory and O(n + k log k log(n / k)) expected time.
+TOP_K_API
+bool select_top_k(const void* begin, const void* end, size_t k,
+				  size_t elem_size, comparator cmp, void* out);
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#define WORKLOAD_API
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// key shapes
+#define WORKLOAD_KEYS_UNIFORM    (0u)
+#define WORKLOAD_KEYS_SEQUENTIAL (1u)
+#define WORKLOAD_KEYS_STRIDED    (2u)
+#define WORKLOAD_KEYS_CLUSTERED  (3u)
+#define WORKLOAD_KEYS_ZIPF       (4u)
+#define WORKLOAD_KEYS_COUNT      (5u)
+
+// which present keys the hits of an op stream go to
+#define WORKLOAD_ACCESS_UNIFORM (0u)
+#define WORKLOAD_ACCESS_ZIPF    (1u)
+
+#define WORKLOAD_OP_GET    (0u)
+#define WORKLOAD_OP_INSERT (1u)
+#define WORKLOAD_OP_REMOVE (2u)
+
+#define WORKLOAD_DEFAULT_STRIDE        (1024u)
+#define WORKLOAD_DEFAULT_CLUSTERS      (16u)
+#define WORKLOAD_DEFAULT_ZIPF_EXPONENT (0.99)
+
+// keys never reach the sign bit, so they are valid hash_table keys
+#define WORKLOAD_KEY_MASK (UINT64_C(0x7FFFFFFFFFFFFFFF))
+
+typedef struct workload_keys_struct
+{
+	uint8_t shape;        // WORKLOAD_KEYS_*
+	uint64_t base;        // first key (sequential, strided)
+	uint64_t range;       // keys are reduced modulo range, 0 = no limit
+	uint64_t stride;      // strided, 0 = WORKLOAD_DEFAULT_STRIDE
+	size_t clusters;      // clustered, 0 = WORKLOAD_DEFAULT_CLUSTERS
+	double zipf_exponent; // zipf, 0 = WORKLOAD_DEFAULT_ZIPF_EXPONENT
+} workload_keys;
+
+typedef struct workload_mix_struct
+{
+	size_t preload;       // distinct keys inserted before the first op
+	size_t nops;
+	double get_ratio;     // the remaining ops are removes
+	double insert_ratio;
+	double hit_rate;      // share of gets and removes that find their key
+	uint8_t access;       // WORKLOAD_ACCESS_*
+	double zipf_exponent; // zipf access, 0 = WORKLOAD_DEFAULT_ZIPF_EXPONENT
+} workload_mix;
+
+typedef struct workload_op_struct
+{
+	uint64_t key;
+	uint8_t type; // WORKLOAD_OP_*
+	bool hit;     // whether the key is in the table when the op runs
+} workload_op;
+
+typedef struct workload_trace_struct
+{
+	uint64_t* preload;
+	size_t npreload;
+	workload_op* ops;
+	size_t nops;
+} workload_trace;
+
+WORKLOAD_API
+const char* workload_keys_name(uint8_t shape);
+
+// Writes n keys of the given shape. Uniform and zipf keys repeat (zipf
+// ranks are scattered over the range so hot keys are not neighbours),
+// the other shapes only repeat once they wrap around the range.
+WORKLOAD_API
+bool workload_generate_keys(uint64_t* keys, size_t n, const workload_keys* config, uint64_t seed);
+
+// Builds a replayable op trace: preload keys first, then gets, inserts
+// and removes in the mix ratios. Inserted keys are always new, the keys
+// come from a duplicate-free stream of the given shape (zipf is rejected,
+// skew belongs to mix->access). Every op records whether it should hit,
+// so a replay can check the table it drives. Release with
+// workload_trace_release.
+WORKLOAD_API
+bool workload_trace_create(workload_trace* trace, const workload_keys* keys,
+						   const workload_mix* mix, uint64_t seed);
+
+WORKLOAD_API
+void workload_trace_release(workload_trace* trace);
+
+#endif
@@ -0,0 +1,626 @@
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include "../include/utils.h"
+#include "../include/extendible_hash.h"
+
+// Segments, directories and values are reference counted so that
+// snapshots can share them with the table. Only the writer mutates, and
+// only objects it holds the single reference to; anything shared is
+// copied first, so snapshot readers never see a write and take no lock.
+
+typedef union extendible_hash_value_struct
+{
+	atomic_size_t refs;
+	max_align_t align; // the user value follows, aligned like malloc's
+} extendible_hash_value;
+
+typedef struct extendible_hash_segment_struct
+{
+	atomic_size_t refs; // directories pointing to the segment
+	size_t size;
+	size_t deleted;
+	uint8_t local_depth;
+	hash_entry slots[];
+} extendible_hash_segment;
+
+typedef struct extendible_hash_directory_struct
+{
+	atomic_size_t refs; // the table and its snapshots
+	uint8_t global_depth;
+	extendible_hash_segment* segments[]; // 2^global_depth entries
+} extendible_hash_directory;
+
+typedef struct extendible_hash_probing_struct
+{
+	size_t segment_slots;
+	hash_function_t hash_fptr;
+	hash_prob_method_t hash_prob_method;
+} extendible_hash_probing;
+
+struct extendible_hash_struct
+{
+	extendible_hash_directory* directory;
+	extendible_hash_probing probing;
+	size_t limit;    // size + deleted that makes a segment split
+	size_t size;
+	size_t segments;
+	size_t copies;
+	extendible_hash_segment* spare; // target of the next split or rebuild
+};
+
+struct extendible_hash_snapshot_struct
+{
+	extendible_hash_directory* directory;
+	extendible_hash_probing probing;
+	size_t size;
+};
+
+// splitmix64 finalizer, a bijection: distinct keys end up in distinct
+// directory paths once the directory is deep enough
+static inline uint64_t extendible_hash_mix(ssize_t key)
+{
+	uint64_t h = (uint64_t) key;
+	h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+	return h ^ (h >> 31);
+}
+
+// hash_prob_method_double_hashing without its tetrahedral term: with an
+// odd step x1 + k * x2 visits every slot of a power-of-two segment, the
+// extra term left some keys only about half of the segment to probe
+static size_t extendible_hash_prob_double_hashing(ssize_t key, size_t k, size_t m, hash_function_t h1)
+{
+	hash_function_t h2 = (h1 == hash_by_fnv) ? hash_by_division : hash_by_fnv;
+
+	key &= HASH_SSIZE_MAX;
+	return (h1(key, m) + k * (h2(key, m) | 1u)) & (m - 1u);
+}
+
+static inline size_t extendible_hash_index(uint64_t mixed, uint8_t depth)
+{
+	return depth ? (size_t)(mixed >> (64u - depth)) : 0u;
+}
+
+static void* extendible_hash_value_create(const void* value, size_t value_size)
+{
+	extendible_hash_value* header = (extendible_hash_value *) malloc(sizeof(extendible_hash_value) + value_size);
+	if (!header)
+		return NULL;
+
+	atomic_init(&header->refs, 1u);
+	memcpy(header + 1, value, value_size);
+	return header + 1;
+}
+
+static inline void extendible_hash_value_retain(void* value)
+{
+	atomic_fetch_add_explicit(&((extendible_hash_value *) value - 1)->refs, 1u, memory_order_relaxed);
+}
+
+static inline void extendible_hash_value_release(void* value)
+{
+	extendible_hash_value* header = (extendible_hash_value *) value - 1;
+
+	if (atomic_fetch_sub_explicit(&header->refs, 1u, memory_order_acq_rel) == 1u)
+		free(header);
+}
+
+static inline size_t extendible_hash_segment_bytes(size_t slots)
+{
+	return sizeof(extendible_hash_segment) + slots * sizeof(hash_entry);
+}
+
+static void extendible_hash_segment_clear(extendible_hash_segment* segment, size_t slots)
+{
+	segment->size = 0u;
+	segment->deleted = 0u;
+
+	for (size_t i = 0; i < slots; ++i)
+		segment->slots[i] = (hash_entry){ .status = HASH_ENTRY_STATUS_FREE };
+}
+
+static extendible_hash_segment* extendible_hash_segment_create(size_t slots)
+{
+	extendible_hash_segment* segment = (extendible_hash_segment *) malloc(extendible_hash_segment_bytes(slots));
+	if (!segment)
+		return NULL;
+
+	atomic_init(&segment->refs, 1u);
+	segment->local_depth = 0u;
+	extendible_hash_segment_clear(segment, slots);
+	return segment;
+}
+
+static void extendible_hash_segment_release(extendible_hash_segment* segment, size_t slots)
+{
+	if (atomic_fetch_sub_explicit(&segment->refs, 1u, memory_order_acq_rel) != 1u)
+		return;
+
+	for (size_t i = 0; i < slots; ++i)
+		if (segment->slots[i].status == HASH_ENTRY_STATUS_OCCUPIED)
+			extendible_hash_value_release(segment->slots[i].value);
+
+	free(segment);
+}
+
+static extendible_hash_directory* extendible_hash_directory_create(uint8_t global_depth)
+{
+	size_t entries = (size_t) 1u << global_depth;
+	extendible_hash_directory* directory = (extendible_hash_directory *) malloc(sizeof(extendible_hash_directory) +
+																				entries * sizeof(extendible_hash_segment *));
+	if (!directory)
+		return NULL;
+
+	atomic_init(&directory->refs, 1u);
+	directory->global_depth = global_depth;
+	return directory;
+}
+
+// a segment with local depth d fills the 2^(global - d) consecutive
+// directory entries starting at a multiple of that span
+static inline size_t extendible_hash_span(const extendible_hash_directory* directory,
+										  const extendible_hash_segment* segment)
+{
+	return (size_t) 1u << (directory->global_depth - segment->local_depth);
+}
+
+static void extendible_hash_directory_release(extendible_hash_directory* directory, size_t slots)
+{
+	if (atomic_fetch_sub_explicit(&directory->refs, 1u, memory_order_acq_rel) != 1u)
+		return;
+
+	for (size_t i = 0; i < ((size_t) 1u << directory->global_depth); )
+	{
+		extendible_hash_segment* segment = directory->segments[i];
+		i += extendible_hash_span(directory, segment);
+		extendible_hash_segment_release(segment, slots);
+	}
+
+	free(directory);
+}
+
+// the entry holding key, or (found == false) the slot an insert should
+// take: the first tombstone of the chain, else the free slot ending it.
+// NULL when the whole probe sequence is occupied.
+static hash_entry* extendible_hash_probe(const extendible_hash_probing* probing, extendible_hash_segment* segment,
+										 ssize_t key, bool* found)
+{
+	size_t slots = probing->segment_slots;
+	size_t index = probing->hash_fptr(key, slots);
+	hash_entry* target = NULL;
+
+	*found = false;
+
+	for (size_t nprobs = 0; nprobs < slots; ++nprobs)
+	{
+		hash_entry* entry = &segment->slots[index];
+
+		if (entry->status == HASH_ENTRY_STATUS_FREE)
+			return target ? target : entry;
+
+		if (entry->status == HASH_ENTRY_STATUS_OCCUPIED && entry->key == key)
+		{
+			*found = true;
+			return entry;
+		}
+
+		if (!target && entry->status == HASH_ENTRY_STATUS_DELETED)
+			target = entry;
+
+		index = probing->hash_prob_method(key, nprobs + 1u, slots, probing->hash_fptr);
+	}
+
+	return target;
+}
+
+static void* extendible_hash_lookup(const extendible_hash_directory* directory,
+									const extendible_hash_probing* probing, ssize_t key)
+{
+	size_t index = extendible_hash_index(extendible_hash_mix(key), directory->global_depth);
+	bool found = false;
+	hash_entry* slot = extendible_hash_probe(probing, directory->segments[index], key, &found);
+
+	return found ? slot->value : NULL;
+}
+
+// moves an entry (value pointer included) into a segment being rebuilt
+static bool extendible_hash_place(const extendible_hash_probing* probing, extendible_hash_segment* segment,
+								  const hash_entry* entry)
+{
+	bool found = false;
+	hash_entry* slot = extendible_hash_probe(probing, segment, entry->key, &found);
+	if (!slot)
+		return false;
+
+	*slot = *entry;
+	++segment->size;
+	return true;
+}
+
+// first entry of the span of directory entries pointing to the segment
+// found at index
+static inline size_t extendible_hash_span_first(const extendible_hash_directory* directory, size_t index)
+{
+	size_t span = extendible_hash_span(directory, directory->segments[index]);
+	return index & ~(span - 1u);
+}
+
+// a directory only the table references, copied from a snapshot's if needed
+static bool extendible_hash_own_directory(extendible_hash* table)
+{
+	extendible_hash_directory* shared = table->directory;
+	if (atomic_load_explicit(&shared->refs, memory_order_acquire) == 1u)
+		return true;
+
+	extendible_hash_directory* directory = extendible_hash_directory_create(shared->global_depth);
+	if (!directory)
+		return false;
+
+	memcpy(directory->segments, shared->segments, ((size_t) 1u << shared->global_depth) *
+												   sizeof(extendible_hash_segment *));
+
+	for (size_t i = 0; i < ((size_t) 1u << directory->global_depth); )
+	{
+		extendible_hash_segment* segment = directory->segments[i];
+		i += extendible_hash_span(directory, segment);
+		atomic_fetch_add_explicit(&segment->refs, 1u, memory_order_relaxed);
+	}
+
+	table->directory = directory;
+	extendible_hash_directory_release(shared, table->probing.segment_slots);
+	return true;
+}
+
+// the segment at index, copied first if a snapshot still sees it. The
+// copy shares the values, which are never written in place.
+static extendible_hash_segment* extendible_hash_own_segment(extendible_hash* table, size_t index)
+{
+	extendible_hash_directory* directory = table->directory;
+	extendible_hash_segment* shared = directory->segments[index];
+
+	if (atomic_load_explicit(&shared->refs, memory_order_acquire) == 1u)
+		return shared;
+
+	size_t slots = table->probing.segment_slots;
+	extendible_hash_segment* segment = (extendible_hash_segment *) malloc(extendible_hash_segment_bytes(slots));
+	if (!segment)
+		return NULL;
+
+	memcpy(segment, shared, extendible_hash_segment_bytes(slots));
+	atomic_init(&segment->refs, 1u);
+
+	for (size_t i = 0; i < slots; ++i)
+		if (segment->slots[i].status == HASH_ENTRY_STATUS_OCCUPIED)
+			extendible_hash_value_retain(segment->slots[i].value);
+
+	size_t first = extendible_hash_span_first(directory, index);
+	size_t span = extendible_hash_span(directory, shared);
+
+	for (size_t i = 0; i < span; ++i)
+		directory->segments[first + i] = segment;
+
+	++table->copies;
+	extendible_hash_segment_release(shared, slots);
+	return segment;
+}
+
+static bool extendible_hash_double_directory(extendible_hash* table)
+{
+	extendible_hash_directory* old = table->directory;
+	if (old->global_depth == EXTENDIBLE_HASH_MAX_DEPTH)
+		return false;
+
+	extendible_hash_directory* directory = extendible_hash_directory_create(old->global_depth + 1u);
+	if (!directory)
+		return false;
+
+	// one more top bit: entry i of the new directory is i >> 1 of the old
+	for (size_t i = 0; i < ((size_t) 2u << old->global_depth); ++i)
+		directory->segments[i] = old->segments[i >> 1];
+
+	// the table owned old, the segment references move over as they are
+	table->directory = directory;
+	free(old);
+	return true;
+}
+
+// Splits (or, when mostly tombstones, rebuilds) the segment at directory
+// index. The entries go to the spare and one new segment; the old segment
+// becomes the next spare, so peak memory is one segment over the table.
+// A segment a snapshot still sees stays with it, its values are shared.
+// On failure the table is left as it was, old still holding every entry.
+static bool extendible_hash_split(extendible_hash* table, size_t index)
+{
+	extendible_hash_segment* old = table->directory->segments[index];
+	bool split = old->size * 2u >= table->limit;
+	bool grow = split && old->local_depth == table->directory->global_depth;
+	bool shared = atomic_load_explicit(&old->refs, memory_order_acquire) > 1u;
+	size_t slots = table->probing.segment_slots;
+
+	if (!table->spare)
+	{
+		table->spare = extendible_hash_segment_create(slots);
+		if (!table->spare)
+			return false;
+
+		++table->segments;
+	}
+
+	extendible_hash_segment* low = table->spare;
+	extendible_hash_segment* high = split ? extendible_hash_segment_create(slots) : NULL;
+
+	if (split && !high)
+		return false;
+
+	extendible_hash_segment_clear(low, slots);
+	low->local_depth = split ? old->local_depth + 1u : old->local_depth;
+
+	if (high)
+		high->local_depth = low->local_depth;
+
+	// the bit that now tells the two halves apart
+	uint8_t shift = (uint8_t)(64u - low->local_depth);
+	bool placed = true;
+
+	for (size_t i = 0; placed && i < slots; ++i)
+	{
+		const hash_entry* entry = &old->slots[i];
+		if (entry->status != HASH_ENTRY_STATUS_OCCUPIED)
+			continue;
+
+		bool upper = high && ((extendible_hash_mix(entry->key) >> shift) & 1u);
+		placed = extendible_hash_place(&table->probing, upper ? high : low, entry);
+	}
+
+	// an entry that found no slot must not be dropped: undo before the
+	// directory changes, low only borrowed the values and stays the spare
+	if (!placed || (grow && !extendible_hash_double_directory(table)))
+	{
+		extendible_hash_segment_clear(low, slots);
+		free(high);
+		return false;
+	}
+
+	if (grow)
+		index <<= 1;
+
+	if (high)
+		++table->segments;
+
+	if (shared)
+	{
+		for (size_t i = 0; i < slots; ++i)
+			if (old->slots[i].status == HASH_ENTRY_STATUS_OCCUPIED)
+				extendible_hash_value_retain(old->slots[i].value);
+	}
+
+	extendible_hash_directory* directory = table->directory;
+
+	// every directory entry that pointed to old shares its top local_depth
+	// bits: the lower half now takes low, the upper half high
+	size_t span = extendible_hash_span(directory, old);
+	size_t first = extendible_hash_span_first(directory, index);
+
+	for (size_t i = 0; i < span; ++i)
+		directory->segments[first + i] = (high && i >= span / 2u) ? high : low;
+
+	if (shared)
+	{
+		table->spare = NULL;
+		--table->segments;
+		extendible_hash_segment_release(old, slots);
+	}
+	else
+	{
+		table->spare = old;
+	}
+
+	return true;
+}
+
+extendible_hash* extendible_hash_create(size_t segment_slots, hash_function_t hash_fn,
+										uint8_t prob_method)
+{
+	hash_prob_method_t prob_method_fn = choose_prob_method(prob_method);
+	if (!hash_fn || !prob_method_fn)
+		return NULL;
+
+	if (prob_method == HASH_PROBING_METHOD_DOUBLE_HASHING)
+		prob_method_fn = extendible_hash_prob_double_hashing;
+
+	segment_slots = segment_slots ? segment_slots : EXTENDIBLE_HASH_DEFAULT_SEGMENT_SLOTS;
+	segment_slots = round_up_to_power_of_2(segment_slots < EXTENDIBLE_HASH_MIN_SEGMENT_SLOTS
+											   ? EXTENDIBLE_HASH_MIN_SEGMENT_SLOTS : segment_slots);
+
+	extendible_hash* table = (extendible_hash *) malloc(sizeof(extendible_hash));
+	extendible_hash_directory* directory = extendible_hash_directory_create(0u);
+	extendible_hash_segment* segment = extendible_hash_segment_create(segment_slots);
+
+	if (!table || !directory || !segment)
+	{
+		free(table);
+		free(directory);
+		free(segment);
+		return NULL;
+	}
+
+	directory->segments[0] = segment;
+
+	*table = (extendible_hash){
+		.directory = directory,
+		.probing = {
+			.segment_slots = segment_slots,
+			.hash_fptr = hash_fn,
+			.hash_prob_method = prob_method_fn
+		},
+		.limit = (size_t)(segment_slots * EXTENDIBLE_HASH_MAX_LOAD_FACTOR),
+		.segments = 1u
+	};
+
+	return table;
+}
+
+bool extendible_hash_insert(ssize_t key, const void* value, size_t value_size,
+							extendible_hash* table)
+{
+	if (!table || !value || !extendible_hash_own_directory(table))
+		return false;
+
+	uint64_t mixed = extendible_hash_mix(key);
+
+	for (;;)
+	{
+		size_t index = extendible_hash_index(mixed, table->directory->global_depth);
+		extendible_hash_segment* segment = table->directory->segments[index];
+
+		bool found = false;
+		hash_entry* slot = extendible_hash_probe(&table->probing, segment, key, &found);
+		bool fits = found || (slot && segment->size + segment->deleted < table->limit);
+
+		if (!fits)
+		{
+			// only this segment grows, then the key looks for its slot again
+			if (!extendible_hash_split(table, index))
+				return false;
+
+			continue;
+		}
+
+		// a copied segment has the same layout, the slot keeps its offset
+		size_t offset = (size_t)(slot - segment->slots);
+		if (!(segment = extendible_hash_own_segment(table, index)))
+			return false;
+
+		slot = &segment->slots[offset];
+
+		void* copy = extendible_hash_value_create(value, value_size);
+		if (!copy)
+			return false;
+
+		if (found)
+		{
+			extendible_hash_value_release(slot->value);
+			slot->value = copy;
+			return true;
+		}
+
+		if (slot->status == HASH_ENTRY_STATUS_DELETED)
+			--segment->deleted;
+
+		*slot = (hash_entry){ .key = key, .value = copy, .status = HASH_ENTRY_STATUS_OCCUPIED };
+		++segment->size;
+		++table->size;
+		return true;
+	}
+}
+
+void* extendible_hash_get(ssize_t key, extendible_hash* table)
+{
+	return table ? extendible_hash_lookup(table->directory, &table->probing, key) : NULL;
+}
+
+bool extendible_hash_remove(ssize_t key, extendible_hash* table)
+{
+	if (!table)
+		return false;
+
+	size_t index = extendible_hash_index(extendible_hash_mix(key), table->directory->global_depth);
+	bool found = false;
+	hash_entry* slot = extendible_hash_probe(&table->probing, table->directory->segments[index], key, &found);
+	if (!found)
+		return false;
+
+	extendible_hash_segment* segment = table->directory->segments[index];
+	size_t offset = (size_t)(slot - segment->slots);
+
+	if (!extendible_hash_own_directory(table) || !(segment = extendible_hash_own_segment(table, index)))
+		return false;
+
+	slot = &segment->slots[offset];
+	extendible_hash_value_release(slot->value);
+	slot->value = NULL;
+	slot->status = HASH_ENTRY_STATUS_DELETED;
+
+	--segment->size;
+	++segment->deleted;
+	--table->size;
+	return true;
+}
+
+size_t extendible_hash_size(const extendible_hash* table)
+{
+	return table ? table->size : 0u;
+}
+
+extendible_hash_stats extendible_hash_get_stats(const extendible_hash* table)
+{
+	if (!table)
+		return (extendible_hash_stats){ 0 };
+
+	uint8_t global_depth = table->directory->global_depth;
+
+	return (extendible_hash_stats){
+		.size = table->size,
+		.segments = table->segments,
+		.global_depth = global_depth,
+		.bytes = sizeof(extendible_hash) + table->segments * extendible_hash_segment_bytes(table->probing.segment_slots) +
+				 sizeof(extendible_hash_directory) + ((size_t) 1u << global_depth) * sizeof(extendible_hash_segment *),
+		.copied_segments = table->copies
+	};
+}
+
+void extendible_hash_release(extendible_hash** pptable)
+{
+	if (!pptable || !*pptable)
+		return;
+
+	extendible_hash* table = *pptable;
+
+	extendible_hash_directory_release(table->directory, table->probing.segment_slots);
+	free(table->spare);
+	free(table);
+	*pptable = NULL;
+}
+
+extendible_hash_snapshot* extendible_hash_snapshot_create(const extendible_hash* table)
+{
+	if (!table)
+		return NULL;
+
+	extendible_hash_snapshot* snapshot = (extendible_hash_snapshot *) malloc(sizeof(extendible_hash_snapshot));
+	if (!snapshot)
+		return NULL;
+
+	atomic_fetch_add_explicit(&table->directory->refs, 1u, memory_order_relaxed);
+
+	*snapshot = (extendible_hash_snapshot){
+		.directory = table->directory,
+		.probing = table->probing,
+		.size = table->size
+	};
+
+	return snapshot;
+}
+
+const void* extendible_hash_snapshot_get(ssize_t key, const extendible_hash_snapshot* snapshot)
+{
+	return snapshot ? extendible_hash_lookup(snapshot->directory, &snapshot->probing, key) : NULL;
+}
+
+size_t extendible_hash_snapshot_size(const extendible_hash_snapshot* snapshot)
+{
+	return snapshot ? snapshot->size : 0u;
+}
+
+void extendible_hash_snapshot_release(extendible_hash_snapshot** ppsnapshot)
+{
+	if (!ppsnapshot || !*ppsnapshot)
+		return;
+
+	extendible_hash_snapshot* snapshot = *ppsnapshot;
+
+	extendible_hash_directory_release(snapshot->directory, snapshot->probing.segment_slots);
+	free(snapshot);
+	*ppsnapshot = NULL;
+}
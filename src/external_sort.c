@@ -0,0 +1,278 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "../include/utils.h"
+#include "../include/kway_merge.h"
+#include "../include/external_sort.h"
+
+typedef struct external_sort_runs_struct
+{
+	char** paths;
+	size_t count;
+	size_t capacity;
+} external_sort_runs;
+
+typedef struct external_sort_context_struct
+{
+	size_t elem_size;
+	comparator cmp;
+	size_t io_buffer_size;
+	const char* temp_dir;
+	unsigned long session;
+	size_t next_id;
+} external_sort_context;
+
+static FILE* external_sort_open(const char* path, const char* mode, size_t io_buffer_size)
+{
+	FILE* file = fopen(path, mode);
+	if (!file)
+		return NULL;
+
+	// large sequential buffers, the merge touches every run in turn
+	if (setvbuf(file, NULL, _IOFBF, io_buffer_size))
+	{
+		fclose(file);
+		return NULL;
+	}
+
+	return file;
+}
+
+static char* external_sort_temp_path(external_sort_context* ctx)
+{
+	char* path = (char *) malloc(EXTERNAL_SORT_MAX_PATH);
+	if (!path)
+		return NULL;
+
+	int len = snprintf(path, EXTERNAL_SORT_MAX_PATH, "%s/external_sort_%lx_%zu.run",
+					   ctx->temp_dir, ctx->session, ctx->next_id++);
+
+	if (len < 0 || (size_t) len >= EXTERNAL_SORT_MAX_PATH)
+	{
+		free(path);
+		return NULL;
+	}
+
+	return path;
+}
+
+static bool external_sort_runs_add(external_sort_runs* runs, char* path)
+{
+	if (runs->count == runs->capacity)
+	{
+		size_t capacity = runs->capacity ? runs->capacity * 2u : 16u;
+		char** paths = (char **) realloc(runs->paths, capacity * sizeof(char *));
+		if (!paths)
+			return false;
+
+		runs->paths = paths;
+		runs->capacity = capacity;
+	}
+
+	runs->paths[runs->count++] = path;
+	return true;
+}
+
+static void external_sort_runs_release(external_sort_runs* runs, bool remove_files)
+{
+	for (size_t i = 0; i < runs->count; ++i)
+	{
+		if (remove_files)
+			remove(runs->paths[i]);
+
+		free(runs->paths[i]);
+	}
+
+	free(runs->paths);
+	*runs = (external_sort_runs){ 0 };
+}
+
+static bool external_sort_write(const char* path, const uint8_t* data, size_t n,
+								const external_sort_context* ctx)
+{
+	FILE* file = external_sort_open(path, "wb", ctx->io_buffer_size);
+	if (!file)
+		return false;
+
+	bool success = fwrite(data, ctx->elem_size, n, file) == n;
+	return (fclose(file) == 0) && success;
+}
+
+static bool external_sort_merge(char** paths, size_t k, const char* output_path,
+								const external_sort_context* ctx)
+{
+	size_t buffer_elems = ctx->io_buffer_size / ctx->elem_size;
+	buffer_elems = buffer_elems ? buffer_elems : 1u;
+
+	kway_source* sources = (kway_source *) calloc(k, sizeof(kway_source));
+	FILE** inputs = (FILE **) calloc(k, sizeof(FILE *));
+	FILE* output = external_sort_open(output_path, "wb", ctx->io_buffer_size);
+
+	bool success = sources && inputs && output;
+
+	for (size_t run = 0; success && run < k; ++run)
+	{
+		// the merge reads whole blocks into its own buffers, no stdio buffer
+		inputs[run] = fopen(paths[run], "rb");
+		success = inputs[run] && !setvbuf(inputs[run], NULL, _IONBF, 0) &&
+				  kway_source_from_file(&sources[run], inputs[run], ctx->elem_size, buffer_elems);
+	}
+
+	if (success)
+		success = kway_merge(sources, k, ctx->elem_size, ctx->cmp, kway_sink_file, output, NULL);
+
+	for (size_t run = 0; sources && inputs && run < k; ++run)
+	{
+		success = success && !ferror(inputs[run]);
+		kway_source_release(&sources[run]);
+
+		if (inputs[run])
+			fclose(inputs[run]);
+	}
+
+	if (output && fclose(output))
+		success = false;
+
+	free(sources);
+	free(inputs);
+	return success;
+}
+
+// splits the input into sorted runs, returns false on I/O or memory
+// errors. When the whole input fits in a single run it goes straight to
+// output_path and no run is created.
+static bool external_sort_make_runs(FILE* input, const char* output_path,
+									size_t memory_budget, external_sort_runs* runs,
+									external_sort_context* ctx)
+{
+	size_t run_capacity = memory_budget / ctx->elem_size;
+	if (!run_capacity)
+		run_capacity = 1u;
+
+	uint8_t* buffer = (uint8_t *) malloc(run_capacity * ctx->elem_size);
+	if (!buffer)
+		return false;
+
+	bool success = true;
+
+	for (;;)
+	{
+		size_t n = fread(buffer, ctx->elem_size, run_capacity, input);
+
+		if (ferror(input))
+		{
+			success = false;
+			break;
+		}
+
+		bool last = n < run_capacity;
+		if (!last)
+		{
+			int next = fgetc(input);
+			last = next == EOF;
+
+			if (!last)
+				ungetc(next, input);
+		}
+
+		if (!n && runs->count)
+			break;
+
+		intro_sort(buffer, buffer + (n * ctx->elem_size), ctx->elem_size, ctx->cmp);
+
+		if (last && !runs->count)
+		{
+			success = external_sort_write(output_path, buffer, n, ctx);
+			break;
+		}
+
+		char* path = external_sort_temp_path(ctx);
+		if (!path || !external_sort_runs_add(runs, path))
+		{
+			free(path);
+			success = false;
+			break;
+		}
+
+		if (!external_sort_write(path, buffer, n, ctx))
+		{
+			success = false;
+			break;
+		}
+
+		if (last)
+			break;
+	}
+
+	free(buffer);
+	return success;
+}
+
+bool external_sort(const char* input_path, const char* output_path,
+				   size_t elem_size, comparator cmp,
+				   const external_sort_config* config)
+{
+	if (!input_path || !output_path || !elem_size || !cmp)
+		return false;
+
+	size_t memory_budget = EXTERNAL_SORT_DEFAULT_MEMORY_BUDGET;
+	size_t io_buffer_size = EXTERNAL_SORT_DEFAULT_IO_BUFFER_SIZE;
+	const char* temp_dir = EXTERNAL_SORT_DEFAULT_TEMP_DIR;
+
+	if (config)
+	{
+		memory_budget = config->memory_budget ? config->memory_budget : memory_budget;
+		io_buffer_size = config->io_buffer_size ? config->io_buffer_size : io_buffer_size;
+		temp_dir = config->temp_dir ? config->temp_dir : temp_dir;
+	}
+
+	external_sort_context ctx =
+	{
+		.elem_size = elem_size,
+		.cmp = cmp,
+		.io_buffer_size = io_buffer_size,
+		.temp_dir = temp_dir,
+		.session = (unsigned long) time(NULL) ^ (unsigned long)(uintptr_t) &ctx
+	};
+
+	FILE* input = external_sort_open(input_path, "rb", io_buffer_size);
+	if (!input)
+		return false;
+
+	external_sort_runs runs = { 0 };
+	bool success = external_sort_make_runs(input, output_path, memory_budget, &runs, &ctx);
+	fclose(input);
+
+	// every open run needs its own buffer, plus one for the output
+	size_t fan_in = memory_budget / io_buffer_size;
+	fan_in = fan_in > 2u ? fan_in - 1u : 2u;
+
+	while (success && runs.count > fan_in)
+	{
+		external_sort_runs next = { 0 };
+
+		for (size_t first = 0; success && first < runs.count; first += fan_in)
+		{
+			size_t k = runs.count - first < fan_in ? runs.count - first : fan_in;
+
+			char* path = external_sort_temp_path(&ctx);
+			if (!path || !external_sort_runs_add(&next, path))
+			{
+				free(path);
+				success = false;
+				break;
+			}
+
+			success = external_sort_merge(runs.paths + first, k, path, &ctx);
+		}
+
+		external_sort_runs_release(&runs, true);
+		runs = next;
+	}
+
+	if (success && runs.count)
+		success = external_sort_merge(runs.paths, runs.count, output_path, &ctx);
+
+	external_sort_runs_release(&runs, true);
+	return success;
+}
@@ -0,0 +1,435 @@
+#include <threads.h>
+
+#include "../include/utils.h"
+#include "../include/parallel_sort.h"
+#include "../include/hash_aggregate.h"
+
+// a partition never holds fewer slots than two batches, so one batch can
+// always be placed without growing in the middle of it
+#define HASH_AGGREGATE_MIN_CAPACITY (2u * HASH_AGGREGATE_BATCH_SIZE)
+
+#define HASH_AGGREGATE_PARTITIONS_PER_THREAD (4u)
+
+#if defined(__GNUC__) || defined(__clang__)
+#define HASH_AGGREGATE_PREFETCH(address) __builtin_prefetch((address), 1)
+#else
+#define HASH_AGGREGATE_PREFETCH(address) ((void)(address))
+#endif
+
+// splitmix64 finalizer, its top bits pick the partition so they stay
+// apart from whatever bits hash_fptr uses inside it
+static inline uint64_t hash_aggregate_mix(int64_t key)
+{
+	uint64_t h = (uint64_t) key;
+	h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+	return h ^ (h >> 31);
+}
+
+static inline size_t hash_aggregate_partition_of(const hash_aggregate* aggregate, int64_t key)
+{
+	return aggregate->partition_bits ? (size_t)(hash_aggregate_mix(key) >> (64u - aggregate->partition_bits)) : 0u;
+}
+
+static inline size_t hash_aggregate_limit(const hash_aggregate_partition* partition)
+{
+	return (size_t)(partition->capacity * HASH_AGGREGATE_MAX_LOAD_FACTOR);
+}
+
+static inline void hash_aggregate_combine(hash_aggregate_group* into, const hash_aggregate_group* from)
+{
+	if (!into->count)
+	{
+		*into = *from;
+		return;
+	}
+
+	into->sum = (int64_t)((uint64_t) into->sum + (uint64_t) from->sum);
+	into->count += from->count;
+	into->min = from->min < into->min ? from->min : into->min;
+	into->max = from->max > into->max ? from->max : into->max;
+}
+
+// the group of key, or the free slot it should take
+static hash_aggregate_group* hash_aggregate_slot(const hash_aggregate* aggregate,
+												 const hash_aggregate_partition* partition,
+												 int64_t key, size_t home)
+{
+	size_t index = home;
+
+	for (size_t nprobs = 0; nprobs < partition->capacity; ++nprobs)
+	{
+		hash_aggregate_group* group = &partition->slots[index];
+		if (!group->count || group->key == key)
+			return group;
+
+		index = aggregate->hash_prob_method((ssize_t) key, nprobs + 1u, partition->capacity,
+											aggregate->hash_fptr);
+	}
+
+	return NULL;
+}
+
+static bool hash_aggregate_grow(const hash_aggregate* aggregate, hash_aggregate_partition* partition)
+{
+	hash_aggregate_partition grown = {
+		.slots = create_vector(2u * partition->capacity, sizeof(hash_aggregate_group), true),
+		.capacity = 2u * partition->capacity
+	};
+
+	if (!grown.slots)
+		return false;
+
+	for (size_t i = 0; i < partition->capacity; ++i)
+	{
+		const hash_aggregate_group* group = &partition->slots[i];
+		if (!group->count)
+			continue;
+
+		size_t home = aggregate->hash_fptr((ssize_t) group->key, grown.capacity);
+		*hash_aggregate_slot(aggregate, &grown, group->key, home) = *group;
+		++grown.size;
+	}
+
+	free(partition->slots);
+	*partition = grown;
+	return true;
+}
+
+static bool hash_aggregate_upsert(const hash_aggregate* aggregate, hash_aggregate_partition* partition,
+								  const hash_aggregate_group* from)
+{
+	if (partition->size + 1u > hash_aggregate_limit(partition) && !hash_aggregate_grow(aggregate, partition))
+		return false;
+
+	size_t home = aggregate->hash_fptr((ssize_t) from->key, partition->capacity);
+	hash_aggregate_group* group = hash_aggregate_slot(aggregate, partition, from->key, home);
+	if (!group)
+		return false;
+
+	partition->size += !group->count;
+	hash_aggregate_combine(group, from);
+	return true;
+}
+
+static bool hash_aggregate_merge_partition(const hash_aggregate_partition* from, const hash_aggregate* aggregate,
+										   hash_aggregate_partition* into)
+{
+	for (size_t i = 0; i < from->capacity; ++i)
+		if (from->slots[i].count && !hash_aggregate_upsert(aggregate, into, &from->slots[i]))
+			return false;
+
+	return true;
+}
+
+hash_aggregate* hash_aggregate_create(size_t expected_groups, size_t npartitions,
+									  hash_function_t hash_fn, uint8_t prob_method)
+{
+	hash_prob_method_t prob_method_fn = choose_prob_method(prob_method);
+	if (!hash_fn || !prob_method_fn)
+		return NULL;
+
+	npartitions = round_up_to_power_of_2(npartitions ? npartitions : 1u);
+
+	size_t capacity = (size_t)((expected_groups / npartitions) / HASH_AGGREGATE_MAX_LOAD_FACTOR) + 1u;
+	capacity = round_up_to_power_of_2(capacity < HASH_AGGREGATE_MIN_CAPACITY ? HASH_AGGREGATE_MIN_CAPACITY : capacity);
+
+	hash_aggregate* aggregate = (hash_aggregate *) malloc(sizeof(hash_aggregate));
+	hash_aggregate_partition* partitions = create_vector(npartitions, sizeof(hash_aggregate_partition), true);
+
+	if (!aggregate || !partitions)
+	{
+		free(aggregate);
+		free(partitions);
+		return NULL;
+	}
+
+	uint8_t partition_bits = 0u;
+	while (((size_t) 1u << partition_bits) < npartitions)
+		++partition_bits;
+
+	*aggregate = (hash_aggregate){
+		.partitions = partitions,
+		.npartitions = npartitions,
+		.partition_bits = partition_bits,
+		.hash_fptr = hash_fn,
+		.hash_prob_method = prob_method_fn
+	};
+
+	for (size_t p = 0; p < npartitions; ++p)
+	{
+		partitions[p].capacity = capacity;
+		partitions[p].slots = create_vector(capacity, sizeof(hash_aggregate_group), true);
+
+		if (!partitions[p].slots)
+		{
+			hash_aggregate_release(&aggregate);
+			return NULL;
+		}
+	}
+
+	return aggregate;
+}
+
+bool hash_aggregate_update(const int64_t* keys, const int64_t* values, size_t n,
+						   hash_aggregate* aggregate)
+{
+	if (!aggregate || (!keys && n))
+		return false;
+
+	hash_aggregate_partition* partitions[HASH_AGGREGATE_BATCH_SIZE];
+	size_t homes[HASH_AGGREGATE_BATCH_SIZE];
+
+	for (size_t first = 0; first < n; first += HASH_AGGREGATE_BATCH_SIZE)
+	{
+		size_t count = n - first < HASH_AGGREGATE_BATCH_SIZE ? n - first : HASH_AGGREGATE_BATCH_SIZE;
+
+		// hash the whole batch and start loading its slots; a partition
+		// grows here, before any home slot of it is taken, and has room
+		// for the batch afterwards
+		for (size_t i = 0; i < count; ++i)
+		{
+			int64_t key = keys[first + i];
+			hash_aggregate_partition* partition = &aggregate->partitions[hash_aggregate_partition_of(aggregate, key)];
+
+			while (partition->size + HASH_AGGREGATE_BATCH_SIZE > hash_aggregate_limit(partition))
+				if (!hash_aggregate_grow(aggregate, partition))
+					return false;
+
+			partitions[i] = partition;
+			homes[i] = aggregate->hash_fptr((ssize_t) key, partition->capacity);
+			HASH_AGGREGATE_PREFETCH(&partition->slots[homes[i]]);
+		}
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			int64_t key = keys[first + i];
+			int64_t value = values ? values[first + i] : 0;
+
+			hash_aggregate_group* group = hash_aggregate_slot(aggregate, partitions[i], key, homes[i]);
+			if (!group)
+				return false;
+
+			partitions[i]->size += !group->count;
+			hash_aggregate_combine(group, &(hash_aggregate_group){ key, value, value, value, 1u });
+		}
+	}
+
+	return true;
+}
+
+bool hash_aggregate_merge(const hash_aggregate* from, hash_aggregate* into)
+{
+	if (!from || !into)
+		return false;
+
+	for (size_t p = 0; p < from->npartitions; ++p)
+	{
+		const hash_aggregate_partition* partition = &from->partitions[p];
+
+		for (size_t i = 0; i < partition->capacity; ++i)
+		{
+			const hash_aggregate_group* group = &partition->slots[i];
+			if (!group->count)
+				continue;
+
+			size_t target = hash_aggregate_partition_of(into, group->key);
+			if (!hash_aggregate_upsert(into, &into->partitions[target], group))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+const hash_aggregate_group* hash_aggregate_find(int64_t key, const hash_aggregate* aggregate)
+{
+	if (!aggregate)
+		return NULL;
+
+	const hash_aggregate_partition* partition = &aggregate->partitions[hash_aggregate_partition_of(aggregate, key)];
+	size_t home = aggregate->hash_fptr((ssize_t) key, partition->capacity);
+	const hash_aggregate_group* group = hash_aggregate_slot(aggregate, partition, key, home);
+
+	return group && group->count ? group : NULL;
+}
+
+size_t hash_aggregate_size(const hash_aggregate* aggregate)
+{
+	size_t size = 0u;
+
+	for (size_t p = 0; aggregate && p < aggregate->npartitions; ++p)
+		size += aggregate->partitions[p].size;
+
+	return size;
+}
+
+size_t hash_aggregate_export(const hash_aggregate* aggregate, hash_aggregate_group* out)
+{
+	size_t n = 0u;
+
+	for (size_t p = 0; aggregate && out && p < aggregate->npartitions; ++p)
+	{
+		const hash_aggregate_partition* partition = &aggregate->partitions[p];
+
+		for (size_t i = 0; i < partition->capacity; ++i)
+			if (partition->slots[i].count)
+				out[n++] = partition->slots[i];
+	}
+
+	return n;
+}
+
+typedef struct hash_aggregate_context_struct
+{
+	const int64_t* keys;
+	const int64_t* values;
+	size_t first;
+	size_t last;
+	size_t thread;
+	size_t nthreads;
+	hash_aggregate** locals;
+	hash_aggregate* result;
+	bool ok;
+} hash_aggregate_context;
+
+static int hash_aggregate_build_worker(void* arg)
+{
+	hash_aggregate_context* ctx = (hash_aggregate_context *) arg;
+	hash_aggregate* local = ctx->locals[ctx->thread];
+
+	ctx->ok = hash_aggregate_update(ctx->keys + ctx->first,
+									ctx->values ? ctx->values + ctx->first : NULL,
+									ctx->last - ctx->first, local);
+	return 0;
+}
+
+// partition p of the result is partition p of the first local table
+// (taken as it is) with the same partition of every other one folded in
+static int hash_aggregate_merge_worker(void* arg)
+{
+	hash_aggregate_context* ctx = (hash_aggregate_context *) arg;
+	hash_aggregate* result = ctx->result;
+
+	ctx->ok = true;
+
+	for (size_t p = ctx->thread; ctx->ok && p < result->npartitions; p += ctx->nthreads)
+	{
+		hash_aggregate_partition* into = &result->partitions[p];
+
+		free(into->slots);
+		*into = ctx->locals[0]->partitions[p];
+		ctx->locals[0]->partitions[p] = (hash_aggregate_partition){ 0 };
+
+		for (size_t t = 1; ctx->ok && t < ctx->nthreads; ++t)
+			ctx->ok = hash_aggregate_merge_partition(&ctx->locals[t]->partitions[p], result, into);
+	}
+
+	return 0;
+}
+
+// runs fn on every context, the caller taking the first one and the ones
+// whose thread could not start
+static bool hash_aggregate_run(thrd_start_t fn, hash_aggregate_context* contexts, thrd_t* threads,
+							   bool* started, size_t nthreads)
+{
+	for (size_t t = 1; t < nthreads; ++t)
+		started[t] = thrd_create(&threads[t], fn, &contexts[t]) == thrd_success;
+
+	fn(&contexts[0]);
+
+	bool ok = contexts[0].ok;
+
+	for (size_t t = 1; t < nthreads; ++t)
+	{
+		if (started[t])
+			thrd_join(threads[t], NULL);
+		else
+			fn(&contexts[t]);
+
+		ok = ok && contexts[t].ok;
+	}
+
+	return ok;
+}
+
+hash_aggregate* hash_aggregate_parallel(const int64_t* keys, const int64_t* values, size_t n,
+										hash_function_t hash_fn, uint8_t prob_method,
+										const hash_aggregate_config* config)
+{
+	if (!keys && n)
+		return NULL;
+
+	size_t cutoff = config && config->cutoff ? config->cutoff : HASH_AGGREGATE_DEFAULT_CUTOFF;
+	size_t nthreads = config && config->nthreads ? config->nthreads
+												 : parallel_sort_hardware_threads();
+
+	if (n < cutoff || nthreads > n)
+		nthreads = n < cutoff || !n ? 1u : n;
+
+	size_t npartitions = config && config->npartitions ? config->npartitions
+													   : nthreads * HASH_AGGREGATE_PARTITIONS_PER_THREAD;
+
+	hash_aggregate* result = hash_aggregate_create(0u, nthreads > 1u ? npartitions : 1u, hash_fn, prob_method);
+	if (!result || nthreads == 1u)
+	{
+		if (result && !hash_aggregate_update(keys, values, n, result))
+			hash_aggregate_release(&result);
+
+		return result;
+	}
+
+	hash_aggregate** locals = create_vector(nthreads, sizeof(hash_aggregate *), true);
+	hash_aggregate_context* contexts = (hash_aggregate_context *) malloc(nthreads * sizeof(hash_aggregate_context));
+	thrd_t* threads = (thrd_t *) malloc(nthreads * sizeof(thrd_t));
+	bool* started = (bool *) calloc(nthreads, sizeof(bool));
+	bool ok = locals && contexts && threads && started;
+
+	for (size_t t = 0; ok && t < nthreads; ++t)
+	{
+		locals[t] = hash_aggregate_create(0u, result->npartitions, hash_fn, prob_method);
+		ok = locals[t] != NULL;
+
+		contexts[t] = (hash_aggregate_context){
+			.keys = keys,
+			.values = values,
+			.first = (n * t) / nthreads,
+			.last = (n * (t + 1u)) / nthreads,
+			.thread = t,
+			.nthreads = nthreads,
+			.locals = locals,
+			.result = result
+		};
+	}
+
+	ok = ok && hash_aggregate_run(hash_aggregate_build_worker, contexts, threads, started, nthreads);
+	ok = ok && hash_aggregate_run(hash_aggregate_merge_worker, contexts, threads, started, nthreads);
+
+	for (size_t t = 0; locals && t < nthreads; ++t)
+		hash_aggregate_release(&locals[t]);
+
+	free(locals);
+	free(contexts);
+	free(threads);
+	free(started);
+
+	if (!ok)
+		hash_aggregate_release(&result);
+
+	return result;
+}
+
+void hash_aggregate_release(hash_aggregate** ppaggregate)
+{
+	if (!ppaggregate || !*ppaggregate)
+		return;
+
+	hash_aggregate* aggregate = *ppaggregate;
+
+	for (size_t p = 0; p < aggregate->npartitions; ++p)
+		free(aggregate->partitions[p].slots);
+
+	free(aggregate->partitions);
+	free(aggregate);
+	*ppaggregate = NULL;
+}
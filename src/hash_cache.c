@@ -0,0 +1,128 @@
+#include "../include/utils.h"
+#include "../include/hash_cache.h"
+
+hash_cache* hash_cache_create(size_t max_entries, size_t value_size,
+							  hash_function_t hash_fn, uint8_t prob_method)
+{
+	if (!max_entries || !value_size)
+		return NULL;
+
+	hash_table* table = hash_table_create(max_entries * HASH_CACHE_SLOTS_PER_ENTRY, hash_fn, prob_method);
+	if (!table)
+		return NULL;
+
+	hash_table_set_max_load_factor(table, HASH_CACHE_MAX_LOAD_FACTOR);
+
+	hash_cache* cache = memdup(&(hash_cache) {
+		.table = table,
+		.max_entries = max_entries,
+		.value_size = value_size
+	}, sizeof(hash_cache));
+
+	if (!cache)
+		hash_table_release(&table);
+
+	return cache;
+}
+
+void* hash_cache_get(ssize_t key, hash_cache* cache)
+{
+	if (!cache)
+		return NULL;
+
+	hash_entry* bucket = hash_table_search(key, cache->table);
+	if (!bucket || bucket->status != HASH_ENTRY_STATUS_OCCUPIED)
+		return NULL;
+
+	bucket->referenced = 1u;
+	return bucket->value;
+}
+
+// CLOCK: the first occupied slot past the hand with a clear bit goes,
+// set bits are cleared on the way. Two turns at most.
+static void hash_cache_evict(hash_cache* cache, hash_cache_eviction* evicted)
+{
+	hash_table* table = cache->table;
+	size_t capacity = table->capacity;
+
+	for (size_t step = 0; step < 2u * capacity; ++step)
+	{
+		hash_entry* entry = &table->data[cache->hand];
+		cache->hand = (cache->hand + 1u) & (capacity - 1u);
+
+		if (entry->status != HASH_ENTRY_STATUS_OCCUPIED)
+			continue;
+
+		if (entry->referenced)
+		{
+			entry->referenced = 0u;
+			continue;
+		}
+
+		// the value changes hands instead of being freed
+		if (evicted)
+		{
+			*evicted = (hash_cache_eviction){ entry->key, entry->value, true };
+			entry->value = NULL;
+		}
+
+		hash_table_erase(table, entry);
+		++cache->evictions;
+		return;
+	}
+}
+
+bool hash_cache_put(ssize_t key, const void* value, hash_cache* cache,
+					hash_cache_eviction* evicted)
+{
+	if (evicted)
+		*evicted = (hash_cache_eviction){ 0 };
+
+	if (!cache || !value)
+		return false;
+
+	if (cache->table->size >= cache->max_entries)
+	{
+		// a full cache only evicts for new keys, replacing stays in place
+		hash_entry* bucket = hash_table_search(key, cache->table);
+
+		if (bucket && bucket->status == HASH_ENTRY_STATUS_OCCUPIED)
+		{
+			void* copy = memdup(value, cache->value_size);
+			if (!copy)
+				return false;
+
+			free(bucket->value);
+			bucket->value = copy;
+			bucket->referenced = 1u;
+			return true;
+		}
+
+		hash_cache_evict(cache, evicted);
+	}
+
+	// live entries stay under half the slots, so this never grows the
+	// table and the hand stays in range; a same-size rehash when the
+	// tombstones pile up keeps the reference bits
+	return hash_table_insert(key, value, cache->value_size, &cache->table, NULL);
+}
+
+bool hash_cache_remove(ssize_t key, hash_cache* cache)
+{
+	return cache && hash_table_remove(key, cache->table);
+}
+
+size_t hash_cache_size(const hash_cache* cache)
+{
+	return cache ? cache->table->size : 0u;
+}
+
+void hash_cache_release(hash_cache** ppcache)
+{
+	if (!ppcache || !*ppcache)
+		return;
+
+	hash_table_release(&(*ppcache)->table);
+	free(*ppcache);
+	*ppcache = NULL;
+}
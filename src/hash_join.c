@@ -0,0 +1,495 @@
+#include <stdatomic.h>
+#include <threads.h>
+
+#include "../include/utils.h"
+#include "../include/parallel_sort.h"
+#include "../include/hash_join.h"
+
+// pairs a thread gathers before it reserves room in the output
+#define HASH_JOIN_OUTPUT_BUFFER (1024u)
+
+#define HASH_JOIN_MIN_CAPACITY (16u)
+
+#define HASH_JOIN_PARTITIONS_PER_THREAD (4u)
+
+#define HASH_JOIN_FREE_ROW SIZE_MAX
+
+#if defined(__GNUC__) || defined(__clang__)
+#define HASH_JOIN_PREFETCH(address) __builtin_prefetch((address), 0)
+#else
+#define HASH_JOIN_PREFETCH(address) ((void)(address))
+#endif
+
+#define HASH_JOIN_BUILD (0u)
+#define HASH_JOIN_PROBE (1u)
+
+typedef struct hash_join_tuple_struct
+{
+	int64_t key;
+	size_t row;
+} hash_join_tuple;
+
+// slot of a partition table: one per distinct build key, its rows are
+// chained through hash_join_context.next
+typedef struct hash_join_slot_struct
+{
+	int64_t key;
+	size_t head; // build tuple of the partition, HASH_JOIN_FREE_ROW if free
+} hash_join_slot;
+
+typedef struct hash_join_side_struct
+{
+	const int64_t* keys;
+	size_t n;
+	hash_join_tuple* tuples; // the rows grouped by partition
+	size_t* offsets;         // [thread][partition] histogram, then write cursor
+	size_t* begin;           // npartitions + 1 bounds into tuples
+} hash_join_side;
+
+typedef struct hash_join_state_struct
+{
+	hash_join_side sides[2];
+	size_t nthreads;
+	size_t npartitions;
+	uint8_t radix_bits;
+	size_t rows_per_partition; // build rows whose table fits partition_bytes
+	hash_function_t hash_fptr;
+	hash_prob_method_t hash_prob_method;
+	atomic_size_t next_partition;
+	atomic_size_t nmatches;
+	hash_join_pair* out;
+	size_t out_capacity;
+} hash_join_state;
+
+typedef struct hash_join_context_struct
+{
+	hash_join_state* state;
+	size_t thread;
+	hash_join_slot* table;
+	size_t table_capacity;
+	size_t* next; // previous build tuple with the same key
+	size_t next_capacity;
+	hash_join_tuple* sub_tuples[2]; // second pass of an oversized partition
+	size_t sub_capacity[2];
+	size_t* sub_begin[2];           // HASH_JOIN_MAX_RADIX_BITS sub-partitions + 1
+	hash_join_pair* buffer;
+	size_t nbuffered;
+	bool ok;
+} hash_join_context;
+
+// splitmix64 finalizer, its top bits pick the partition so they stay
+// apart from whatever bits hash_fptr uses inside it
+static inline uint64_t hash_join_mix(int64_t key)
+{
+	uint64_t h = (uint64_t) key;
+	h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+	return h ^ (h >> 31);
+}
+
+static inline size_t hash_join_partition_of(int64_t key, uint8_t radix_bits)
+{
+	return radix_bits ? (size_t)(hash_join_mix(key) >> (64u - radix_bits)) : 0u;
+}
+
+// the bits right below the first pass ones split a partition again
+static inline size_t hash_join_sub_partition_of(int64_t key, uint8_t radix_bits, uint8_t sub_bits)
+{
+	return (size_t)((hash_join_mix(key) << radix_bits) >> (64u - sub_bits));
+}
+
+static inline uint8_t hash_join_radix_bits(size_t npartitions)
+{
+	uint8_t bits = 0u;
+	while (((size_t) 1u << bits) < npartitions && bits < HASH_JOIN_MAX_RADIX_BITS)
+		++bits;
+
+	return bits;
+}
+
+// grows a per-thread buffer to n elements, its content is not kept
+static bool hash_join_reserve(void** buffer, size_t* capacity, size_t n, size_t elem_size)
+{
+	if (n <= *capacity)
+		return true;
+
+	free(*buffer);
+	*buffer = malloc(n * elem_size);
+	*capacity = *buffer ? n : 0u;
+	return *buffer != NULL;
+}
+
+static inline size_t hash_join_table_capacity(size_t nrows)
+{
+	// load factor 1/2
+	size_t capacity = round_up_to_power_of_2(2u * nrows);
+	return capacity < HASH_JOIN_MIN_CAPACITY ? HASH_JOIN_MIN_CAPACITY : capacity;
+}
+
+static int hash_join_histogram_worker(void* arg)
+{
+	hash_join_context* ctx = (hash_join_context *) arg;
+	hash_join_state* state = ctx->state;
+
+	for (size_t s = 0; s < 2u; ++s)
+	{
+		hash_join_side* side = &state->sides[s];
+		size_t* histogram = side->offsets + ctx->thread * state->npartitions;
+		size_t first = (side->n * ctx->thread) / state->nthreads;
+		size_t last = (side->n * (ctx->thread + 1u)) / state->nthreads;
+
+		for (size_t i = first; i < last; ++i)
+			++histogram[hash_join_partition_of(side->keys[i], state->radix_bits)];
+	}
+
+	ctx->ok = true;
+	return 0;
+}
+
+static int hash_join_scatter_worker(void* arg)
+{
+	hash_join_context* ctx = (hash_join_context *) arg;
+	hash_join_state* state = ctx->state;
+
+	for (size_t s = 0; s < 2u; ++s)
+	{
+		hash_join_side* side = &state->sides[s];
+		size_t* cursors = side->offsets + ctx->thread * state->npartitions;
+		size_t first = (side->n * ctx->thread) / state->nthreads;
+		size_t last = (side->n * (ctx->thread + 1u)) / state->nthreads;
+
+		for (size_t i = first; i < last; ++i)
+		{
+			size_t p = hash_join_partition_of(side->keys[i], state->radix_bits);
+			side->tuples[cursors[p]++] = (hash_join_tuple){ side->keys[i], i };
+		}
+	}
+
+	ctx->ok = true;
+	return 0;
+}
+
+static void hash_join_flush(hash_join_context* ctx)
+{
+	hash_join_state* state = ctx->state;
+	size_t first = atomic_fetch_add_explicit(&state->nmatches, ctx->nbuffered, memory_order_relaxed);
+
+	if (first < state->out_capacity)
+	{
+		size_t n = state->out_capacity - first < ctx->nbuffered ? state->out_capacity - first : ctx->nbuffered;
+		memcpy(state->out + first, ctx->buffer, n * sizeof(hash_join_pair));
+	}
+
+	ctx->nbuffered = 0u;
+}
+
+static inline void hash_join_emit(hash_join_context* ctx, size_t build, size_t probe)
+{
+	ctx->buffer[ctx->nbuffered++] = (hash_join_pair){ build, probe };
+
+	if (ctx->nbuffered == HASH_JOIN_OUTPUT_BUFFER)
+		hash_join_flush(ctx);
+}
+
+// builds a table over one piece of the build side and probes it
+static bool hash_join_build_probe(hash_join_context* ctx, const hash_join_tuple* tuples, size_t nbuild,
+								  const hash_join_tuple* probes, size_t nprobe)
+{
+	hash_join_state* state = ctx->state;
+
+	if (!nbuild || !nprobe)
+		return true;
+
+	if (!hash_join_reserve((void **) &ctx->table, &ctx->table_capacity, hash_join_table_capacity(nbuild),
+						   sizeof(hash_join_slot)) ||
+		!hash_join_reserve((void **) &ctx->next, &ctx->next_capacity, nbuild, sizeof(size_t)))
+	{
+		return false;
+	}
+
+	size_t capacity = hash_join_table_capacity(nbuild);
+	hash_join_slot* table = ctx->table;
+
+	for (size_t i = 0; i < capacity; ++i)
+		table[i].head = HASH_JOIN_FREE_ROW;
+
+	// duplicate keys share a slot and chain their rows, the probe chains
+	// only grow with the distinct keys
+	for (size_t i = 0; i < nbuild; ++i)
+	{
+		size_t index = state->hash_fptr((ssize_t) tuples[i].key, capacity);
+
+		for (size_t nprobs = 1; table[index].head != HASH_JOIN_FREE_ROW && table[index].key != tuples[i].key; ++nprobs)
+			index = state->hash_prob_method((ssize_t) tuples[i].key, nprobs, capacity, state->hash_fptr);
+
+		ctx->next[i] = table[index].head;
+		table[index] = (hash_join_slot){ tuples[i].key, i };
+	}
+
+	size_t homes[HASH_JOIN_BATCH_SIZE];
+
+	for (size_t first = 0; first < nprobe; first += HASH_JOIN_BATCH_SIZE)
+	{
+		size_t count = nprobe - first < HASH_JOIN_BATCH_SIZE ? nprobe - first : HASH_JOIN_BATCH_SIZE;
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			homes[i] = state->hash_fptr((ssize_t) probes[first + i].key, capacity);
+			HASH_JOIN_PREFETCH(&table[homes[i]]);
+		}
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const hash_join_tuple* tuple = &probes[first + i];
+			size_t index = homes[i];
+
+			for (size_t nprobs = 1; nprobs <= capacity && table[index].head != HASH_JOIN_FREE_ROW; ++nprobs)
+			{
+				if (table[index].key == tuple->key)
+				{
+					for (size_t row = table[index].head; row != HASH_JOIN_FREE_ROW; row = ctx->next[row])
+						hash_join_emit(ctx, tuples[row].row, tuple->row);
+
+					break;
+				}
+
+				index = state->hash_prob_method((ssize_t) tuple->key, nprobs, capacity, state->hash_fptr);
+			}
+		}
+	}
+
+	return true;
+}
+
+// A partition whose build side is still well over partition_bytes (the
+// first pass stops at HASH_JOIN_MAX_RADIX_BITS) is split again on the next
+// bits of the mix, by the thread that took it, into its own buffers.
+// Duplicated keys cannot be split, such a piece stays as big as it is.
+static bool hash_join_partition(hash_join_context* ctx, size_t p)
+{
+	hash_join_state* state = ctx->state;
+	const hash_join_side* sides = state->sides;
+
+	size_t nbuild = sides[HASH_JOIN_BUILD].begin[p + 1u] - sides[HASH_JOIN_BUILD].begin[p];
+	size_t nprobe = sides[HASH_JOIN_PROBE].begin[p + 1u] - sides[HASH_JOIN_PROBE].begin[p];
+
+	if (nbuild <= 2u * state->rows_per_partition || !nprobe)
+	{
+		return hash_join_build_probe(ctx, sides[HASH_JOIN_BUILD].tuples + sides[HASH_JOIN_BUILD].begin[p], nbuild,
+									 sides[HASH_JOIN_PROBE].tuples + sides[HASH_JOIN_PROBE].begin[p], nprobe);
+	}
+
+	uint8_t sub_bits = hash_join_radix_bits(nbuild / state->rows_per_partition + 1u);
+	size_t nsub = (size_t) 1u << sub_bits;
+
+	for (size_t s = 0; s < 2u; ++s)
+	{
+		const hash_join_tuple* tuples = sides[s].tuples + sides[s].begin[p];
+		size_t n = sides[s].begin[p + 1u] - sides[s].begin[p];
+		size_t* begin = ctx->sub_begin[s];
+
+		if (!hash_join_reserve((void **) &ctx->sub_tuples[s], &ctx->sub_capacity[s], n, sizeof(hash_join_tuple)))
+			return false;
+
+		memset(begin, 0, (nsub + 1u) * sizeof(size_t));
+
+		for (size_t i = 0; i < n; ++i)
+			++begin[hash_join_sub_partition_of(tuples[i].key, state->radix_bits, sub_bits) + 1u];
+
+		for (size_t q = 0; q < nsub; ++q)
+			begin[q + 1u] += begin[q];
+
+		// begin[q] is used as the write cursor and ends at begin[q + 1],
+		// one shift back restores the bounds
+		for (size_t i = 0; i < n; ++i)
+			ctx->sub_tuples[s][begin[hash_join_sub_partition_of(tuples[i].key, state->radix_bits, sub_bits)]++] = tuples[i];
+
+		memmove(begin + 1, begin, nsub * sizeof(size_t));
+		begin[0] = 0u;
+	}
+
+	const size_t* build = ctx->sub_begin[HASH_JOIN_BUILD];
+	const size_t* probe = ctx->sub_begin[HASH_JOIN_PROBE];
+	bool ok = true;
+
+	for (size_t q = 0; ok && q < nsub; ++q)
+	{
+		ok = hash_join_build_probe(ctx, ctx->sub_tuples[HASH_JOIN_BUILD] + build[q], build[q + 1u] - build[q],
+								   ctx->sub_tuples[HASH_JOIN_PROBE] + probe[q], probe[q + 1u] - probe[q]);
+	}
+
+	return ok;
+}
+
+static int hash_join_probe_worker(void* arg)
+{
+	hash_join_context* ctx = (hash_join_context *) arg;
+	hash_join_state* state = ctx->state;
+
+	// tables and second pass buffers grow with the pieces this thread takes
+	ctx->buffer = (hash_join_pair *) malloc(HASH_JOIN_OUTPUT_BUFFER * sizeof(hash_join_pair));
+	ctx->sub_begin[HASH_JOIN_BUILD] = (size_t *) malloc(((1u << HASH_JOIN_MAX_RADIX_BITS) + 1u) * sizeof(size_t));
+	ctx->sub_begin[HASH_JOIN_PROBE] = (size_t *) malloc(((1u << HASH_JOIN_MAX_RADIX_BITS) + 1u) * sizeof(size_t));
+	ctx->nbuffered = 0u;
+	ctx->ok = ctx->buffer && ctx->sub_begin[HASH_JOIN_BUILD] && ctx->sub_begin[HASH_JOIN_PROBE];
+
+	// partitions are handed out one at a time, skewed ones do not stall
+	// a whole static range
+	for (size_t p; ctx->ok && (p = atomic_fetch_add(&state->next_partition, 1u)) < state->npartitions; )
+		ctx->ok = hash_join_partition(ctx, p);
+
+	if (ctx->ok)
+		hash_join_flush(ctx);
+
+	free(ctx->table);
+	free(ctx->next);
+	free(ctx->buffer);
+
+	for (size_t s = 0; s < 2u; ++s)
+	{
+		free(ctx->sub_tuples[s]);
+		free(ctx->sub_begin[s]);
+	}
+
+	*ctx = (hash_join_context){ .state = state, .thread = ctx->thread, .ok = ctx->ok };
+	return 0;
+}
+
+// runs fn on every context, the caller taking the first one and the ones
+// whose thread could not start
+static bool hash_join_run(thrd_start_t fn, hash_join_context* contexts, thrd_t* threads,
+						  bool* started, size_t nthreads)
+{
+	for (size_t t = 1; t < nthreads; ++t)
+		started[t] = thrd_create(&threads[t], fn, &contexts[t]) == thrd_success;
+
+	fn(&contexts[0]);
+
+	bool ok = contexts[0].ok;
+
+	for (size_t t = 1; t < nthreads; ++t)
+	{
+		if (started[t])
+			thrd_join(threads[t], NULL);
+		else
+			fn(&contexts[t]);
+
+		ok = ok && contexts[t].ok;
+	}
+
+	return ok;
+}
+
+// histograms to write cursors: partition p of thread t starts after
+// partition p of the threads before it, and after all smaller partitions
+static void hash_join_prefix(hash_join_side* side, size_t nthreads, size_t npartitions)
+{
+	size_t running = 0u;
+
+	for (size_t p = 0; p < npartitions; ++p)
+	{
+		side->begin[p] = running;
+
+		for (size_t t = 0; t < nthreads; ++t)
+		{
+			size_t count = side->offsets[t * npartitions + p];
+			side->offsets[t * npartitions + p] = running;
+			running += count;
+		}
+	}
+
+	side->begin[npartitions] = running;
+}
+
+bool hash_join(const int64_t* build_keys, size_t nbuild,
+			   const int64_t* probe_keys, size_t nprobe,
+			   hash_join_pair* out, size_t out_capacity, size_t* nmatches,
+			   hash_function_t hash_fn, uint8_t prob_method,
+			   const hash_join_config* config)
+{
+	hash_prob_method_t prob_method_fn = choose_prob_method(prob_method);
+
+	if ((!build_keys && nbuild) || (!probe_keys && nprobe) || (!out && out_capacity) ||
+		!nmatches || !hash_fn || !prob_method_fn)
+		return false;
+
+	*nmatches = 0u;
+
+	size_t cutoff = config && config->cutoff ? config->cutoff : HASH_JOIN_DEFAULT_CUTOFF;
+	size_t partition_bytes = config && config->partition_bytes ? config->partition_bytes
+															   : HASH_JOIN_DEFAULT_PARTITION_BYTES;
+	size_t nthreads = config && config->nthreads ? config->nthreads
+												 : parallel_sort_hardware_threads();
+
+	if (nbuild + nprobe < cutoff)
+		nthreads = 1u;
+
+	// enough partitions for every build side to fit partition_bytes, and
+	// a few per thread to balance them
+	size_t rows_per_partition = partition_bytes / (2u * sizeof(hash_join_slot) + sizeof(size_t));
+	rows_per_partition = rows_per_partition ? rows_per_partition : 1u;
+
+	size_t wanted = nbuild / rows_per_partition + 1u;
+	wanted = nthreads > 1u && wanted < nthreads * HASH_JOIN_PARTITIONS_PER_THREAD
+				 ? nthreads * HASH_JOIN_PARTITIONS_PER_THREAD : wanted;
+
+	uint8_t radix_bits = hash_join_radix_bits(wanted);
+
+	hash_join_state state = {
+		.sides = {
+			{ .keys = build_keys, .n = nbuild },
+			{ .keys = probe_keys, .n = nprobe }
+		},
+		.nthreads = nthreads,
+		.npartitions = (size_t) 1u << radix_bits,
+		.radix_bits = radix_bits,
+		.rows_per_partition = rows_per_partition,
+		.hash_fptr = hash_fn,
+		.hash_prob_method = prob_method_fn,
+		.out = out,
+		.out_capacity = out_capacity
+	};
+
+	atomic_init(&state.next_partition, 0u);
+	atomic_init(&state.nmatches, 0u);
+
+	hash_join_context* contexts = (hash_join_context *) calloc(nthreads, sizeof(hash_join_context));
+	thrd_t* threads = (thrd_t *) malloc(nthreads * sizeof(thrd_t));
+	bool* started = (bool *) calloc(nthreads, sizeof(bool));
+	bool ok = contexts && threads && started;
+
+	for (size_t s = 0; ok && s < 2u; ++s)
+	{
+		hash_join_side* side = &state.sides[s];
+
+		side->tuples = (hash_join_tuple *) malloc((side->n ? side->n : 1u) * sizeof(hash_join_tuple));
+		side->offsets = create_vector(nthreads * state.npartitions, sizeof(size_t), true);
+		side->begin = (size_t *) malloc((state.npartitions + 1u) * sizeof(size_t));
+		ok = side->tuples && side->offsets && side->begin;
+	}
+
+	for (size_t t = 0; ok && t < nthreads; ++t)
+		contexts[t] = (hash_join_context){ .state = &state, .thread = t };
+
+	ok = ok && hash_join_run(hash_join_histogram_worker, contexts, threads, started, nthreads);
+
+	for (size_t s = 0; ok && s < 2u; ++s)
+		hash_join_prefix(&state.sides[s], nthreads, state.npartitions);
+
+	ok = ok && hash_join_run(hash_join_scatter_worker, contexts, threads, started, nthreads);
+	ok = ok && hash_join_run(hash_join_probe_worker, contexts, threads, started, nthreads);
+
+	for (size_t s = 0; s < 2u; ++s)
+	{
+		free(state.sides[s].tuples);
+		free(state.sides[s].offsets);
+		free(state.sides[s].begin);
+	}
+
+	free(contexts);
+	free(threads);
+	free(started);
+
+	*nmatches = atomic_load(&state.nmatches);
+	return ok && *nmatches <= out_capacity;
+}
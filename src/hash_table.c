@@ -25,6 +25,9 @@ bool hash_table_realloc(hash_table** pphtable, size_t value_size,
 	if (!new_hash_table)
 		return false;
 
+	new_hash_table->max_load_factor = htable_ptr->max_load_factor;
+	new_hash_table->nprobes = htable_ptr->nprobes;
+
 	for (size_t index = 0; index < old_capacity; ++index)
 	{
 		if (table[index].status == HASH_ENTRY_STATUS_OCCUPIED)
@@ -36,6 +39,10 @@ bool hash_table_realloc(hash_table** pphtable, size_t value_size,
 				hash_table_release(&new_hash_table);
 				return false;
 			}
+
+			// keep the CLOCK bits of hash_cache across rehashes
+			if (table[index].referenced)
+				hash_table_search(table[index].key, new_hash_table)->referenced = 1u;
 		}
 	}
 
@@ -69,6 +76,7 @@ hash_table* hash_table_create(size_t nelems, hash_function_t hash_fn, uint8_t pr
 		.hash_fptr = hash_fn,
 		.capacity = capacity,
 		.hash_prob_method = prob_method_fn,
+		.max_load_factor = HASH_TABLE_MAX_LOAD_FACTOR,
 		.data = mem
 	}, sizeof(hash_table));
 
@@ -83,52 +91,97 @@ hash_table* hash_table_create(size_t nelems, hash_function_t hash_fn, uint8_t pr
 bool hash_table_insert(ssize_t key, const void* value, size_t value_size,
 					   hash_table** pphtable, size_t* number_of_collisions_ptr)
 {
+	if (!value || !pphtable || !*pphtable)
+		return false;
+
 	hash_table* htable_ptr = *pphtable;
 
-	if (!value || !pphtable || !htable_ptr)
+	// grow on live entries, rebuild at the same size when tombstones are
+	// what fills the table
+	double factor = 0.0;
+
+	if (hash_table_load_factor(htable_ptr) > htable_ptr->max_load_factor)
+		factor = HASH_TABLE_CAPACITY_FACTOR;
+	else if ((htable_ptr->size + htable_ptr->deleted) / (double) htable_ptr->capacity > htable_ptr->max_load_factor)
+		factor = 1.0;
+
+	if (factor && !hash_table_realloc(pphtable, value_size, number_of_collisions_ptr, factor))
 		return false;
 
-	if (hash_table_load_factor(htable_ptr) > HASH_TABLE_MAX_LOAD_FACTOR)
+	for (;;)
 	{
-		if (!hash_table_realloc(pphtable, value_size,
-								number_of_collisions_ptr,
-								HASH_TABLE_CAPACITY_FACTOR))
+		// adjust htable_ptr point to new table
+		htable_ptr = *pphtable;
+
+		hash_entry* table = htable_ptr->data;
+		hash_entry* target = NULL;
+		size_t hash_index = htable_ptr->hash_fptr(key, htable_ptr->capacity);
+		size_t nprobs = 0u;
+
+		// the key may sit past a tombstone, so the chain is walked up to a
+		// free slot before the first tombstone is reused
+		for (; nprobs < htable_ptr->capacity; ++nprobs)
 		{
-			return false;
-		}
-	}
+			hash_entry* entry = &table[hash_index];
+			HASH_TABLE_PROBE(htable_ptr);
 
-	// adjust htable_ptr point to new table
-	htable_ptr = *pphtable;
+			if (entry->status == HASH_ENTRY_STATUS_FREE)
+			{
+				target = target ? target : entry;
+				break;
+			}
 
-	hash_entry* table = htable_ptr->data;
-	size_t hash_index = htable_ptr->hash_fptr(key, htable_ptr->capacity);
-	size_t nprobs = 0u;
+			if (entry->status == HASH_ENTRY_STATUS_OCCUPIED && entry->key == key)
+			{
+				void* copy = memdup(value, value_size);
+				if (!copy)
+					return false;
 
-	while (table[hash_index].status == HASH_ENTRY_STATUS_OCCUPIED &&
-		   table[hash_index].key != key)
-	{
-		hash_index = htable_ptr->hash_prob_method(key, ++nprobs,
-												  htable_ptr->capacity,
-												  htable_ptr->hash_fptr);
-	}
+				free(entry->value);
+				entry->value = copy;
 
-	if (number_of_collisions_ptr)
-		*number_of_collisions_ptr = nprobs;
+				if (number_of_collisions_ptr)
+					*number_of_collisions_ptr = nprobs;
 
-	if (table[hash_index].status == HASH_ENTRY_STATUS_DELETED ||
-		table[hash_index].key == key)
-	{
-		free(table[hash_index].value);
-	}
-	else
-		++htable_ptr->size;
+				return true;
+			}
 
-	table[hash_index].key = key;
-	table[hash_index].status = HASH_ENTRY_STATUS_OCCUPIED;
-	table[hash_index].value = memdup(value, value_size);
+			if (!target && entry->status == HASH_ENTRY_STATUS_DELETED)
+				target = entry;
 
-	return true;
+			hash_index = htable_ptr->hash_prob_method(key, nprobs + 1u,
+													  htable_ptr->capacity,
+													  htable_ptr->hash_fptr);
+		}
+
+		if (target)
+		{
+			void* copy = memdup(value, value_size);
+			if (!copy)
+				return false;
+
+			if (target->status == HASH_ENTRY_STATUS_DELETED)
+				--htable_ptr->deleted;
+
+			target->key = key;
+			target->status = HASH_ENTRY_STATUS_OCCUPIED;
+			target->referenced = 0u;
+			target->value = copy;
+			++htable_ptr->size;
+
+			if (number_of_collisions_ptr)
+				*number_of_collisions_ptr = nprobs;
+
+			return true;
+		}
+
+		// the probe sequence never met a usable slot, grow and try again
+		if (!hash_table_realloc(pphtable, value_size, number_of_collisions_ptr,
+								HASH_TABLE_CAPACITY_FACTOR))
+		{
+			return false;
+		}
+	}
 }
 
 hash_entry* hash_table_search(ssize_t key, hash_table* htable_ptr)
@@ -138,22 +191,24 @@ hash_entry* hash_table_search(ssize_t key, hash_table* htable_ptr)
 
 	size_t hash_index = htable_ptr->hash_fptr(key, htable_ptr->capacity);
 	hash_entry* table = htable_ptr->data;
-	size_t nprobs = 0;
 
-	while (table[hash_index].status != HASH_ENTRY_STATUS_FREE)
+	// bounded: a table full of tombstones has no free slot to stop at
+	for (size_t nprobs = 0; nprobs < htable_ptr->capacity; ++nprobs)
 	{
-		if (table[hash_index].key == key &&
-		    table[hash_index].status != HASH_ENTRY_STATUS_DELETED)
+		HASH_TABLE_PROBE(htable_ptr);
+
+		if (table[hash_index].status == HASH_ENTRY_STATUS_FREE ||
+			(table[hash_index].status == HASH_ENTRY_STATUS_OCCUPIED && table[hash_index].key == key))
 		{
 			return &table[hash_index];
 		}
 
-		hash_index = htable_ptr->hash_prob_method(key, ++nprobs,
+		hash_index = htable_ptr->hash_prob_method(key, nprobs + 1u,
 												  htable_ptr->capacity,
 												  htable_ptr->hash_fptr);
 	}
 
-	return &table[hash_index];
+	return NULL;
 }
 
 void* hash_table_get(ssize_t key, hash_table* htable_ptr)
@@ -196,12 +251,18 @@ bool hash_table_remove(ssize_t key, hash_table* htable_ptr)
 	if (bucket->status != HASH_ENTRY_STATUS_OCCUPIED)
 		return false;
 
+	hash_table_erase(htable_ptr, bucket);
+	return true;
+}
+
+void hash_table_erase(hash_table* htable_ptr, hash_entry* bucket)
+{
 	free(bucket->value);
 	bucket->value = NULL;
 	bucket->status = HASH_ENTRY_STATUS_DELETED;
 
 	--htable_ptr->size;
-	return true;
+	++htable_ptr->deleted;
 }
 
 double hash_table_load_factor(hash_table* htable_ptr)
@@ -209,6 +270,15 @@ double hash_table_load_factor(hash_table* htable_ptr)
 	return htable_ptr->size / (double) htable_ptr->capacity;
 }
 
+bool hash_table_set_max_load_factor(hash_table* htable_ptr, double max_load_factor)
+{
+	if (!htable_ptr || !(max_load_factor > 0.0 && max_load_factor < 1.0))
+		return false;
+
+	htable_ptr->max_load_factor = max_load_factor;
+	return true;
+}
+
 bool hash_table_shrink(hash_table** pphtable, size_t value_size,
 					   size_t* ncollisions_ptr, double min_load_factor)
 {
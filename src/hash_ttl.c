@@ -0,0 +1,208 @@
+#include "../include/utils.h"
+#include "../include/hash_ttl.h"
+
+typedef struct hash_ttl_timer_struct
+{
+	uint64_t deadline;
+	ssize_t key;
+} hash_ttl_timer;
+
+static bool hash_ttl_timer_cmp(const void* first, const void* second, size_t size)
+{
+	return ((const hash_ttl_timer *) first)->deadline < ((const hash_ttl_timer *) second)->deadline;
+}
+
+static inline hash_ttl_record* hash_ttl_record_of(const hash_entry* bucket)
+{
+	return (hash_ttl_record *) bucket->value;
+}
+
+// the live entry of key, NULL when there is none
+static inline hash_entry* hash_ttl_find(ssize_t key, hash_ttl* ttl)
+{
+	hash_entry* bucket = hash_table_search(key, ttl->table);
+	return bucket && bucket->status == HASH_ENTRY_STATUS_OCCUPIED ? bucket : NULL;
+}
+
+// drops the entry and its timer
+static void hash_ttl_erase(hash_ttl* ttl, hash_entry* bucket)
+{
+	hash_ttl_record* record = hash_ttl_record_of(bucket);
+
+	if (record->timer != SCOPED_HEAP_INVALID_HANDLE)
+		scoped_heap_erase(ttl->timers, record->timer);
+
+	hash_table_erase(ttl->table, bucket);
+}
+
+// points the record at a timer for deadline, reusing the one it has
+static bool hash_ttl_arm(hash_ttl* ttl, hash_ttl_record* record, ssize_t key, uint64_t deadline)
+{
+	hash_ttl_timer timer = { deadline, key };
+
+	if (deadline == HASH_TTL_NEVER)
+	{
+		if (record->timer != SCOPED_HEAP_INVALID_HANDLE)
+			scoped_heap_erase(ttl->timers, record->timer);
+
+		record->timer = SCOPED_HEAP_INVALID_HANDLE;
+	}
+	else if (record->timer != SCOPED_HEAP_INVALID_HANDLE)
+	{
+		if (!scoped_heap_update(ttl->timers, record->timer, &timer))
+			return false;
+	}
+	else
+	{
+		record->timer = scoped_heap_push(ttl->timers, &timer);
+		if (record->timer == SCOPED_HEAP_INVALID_HANDLE)
+			return false;
+	}
+
+	record->deadline = deadline;
+	return true;
+}
+
+hash_ttl* hash_ttl_create(size_t nelems, size_t value_size,
+						  hash_function_t hash_fn, uint8_t prob_method)
+{
+	hash_ttl ttl =
+	{
+		.table = hash_table_create(nelems, hash_fn, prob_method),
+		.timers = scoped_heap_create(NULL, 0, sizeof(hash_ttl_timer), hash_ttl_timer_cmp),
+		.value_size = value_size,
+		.scratch = (uint8_t *) malloc(sizeof(hash_ttl_record) + value_size)
+	};
+
+	hash_ttl* result = ttl.table && ttl.timers && ttl.scratch ? memdup(&ttl, sizeof(hash_ttl)) : NULL;
+
+	if (!result)
+	{
+		hash_table_release(&ttl.table);
+		scoped_heap_release(&ttl.timers);
+		free(ttl.scratch);
+	}
+
+	return result;
+}
+
+bool hash_ttl_put(ssize_t key, const void* value, uint64_t deadline, hash_ttl* ttl)
+{
+	if (!ttl || !value)
+		return false;
+
+	hash_entry* bucket = hash_ttl_find(key, ttl);
+
+	// replacing keeps the record, and with it the timer handle
+	if (bucket)
+	{
+		memcpy(hash_ttl_record_of(bucket) + 1, value, ttl->value_size);
+		return hash_ttl_arm(ttl, hash_ttl_record_of(bucket), key, deadline);
+	}
+
+	hash_ttl_record record = { HASH_TTL_NEVER, SCOPED_HEAP_INVALID_HANDLE };
+	if (!hash_ttl_arm(ttl, &record, key, deadline))
+		return false;
+
+	memcpy(ttl->scratch, &record, sizeof(hash_ttl_record));
+	memcpy(ttl->scratch + sizeof(hash_ttl_record), value, ttl->value_size);
+
+	if (hash_table_insert(key, ttl->scratch, sizeof(hash_ttl_record) + ttl->value_size, &ttl->table, NULL))
+		return true;
+
+	if (record.timer != SCOPED_HEAP_INVALID_HANDLE)
+		scoped_heap_erase(ttl->timers, record.timer);
+
+	return false;
+}
+
+void* hash_ttl_get(ssize_t key, uint64_t now, hash_ttl* ttl)
+{
+	if (!ttl)
+		return NULL;
+
+	hash_entry* bucket = hash_ttl_find(key, ttl);
+	if (!bucket)
+		return NULL;
+
+	// lazy expiry: never hand out an expired value, even before
+	// hash_ttl_expire_until has run
+	if (hash_ttl_record_of(bucket)->deadline <= now)
+	{
+		hash_ttl_erase(ttl, bucket);
+		return NULL;
+	}
+
+	return hash_ttl_record_of(bucket) + 1;
+}
+
+bool hash_ttl_set_deadline(ssize_t key, uint64_t deadline, uint64_t now, hash_ttl* ttl)
+{
+	hash_entry* bucket = ttl ? hash_ttl_find(key, ttl) : NULL;
+	if (!bucket)
+		return false;
+
+	if (hash_ttl_record_of(bucket)->deadline <= now)
+	{
+		hash_ttl_erase(ttl, bucket);
+		return false;
+	}
+
+	return hash_ttl_arm(ttl, hash_ttl_record_of(bucket), key, deadline);
+}
+
+bool hash_ttl_remove(ssize_t key, hash_ttl* ttl)
+{
+	hash_entry* bucket = ttl ? hash_ttl_find(key, ttl) : NULL;
+	if (!bucket)
+		return false;
+
+	hash_ttl_erase(ttl, bucket);
+	return true;
+}
+
+size_t hash_ttl_expire_until(uint64_t now, hash_ttl* ttl)
+{
+	if (!ttl)
+		return 0u;
+
+	size_t expired = 0u;
+
+	while (scoped_heap_size(ttl->timers))
+	{
+		const hash_ttl_timer* top = (const hash_ttl_timer *) ttl->timers->begin;
+		if (top->deadline > now)
+			break;
+
+		ssize_t key = top->key;
+		scoped_heap_pop(ttl->timers);
+
+		// every timer belongs to a live entry, erase and put keep them paired
+		hash_entry* bucket = hash_ttl_find(key, ttl);
+		if (bucket)
+		{
+			hash_ttl_record_of(bucket)->timer = SCOPED_HEAP_INVALID_HANDLE;
+			hash_table_erase(ttl->table, bucket);
+			++expired;
+		}
+	}
+
+	return expired;
+}
+
+size_t hash_ttl_size(const hash_ttl* ttl)
+{
+	return ttl ? ttl->table->size : 0u;
+}
+
+void hash_ttl_release(hash_ttl** ppttl)
+{
+	if (!ppttl || !*ppttl)
+		return;
+
+	hash_table_release(&(*ppttl)->table);
+	scoped_heap_release(&(*ppttl)->timers);
+	free((*ppttl)->scratch);
+	free(*ppttl);
+	*ppttl = NULL;
+}
@@ -0,0 +1,302 @@
+#include "../include/utils.h"
+#include "../include/scoped_heap.h"
+#include "../include/kway_merge.h"
+
+typedef struct kway_output_struct
+{
+	uint8_t* buffer;
+	size_t count;
+	size_t capacity;
+	size_t elem_size;
+	kway_sink sink;
+	void* sink_ctx;
+} kway_output;
+
+// heap entry of the small-k path, sources are compared through it
+typedef struct kway_heap_entry_struct
+{
+	const kway_source* source;
+	size_t index;
+	comparator cmp;
+	size_t elem_size;
+} kway_heap_entry;
+
+static size_t kway_refill_file(kway_source* source)
+{
+	size_t n = fread(source->buffer, source->elem_size, source->buffer_elems,
+					 (FILE *) source->ctx);
+
+	source->cur = source->buffer;
+	source->end = source->buffer + (n * source->elem_size);
+	return n;
+}
+
+kway_source kway_source_from_memory(const void* begin, const void* end)
+{
+	return (kway_source){ .cur = (const uint8_t *) begin, .end = (const uint8_t *) end };
+}
+
+bool kway_source_from_file(kway_source* source, FILE* file,
+						   size_t elem_size, size_t buffer_elems)
+{
+	if (!source || !file || !elem_size || !buffer_elems)
+		return false;
+
+	uint8_t* buffer = (uint8_t *) malloc(buffer_elems * elem_size);
+	if (!buffer)
+		return false;
+
+	*source = (kway_source){
+		.cur = buffer,
+		.end = buffer,
+		.refill = kway_refill_file,
+		.ctx = file,
+		.buffer = buffer,
+		.buffer_elems = buffer_elems,
+		.elem_size = elem_size
+	};
+
+	return true;
+}
+
+void kway_source_release(kway_source* source)
+{
+	if (!source)
+		return;
+
+	free(source->buffer);
+	*source = (kway_source){ 0 };
+}
+
+bool kway_sink_file(void* ctx, const void* records, size_t size)
+{
+	return !size || fwrite(records, 1u, size, (FILE *) ctx) == size;
+}
+
+bool kway_sink_memory(void* ctx, const void* records, size_t size)
+{
+	kway_memory_sink* target = (kway_memory_sink *) ctx;
+	if ((size_t)(target->end - target->cur) < size)
+		return false;
+
+	memcpy(target->cur, records, size);
+	target->cur += size;
+	return true;
+}
+
+static bool kway_output_flush(kway_output* output)
+{
+	bool success = output->sink(output->sink_ctx, output->buffer,
+								output->count * output->elem_size);
+	output->count = 0u;
+	return success;
+}
+
+static inline bool kway_output_push(kway_output* output, const uint8_t* record)
+{
+	iter_copy(output->buffer + (output->count * output->elem_size), record, output->elem_size);
+
+	if (++output->count == output->capacity)
+		return kway_output_flush(output);
+
+	return true;
+}
+
+// moves the source to its next record, false once it is exhausted
+static inline bool kway_source_advance(kway_source* source, size_t elem_size)
+{
+	source->cur += elem_size;
+
+	if (source->cur != source->end)
+		return true;
+
+	return source->refill && source->refill(source);
+}
+
+static inline bool kway_source_ready(kway_source* source)
+{
+	if (source->cur != source->end)
+		return true;
+
+	return source->refill && source->refill(source);
+}
+
+// true when source a must be emitted before source b, ties go to the
+// lower index so the merge is stable; indexes past k are exhausted
+static inline bool kway_beats(const kway_source* sources, const bool* done, size_t k,
+							  size_t a, size_t b, size_t elem_size, comparator cmp)
+{
+	bool a_done = a >= k || done[a];
+	bool b_done = b >= k || done[b];
+
+	if (a_done || b_done)
+		return !a_done;
+
+	if (a < b)
+		return !cmp(sources[b].cur, sources[a].cur, elem_size);
+
+	return cmp(sources[a].cur, sources[b].cur, elem_size);
+}
+
+static bool kway_merge_loser_tree(kway_source* sources, size_t k, size_t elem_size,
+								  comparator cmp, kway_output* output)
+{
+	size_t leaves = round_up_to_power_of_2(k);
+
+	// tree[0] is the overall winner, tree[1..leaves) the loser of each match
+	size_t* tree = (size_t *) malloc(leaves * sizeof(size_t));
+	size_t* winners = (size_t *) malloc(2u * leaves * sizeof(size_t));
+	bool* done = (bool *) malloc(k * sizeof(bool));
+
+	bool success = tree && winners && done;
+
+	if (success)
+	{
+		for (size_t i = 0; i < k; ++i)
+			done[i] = !kway_source_ready(&sources[i]);
+
+		for (size_t i = 0; i < leaves; ++i)
+			winners[leaves + i] = i;
+
+		for (size_t node = leaves - 1; node; --node)
+		{
+			size_t left = winners[node << 1];
+			size_t right = winners[(node << 1) + 1];
+
+			if (kway_beats(sources, done, k, left, right, elem_size, cmp))
+			{
+				winners[node] = left;
+				tree[node] = right;
+			}
+			else
+			{
+				winners[node] = right;
+				tree[node] = left;
+			}
+		}
+
+		tree[0] = winners[1];
+	}
+
+	while (success)
+	{
+		size_t winner = tree[0];
+		if (winner >= k || done[winner])
+			break;
+
+		kway_source* source = &sources[winner];
+		success = kway_output_push(output, source->cur);
+		done[winner] = !kway_source_advance(source, elem_size);
+
+		// replay the matches on the path from the winner's leaf to the root
+		for (size_t node = (leaves + winner) >> 1; node; node >>= 1)
+		{
+			if (kway_beats(sources, done, k, tree[node], winner, elem_size, cmp))
+			{
+				size_t loser = winner;
+				winner = tree[node];
+				tree[node] = loser;
+			}
+		}
+
+		tree[0] = winner;
+	}
+
+	free(tree);
+	free(winners);
+	free(done);
+	return success;
+}
+
+static bool kway_heap_entry_cmp(const void* left, const void* right, size_t entry_size)
+{
+	const kway_heap_entry* first = (const kway_heap_entry *) left;
+	const kway_heap_entry* second = (const kway_heap_entry *) right;
+
+	if (first->index < second->index)
+		return !first->cmp(second->source->cur, first->source->cur, first->elem_size);
+
+	return first->cmp(first->source->cur, second->source->cur, first->elem_size);
+}
+
+static bool kway_merge_heap(kway_source* sources, size_t k, size_t elem_size,
+							comparator cmp, kway_output* output)
+{
+	scoped_heap* heap = scoped_heap_create(NULL, 0, sizeof(kway_heap_entry), kway_heap_entry_cmp);
+	scoped_heap_handle* handles = (scoped_heap_handle *) malloc(k * sizeof(scoped_heap_handle));
+
+	bool success = heap && handles;
+
+	for (size_t i = 0; success && i < k; ++i)
+	{
+		handles[i] = SCOPED_HEAP_INVALID_HANDLE;
+
+		if (!kway_source_ready(&sources[i]))
+			continue;
+
+		kway_heap_entry entry = { &sources[i], i, cmp, elem_size };
+		handles[i] = scoped_heap_push(heap, &entry);
+		success = handles[i] != SCOPED_HEAP_INVALID_HANDLE;
+	}
+
+	while (success && scoped_heap_size(heap))
+	{
+		const kway_heap_entry* top = (const kway_heap_entry *) heap->begin;
+		size_t index = top->index;
+		kway_source* source = &sources[index];
+
+		success = kway_output_push(output, source->cur);
+
+		// the top source moved, re-sift it in place instead of pop + push
+		if (kway_source_advance(source, elem_size))
+			scoped_heap_update(heap, handles[index], NULL);
+		else
+			scoped_heap_erase(heap, handles[index]);
+	}
+
+	scoped_heap_release(&heap);
+	free(handles);
+	return success;
+}
+
+bool kway_merge(kway_source* sources, size_t k, size_t elem_size, comparator cmp,
+				kway_sink sink, void* sink_ctx, const kway_merge_config* config)
+{
+	if ((!sources && k) || !elem_size || !cmp || !sink)
+		return false;
+
+	size_t output_elems = KWAY_MERGE_DEFAULT_OUTPUT_BUFFER;
+	size_t loser_tree_threshold = KWAY_MERGE_DEFAULT_LOSER_TREE_THRESHOLD;
+
+	if (config)
+	{
+		output_elems = config->output_buffer_elems ? config->output_buffer_elems : output_elems;
+		loser_tree_threshold = config->loser_tree_threshold ? config->loser_tree_threshold
+															: loser_tree_threshold;
+	}
+
+	kway_output output =
+	{
+		.buffer = (uint8_t *) malloc(output_elems * elem_size),
+		.capacity = output_elems,
+		.elem_size = elem_size,
+		.sink = sink,
+		.sink_ctx = sink_ctx
+	};
+
+	if (!output.buffer)
+		return false;
+
+	bool success = true;
+
+	if (k >= loser_tree_threshold)
+		success = kway_merge_loser_tree(sources, k, elem_size, cmp, &output);
+	else if (k)
+		success = kway_merge_heap(sources, k, elem_size, cmp, &output);
+
+	if (success && output.count)
+		success = kway_output_flush(&output);
+
+	free(output.buffer);
+	return success;
+}
@@ -0,0 +1,187 @@
+#include <threads.h>
+#include <stdatomic.h>
+
+#include "../include/utils.h"
+#include "../include/scoped_heap.h"
+#include "../include/multi_queue.h"
+
+typedef struct multi_queue_slot_struct
+{
+	// one queue per cache line, neighbours never share a lock line
+	_Alignas(MULTI_QUEUE_CACHE_LINE) mtx_t lock;
+	scoped_heap* heap;
+} multi_queue_slot;
+
+struct multi_queue_struct
+{
+	multi_queue_slot* slots;
+	size_t nqueues;
+	uint32_t elem_size;
+	comparator cmp;
+	atomic_size_t size;
+};
+
+static atomic_uint_fast64_t multi_queue_seed = 0x9E3779B97F4A7C15ULL;
+static _Thread_local uint64_t multi_queue_rng = 0u;
+
+static size_t multi_queue_random(size_t bound)
+{
+	uint64_t x = multi_queue_rng;
+
+	if (!x)
+	{
+		// every thread gets its own stream the first time it needs one
+		x = atomic_fetch_add(&multi_queue_seed, 0x9E3779B97F4A7C15ULL);
+		x ^= (uint64_t)(uintptr_t) &multi_queue_rng;
+		x = x ? x : 1u;
+	}
+
+	// xorshift64
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	multi_queue_rng = x;
+
+	return (size_t)(x % bound);
+}
+
+multi_queue* multi_queue_create(size_t nqueues, uint32_t elem_size, comparator cmp)
+{
+	if (!nqueues || !elem_size || !cmp)
+		return NULL;
+
+	multi_queue* mq = (multi_queue *) memdup(&(multi_queue){
+		.nqueues = nqueues,
+		.elem_size = elem_size,
+		.cmp = cmp
+	}, sizeof(multi_queue));
+
+	if (!mq)
+		return NULL;
+
+	atomic_init(&mq->size, 0u);
+
+	mq->slots = (multi_queue_slot *) aligned_alloc(MULTI_QUEUE_CACHE_LINE,
+												   nqueues * sizeof(multi_queue_slot));
+	if (!mq->slots)
+	{
+		free(mq);
+		return NULL;
+	}
+
+	for (size_t i = 0; i < nqueues; ++i)
+	{
+		multi_queue_slot* slot = &mq->slots[i];
+		slot->heap = scoped_heap_create(NULL, 0, elem_size, cmp);
+
+		if (!slot->heap || mtx_init(&slot->lock, mtx_plain) != thrd_success)
+		{
+			scoped_heap_release(&slot->heap);
+			mq->nqueues = i;
+			multi_queue_release(&mq);
+			return NULL;
+		}
+	}
+
+	return mq;
+}
+
+// locks a random queue, blocking only after several busy ones in a row
+static multi_queue_slot* multi_queue_lock_random(multi_queue* mq)
+{
+	for (size_t attempt = 0; attempt < MULTI_QUEUE_MAX_ATTEMPTS; ++attempt)
+	{
+		multi_queue_slot* slot = &mq->slots[multi_queue_random(mq->nqueues)];
+
+		if (mtx_trylock(&slot->lock) == thrd_success)
+			return slot;
+	}
+
+	multi_queue_slot* slot = &mq->slots[multi_queue_random(mq->nqueues)];
+	mtx_lock(&slot->lock);
+	return slot;
+}
+
+bool multi_queue_push(multi_queue* mq, const void* element)
+{
+	if (!mq || !element)
+		return false;
+
+	multi_queue_slot* slot = multi_queue_lock_random(mq);
+	bool success = scoped_heap_push(slot->heap, element) != SCOPED_HEAP_INVALID_HANDLE;
+
+	// counted before the element can be popped, so size never wraps
+	if (success)
+		atomic_fetch_add_explicit(&mq->size, 1u, memory_order_relaxed);
+
+	mtx_unlock(&slot->lock);
+	return success;
+}
+
+static bool multi_queue_take(multi_queue* mq, multi_queue_slot* slot, void* out)
+{
+	void* top = scoped_heap_pop(slot->heap);
+	if (!top)
+		return false;
+
+	memcpy(out, top, mq->elem_size);
+	atomic_fetch_sub_explicit(&mq->size, 1u, memory_order_relaxed);
+	return true;
+}
+
+bool multi_queue_pop(multi_queue* mq, void* out)
+{
+	if (!mq || !out)
+		return false;
+
+	while (atomic_load_explicit(&mq->size, memory_order_relaxed))
+	{
+		multi_queue_slot* first = multi_queue_lock_random(mq);
+		multi_queue_slot* second = &mq->slots[multi_queue_random(mq->nqueues)];
+
+		// never wait for the second queue, a busy one is simply skipped
+		bool both = second != first && mtx_trylock(&second->lock) == thrd_success;
+
+		multi_queue_slot* best = first;
+		if (both && scoped_heap_size(second->heap) &&
+			(!scoped_heap_size(first->heap) ||
+			 mq->cmp(second->heap->begin, first->heap->begin, mq->elem_size)))
+		{
+			best = second;
+		}
+
+		bool success = multi_queue_take(mq, best, out);
+
+		if (both)
+			mtx_unlock(&second->lock);
+		mtx_unlock(&first->lock);
+
+		if (success)
+			return true;
+	}
+
+	return false;
+}
+
+size_t multi_queue_size(multi_queue* mq)
+{
+	return mq ? atomic_load(&mq->size) : 0u;
+}
+
+void multi_queue_release(multi_queue** ppmq)
+{
+	if (!ppmq || !*ppmq)
+		return;
+
+	multi_queue* mq = *ppmq;
+
+	for (size_t i = 0; i < mq->nqueues; ++i)
+	{
+		mtx_destroy(&mq->slots[i].lock);
+		scoped_heap_release(&mq->slots[i].heap);
+	}
+
+	free(mq->slots);
+	free(mq);
+	*ppmq = NULL;
+}
@@ -0,0 +1,269 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+	#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <threads.h>
+#include <stdatomic.h>
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <unistd.h>
+#endif
+
+#include "../include/utils.h"
+#include "../include/parallel_sort.h"
+
+typedef struct parallel_sort_task_struct
+{
+	size_t first;  // first run of the task (sort phase) or pair (merge phase)
+	size_t part;   // slice of the merge output handled by this task
+} parallel_sort_task;
+
+typedef struct parallel_sort_context_struct
+{
+	uint8_t* src;
+	uint8_t* dest;
+	size_t elem_size;
+	comparator cmp;
+	size_t* runs;     // run boundaries, in elements
+	size_t nruns;
+	size_t parts;     // slices per merge
+	parallel_sort_task* tasks;
+	size_t ntasks;
+	atomic_size_t next_task;
+	void (*execute)(struct parallel_sort_context_struct* ctx, const parallel_sort_task* task);
+} parallel_sort_context;
+
+size_t parallel_sort_hardware_threads(void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors ? (size_t) info.dwNumberOfProcessors : 1u;
+#else
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (size_t) n : 1u;
+#endif
+}
+
+static int parallel_sort_worker(void* arg)
+{
+	parallel_sort_context* ctx = (parallel_sort_context *) arg;
+
+	for (;;)
+	{
+		size_t index = atomic_fetch_add_explicit(&ctx->next_task, 1u, memory_order_relaxed);
+		if (index >= ctx->ntasks)
+			break;
+
+		ctx->execute(ctx, &ctx->tasks[index]);
+	}
+
+	return 0;
+}
+
+// runs every task of the current phase on nthreads threads (the caller is
+// one of them) and waits for all of them to finish
+static void parallel_sort_run_phase(parallel_sort_context* ctx, thrd_t* threads,
+									size_t nthreads)
+{
+	atomic_store(&ctx->next_task, 0u);
+
+	size_t nworkers = nthreads < ctx->ntasks ? nthreads : ctx->ntasks;
+	size_t started = 0u;
+
+	for (; started + 1 < nworkers; ++started)
+		if (thrd_create(&threads[started], parallel_sort_worker, ctx) != thrd_success)
+			break;
+
+	parallel_sort_worker(ctx);
+
+	for (size_t i = 0; i < started; ++i)
+		thrd_join(threads[i], NULL);
+}
+
+static void parallel_sort_execute_sort(parallel_sort_context* ctx, const parallel_sort_task* task)
+{
+	size_t elem_size = ctx->elem_size;
+	uint8_t* first = ctx->src + (ctx->runs[task->first] * elem_size);
+	uint8_t* last  = ctx->src + (ctx->runs[task->first + 1] * elem_size);
+
+	intro_sort(first, last, elem_size, ctx->cmp);
+}
+
+// number of elements taken from a when the first k merged outputs of
+// a and b are produced (ties go to a, which keeps the merge stable)
+static size_t parallel_sort_co_rank(const uint8_t* a, size_t na,
+									const uint8_t* b, size_t nb,
+									size_t k, size_t elem_size, comparator cmp)
+{
+	size_t lo = k > nb ? k - nb : 0u;
+	size_t hi = k < na ? k : na;
+
+	while (lo < hi)
+	{
+		size_t i = lo + ((hi - lo) >> 1);
+		size_t j = k - i;
+
+		if (j && !cmp(b + ((j - 1) * elem_size), a + (i * elem_size), elem_size))
+			lo = i + 1;
+		else
+			hi = i;
+	}
+
+	return lo;
+}
+
+static void parallel_sort_merge(const uint8_t* a, const uint8_t* a_end,
+								const uint8_t* b, const uint8_t* b_end,
+								uint8_t* out, size_t elem_size, comparator cmp)
+{
+	while (a != a_end && b != b_end)
+	{
+		if (cmp(b, a, elem_size))
+		{
+			iter_copy(out, b, elem_size);
+			b += elem_size;
+		}
+		else
+		{
+			iter_copy(out, a, elem_size);
+			a += elem_size;
+		}
+
+		out += elem_size;
+	}
+
+	if (a != a_end)
+		memcpy(out, a, (size_t)(a_end - a));
+	else if (b != b_end)
+		memcpy(out, b, (size_t)(b_end - b));
+}
+
+static void parallel_sort_execute_merge(parallel_sort_context* ctx, const parallel_sort_task* task)
+{
+	size_t elem_size = ctx->elem_size;
+	size_t first_run = task->first << 1;
+
+	size_t begin = ctx->runs[first_run];
+	size_t mid   = ctx->runs[first_run + 1 < ctx->nruns ? first_run + 1 : ctx->nruns];
+	size_t end   = ctx->runs[first_run + 2 < ctx->nruns ? first_run + 2 : ctx->nruns];
+
+	const uint8_t* a = ctx->src + (begin * elem_size);
+	const uint8_t* b = ctx->src + (mid * elem_size);
+	size_t na = mid - begin;
+	size_t nb = end - mid;
+	size_t total = na + nb;
+
+	size_t k0 = (total * task->part) / ctx->parts;
+	size_t k1 = (total * (task->part + 1)) / ctx->parts;
+
+	size_t i0 = parallel_sort_co_rank(a, na, b, nb, k0, elem_size, ctx->cmp);
+	size_t i1 = parallel_sort_co_rank(a, na, b, nb, k1, elem_size, ctx->cmp);
+
+	parallel_sort_merge(a + (i0 * elem_size), a + (i1 * elem_size),
+						b + ((k0 - i0) * elem_size), b + ((k1 - i1) * elem_size),
+						ctx->dest + ((begin + k0) * elem_size), elem_size, ctx->cmp);
+}
+
+bool parallel_sort(void* begin, void* end, size_t elem_size,
+				   comparator cmp, const parallel_sort_config* config)
+{
+	if (!begin || !end || !elem_size || !cmp)
+		return false;
+
+	size_t n = (size_t)((uint8_t *)end - (uint8_t *)begin) / elem_size;
+	size_t nthreads = config && config->nthreads ? config->nthreads
+												 : parallel_sort_hardware_threads();
+	size_t cutoff = config && config->cutoff ? config->cutoff
+											 : PARALLEL_SORT_DEFAULT_CUTOFF;
+
+	if (nthreads > n / 2)
+		nthreads = n / 2;
+
+	if (n < cutoff || nthreads < 2)
+	{
+		intro_sort(begin, end, elem_size, cmp);
+		return true;
+	}
+
+	size_t max_tasks = nthreads * PARALLEL_SORT_TASKS_PER_THREAD;
+
+	uint8_t* scratch = (uint8_t *) malloc(n * elem_size);
+	size_t* runs = (size_t *) malloc((nthreads + 1) * sizeof(size_t));
+	parallel_sort_task* tasks = (parallel_sort_task *) malloc(max_tasks * sizeof(parallel_sort_task));
+	thrd_t* threads = (thrd_t *) malloc(nthreads * sizeof(thrd_t));
+
+	if (!scratch || !runs || !tasks || !threads)
+	{
+		// not enough memory for the merge buffer, sort in place instead
+		free(scratch);
+		free(runs);
+		free(tasks);
+		free(threads);
+
+		intro_sort(begin, end, elem_size, cmp);
+		return true;
+	}
+
+	parallel_sort_context ctx =
+	{
+		.src = (uint8_t *) begin,
+		.dest = scratch,
+		.elem_size = elem_size,
+		.cmp = cmp,
+		.runs = runs,
+		.nruns = nthreads,
+		.tasks = tasks,
+		.ntasks = nthreads,
+		.execute = parallel_sort_execute_sort
+	};
+
+	for (size_t r = 0; r <= nthreads; ++r)
+	{
+		runs[r] = (n * r) / nthreads;
+
+		if (r < nthreads)
+			tasks[r] = (parallel_sort_task){ .first = r };
+	}
+
+	parallel_sort_run_phase(&ctx, threads, nthreads);
+
+	ctx.execute = parallel_sort_execute_merge;
+
+	while (ctx.nruns > 1)
+	{
+		size_t npairs = (ctx.nruns + 1) >> 1;
+		size_t parts = max_tasks / npairs;
+		ctx.parts = parts ? parts : 1u;
+		ctx.ntasks = 0u;
+
+		for (size_t pair = 0; pair < npairs; ++pair)
+			for (size_t part = 0; part < ctx.parts; ++part)
+				tasks[ctx.ntasks++] = (parallel_sort_task){ .first = pair, .part = part };
+
+		parallel_sort_run_phase(&ctx, threads, nthreads);
+
+		// every other boundary disappears after the round
+		for (size_t pair = 0; pair < npairs; ++pair)
+			runs[pair] = runs[pair << 1];
+
+		runs[npairs] = n;
+		ctx.nruns = npairs;
+
+		uint8_t* tmp = ctx.src;
+		ctx.src = ctx.dest;
+		ctx.dest = tmp;
+	}
+
+	if (ctx.src != (uint8_t *) begin)
+		memcpy(begin, ctx.src, n * elem_size);
+
+	free(scratch);
+	free(runs);
+	free(tasks);
+	free(threads);
+
+	return true;
+}
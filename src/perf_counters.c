@@ -0,0 +1,165 @@
+#ifdef __linux__
+	// syscall() is not part of strict C11
+	#define _DEFAULT_SOURCE
+
+	#include <unistd.h>
+	#include <sys/ioctl.h>
+	#include <sys/syscall.h>
+	#include <linux/perf_event.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/perf_counters.h"
+
+struct perf_counters_struct
+{
+	int fds[PERF_COUNTERS_COUNT]; // -1 when unavailable
+};
+
+static const char* perf_counters_names[PERF_COUNTERS_COUNT] =
+{
+	"cycles",
+	"instructions",
+	"l1d_misses",
+	"llc_misses",
+	"branch_misses",
+	"dtlb_misses"
+};
+
+#ifdef __linux__
+
+#define PERF_COUNTERS_CACHE_CONFIG(cache, op, result) \
+	((uint64_t)(cache) | ((uint64_t)(op) << 8) | ((uint64_t)(result) << 16))
+
+static const struct
+{
+	uint32_t type;
+	uint64_t config;
+} perf_counters_events[PERF_COUNTERS_COUNT] =
+{
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	{ PERF_TYPE_HW_CACHE, PERF_COUNTERS_CACHE_CONFIG(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+													 PERF_COUNT_HW_CACHE_RESULT_MISS) },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+	{ PERF_TYPE_HW_CACHE, PERF_COUNTERS_CACHE_CONFIG(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ,
+													 PERF_COUNT_HW_CACHE_RESULT_MISS) }
+};
+
+static int perf_counters_open(size_t counter)
+{
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+
+	attr.size = sizeof(attr);
+	attr.type = perf_counters_events[counter].type;
+	attr.config = perf_counters_events[counter].config;
+	attr.disabled = 1;
+	attr.inherit = 1;        // worker threads of parallel_sort count too
+	attr.exclude_kernel = 1; // allowed with perf_event_paranoid <= 2
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	// this thread, any CPU, no group: one missing event must not take the
+	// others down with it
+	return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+#endif
+
+perf_counters* perf_counters_create(void)
+{
+	perf_counters* counters = (perf_counters *) malloc(sizeof(perf_counters));
+	if (!counters)
+		return NULL;
+
+	for (size_t i = 0; i < PERF_COUNTERS_COUNT; ++i)
+	{
+#ifdef __linux__
+		counters->fds[i] = perf_counters_open(i);
+#else
+		counters->fds[i] = -1;
+#endif
+	}
+
+	return counters;
+}
+
+bool perf_counters_any(const perf_counters* counters)
+{
+	for (size_t i = 0; counters && i < PERF_COUNTERS_COUNT; ++i)
+		if (counters->fds[i] >= 0)
+			return true;
+
+	return false;
+}
+
+const char* perf_counters_name(size_t counter)
+{
+	return counter < PERF_COUNTERS_COUNT ? perf_counters_names[counter] : NULL;
+}
+
+void perf_counters_begin(perf_counters* counters)
+{
+#ifdef __linux__
+	for (size_t i = 0; counters && i < PERF_COUNTERS_COUNT; ++i)
+	{
+		if (counters->fds[i] < 0)
+			continue;
+
+		ioctl(counters->fds[i], PERF_EVENT_IOC_RESET, 0);
+		ioctl(counters->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+#endif
+}
+
+void perf_counters_end(perf_counters* counters, perf_counters_sample* sample)
+{
+	if (!sample)
+		return;
+
+	memset(sample, 0, sizeof(*sample));
+
+#ifdef __linux__
+	for (size_t i = 0; counters && i < PERF_COUNTERS_COUNT; ++i)
+		if (counters->fds[i] >= 0)
+			ioctl(counters->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+
+	for (size_t i = 0; counters && i < PERF_COUNTERS_COUNT; ++i)
+	{
+		// value, time enabled, time running
+		uint64_t data[3] = { 0 };
+
+		if (counters->fds[i] < 0 || read(counters->fds[i], data, sizeof(data)) != (ssize_t) sizeof(data))
+			continue;
+
+		// never scheduled on the PMU: no value at all
+		if (!data[2])
+			continue;
+
+		double scale = data[1] > data[2] ? (double) data[1] / (double) data[2] : 1.0;
+		sample->values[i] = (uint64_t)((double) data[0] * scale);
+		sample->available[i] = true;
+	}
+#else
+	(void) counters;
+#endif
+}
+
+void perf_counters_release(perf_counters** ppcounters)
+{
+	if (!ppcounters || !*ppcounters)
+		return;
+
+#ifdef __linux__
+	for (size_t i = 0; i < PERF_COUNTERS_COUNT; ++i)
+		if ((*ppcounters)->fds[i] >= 0)
+			close((*ppcounters)->fds[i]);
+#endif
+
+	free(*ppcounters);
+	*ppcounters = NULL;
+}
@@ -0,0 +1,170 @@
+#include "../include/utils.h"
+#include "../include/radix_heap.h"
+
+typedef struct radix_heap_bucket_struct
+{
+	uint8_t* entries; // [key][payload], entry_size bytes each
+	size_t count;
+	size_t capacity;
+} radix_heap_bucket;
+
+struct radix_heap_struct
+{
+	radix_heap_bucket buckets[RADIX_HEAP_BUCKETS];
+	uint64_t last;
+	size_t size;
+	uint32_t elem_size;
+	size_t entry_size;
+};
+
+// 0 for key == last, otherwise 1 + the highest bit where they differ
+static inline size_t radix_heap_bucket_of(uint64_t key, uint64_t last)
+{
+	uint64_t diff = key ^ last;
+	if (!diff)
+		return 0u;
+
+#if defined(__GNUC__) || defined(__clang__)
+	return 64u - (size_t) __builtin_clzll(diff);
+#else
+	size_t bits = 0u;
+	for (; diff; diff >>= 1u)
+		++bits;
+
+	return bits;
+#endif
+}
+
+static inline uint64_t radix_heap_key(const uint8_t* entry)
+{
+	uint64_t key = 0u;
+	memcpy(&key, entry, sizeof(key));
+	return key;
+}
+
+// returns the slot for one more entry at the back of bucket
+static uint8_t* radix_heap_reserve(radix_heap* heap, radix_heap_bucket* bucket)
+{
+	if (bucket->count == bucket->capacity)
+	{
+		size_t capacity = bucket->capacity ? bucket->capacity * 2u : RADIX_HEAP_INITIAL_BUCKET_CAPACITY;
+		uint8_t* entries = (uint8_t *) realloc(bucket->entries, capacity * heap->entry_size);
+		if (!entries)
+			return NULL;
+
+		bucket->entries = entries;
+		bucket->capacity = capacity;
+	}
+
+	return bucket->entries + (bucket->count++ * heap->entry_size);
+}
+
+radix_heap* radix_heap_create(uint32_t elem_size)
+{
+	radix_heap* heap = (radix_heap *) calloc(1u, sizeof(radix_heap));
+	if (!heap)
+		return NULL;
+
+	// keys stay 8-byte aligned inside the buckets
+	heap->elem_size = elem_size;
+	heap->entry_size = (sizeof(uint64_t) + elem_size + 7u) & ~(size_t) 7u;
+	return heap;
+}
+
+bool radix_heap_push(radix_heap* heap, uint64_t key, const void* element)
+{
+	if (!heap || key < heap->last || (heap->elem_size && !element))
+		return false;
+
+	uint8_t* entry = radix_heap_reserve(heap, &heap->buckets[radix_heap_bucket_of(key, heap->last)]);
+	if (!entry)
+		return false;
+
+	memcpy(entry, &key, sizeof(key));
+	if (heap->elem_size)
+		memcpy(entry + sizeof(key), element, heap->elem_size);
+
+	++heap->size;
+	return true;
+}
+
+// moves the smallest key into bucket 0: its bucket is emptied into lower
+// ones relative to the new last key, every entry only ever moves down
+static bool radix_heap_refill(radix_heap* heap)
+{
+	size_t index = 1u;
+	while (!heap->buckets[index].count)
+		++index;
+
+	radix_heap_bucket* bucket = &heap->buckets[index];
+	uint64_t last = radix_heap_key(bucket->entries);
+
+	for (size_t i = 1; i < bucket->count; ++i)
+	{
+		uint64_t key = radix_heap_key(bucket->entries + (i * heap->entry_size));
+		last = key < last ? key : last;
+	}
+
+	// a failed allocation drops the copies made so far, the heap is unchanged
+	size_t counts[RADIX_HEAP_BUCKETS];
+	for (size_t i = 0; i < index; ++i)
+		counts[i] = heap->buckets[i].count;
+
+	for (size_t i = 0; i < bucket->count; ++i)
+	{
+		const uint8_t* src = bucket->entries + (i * heap->entry_size);
+		uint8_t* dest = radix_heap_reserve(heap, &heap->buckets[radix_heap_bucket_of(radix_heap_key(src), last)]);
+
+		if (!dest)
+		{
+			for (size_t j = 0; j < index; ++j)
+				heap->buckets[j].count = counts[j];
+
+			return false;
+		}
+
+		memcpy(dest, src, heap->entry_size);
+	}
+
+	bucket->count = 0u;
+	heap->last = last;
+	return true;
+}
+
+bool radix_heap_pop(radix_heap* heap, uint64_t* key, void* element)
+{
+	if (!heap || !heap->size)
+		return false;
+
+	if (!heap->buckets[0].count && !radix_heap_refill(heap))
+		return false;
+
+	radix_heap_bucket* bucket = &heap->buckets[0];
+	const uint8_t* entry = bucket->entries + (--bucket->count * heap->entry_size);
+
+	if (key)
+		*key = radix_heap_key(entry);
+
+	if (element && heap->elem_size)
+		memcpy(element, entry + sizeof(uint64_t), heap->elem_size);
+
+	--heap->size;
+	return true;
+}
+
+size_t radix_heap_size(radix_heap* heap)
+{
+	return heap ? heap->size : 0u;
+}
+
+void radix_heap_release(radix_heap** ppheap)
+{
+	if (!ppheap || !*ppheap)
+		return;
+
+	for (size_t i = 0; i < RADIX_HEAP_BUCKETS; ++i)
+		free((*ppheap)->buckets[i].entries);
+
+	free(*ppheap);
+	*ppheap = NULL;
+}
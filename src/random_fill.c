@@ -0,0 +1,129 @@
+#include <stdlib.h>
+#include <threads.h>
+
+#include "../include/parallel_sort.h"
+#include "../include/random_fill.h"
+
+typedef struct random_fill_context_struct
+{
+	void* begin;
+	size_t n;
+	size_t elem_size;
+	uint32_t bound;
+	uint64_t seed;
+	size_t first_chunk;
+	size_t last_chunk;
+} random_fill_context;
+
+static int random_fill_worker(void* arg)
+{
+	const random_fill_context* ctx = (const random_fill_context *) arg;
+	xoshiro256 rng = xoshiro256_seed(ctx->seed);
+
+	for (size_t c = 0; c < ctx->first_chunk; ++c)
+		xoshiro256_jump(&rng);
+
+	for (size_t c = ctx->first_chunk; c < ctx->last_chunk; ++c)
+	{
+		// the generator is only copied: the next chunk starts one jump
+		// past the start of this one, not past its last output
+		xoshiro256 stream = rng;
+		xoshiro256_jump(&rng);
+
+		size_t first = c * RANDOM_FILL_CHUNK_SIZE;
+		size_t last = first + RANDOM_FILL_CHUNK_SIZE < ctx->n ? first + RANDOM_FILL_CHUNK_SIZE : ctx->n;
+
+		if (ctx->elem_size == sizeof(uint64_t))
+		{
+			uint64_t* out = (uint64_t *) ctx->begin;
+			for (size_t i = first; i < last; ++i)
+				out[i] = xoshiro256_next(&stream);
+		}
+		else if (ctx->bound)
+		{
+			uint32_t* out = (uint32_t *) ctx->begin;
+			for (size_t i = first; i < last; ++i)
+				out[i] = xoshiro256_bounded32(&stream, ctx->bound);
+		}
+		else
+		{
+			uint32_t* out = (uint32_t *) ctx->begin;
+			for (size_t i = first; i < last; ++i)
+				out[i] = (uint32_t)(xoshiro256_next(&stream) >> 32);
+		}
+	}
+
+	return 0;
+}
+
+static bool random_fill(void* begin, size_t n, size_t elem_size, uint32_t bound,
+						uint64_t seed, const random_fill_config* config)
+{
+	if (!begin && n)
+		return false;
+
+	size_t cutoff = config && config->cutoff ? config->cutoff : RANDOM_FILL_DEFAULT_CUTOFF;
+	size_t nthreads = config && config->nthreads ? config->nthreads
+												 : parallel_sort_hardware_threads();
+
+	size_t nchunks = (n + RANDOM_FILL_CHUNK_SIZE - 1u) / RANDOM_FILL_CHUNK_SIZE;
+	if (n < cutoff || nthreads > nchunks)
+		nthreads = n < cutoff || !nchunks ? 1u : nchunks;
+
+	random_fill_context* contexts = (random_fill_context *) malloc(nthreads * sizeof(random_fill_context));
+	thrd_t* threads = (thrd_t *) malloc(nthreads * sizeof(thrd_t));
+	bool* started = (bool *) calloc(nthreads, sizeof(bool));
+
+	if (!contexts || !threads || !started)
+	{
+		free(contexts);
+		free(threads);
+		free(started);
+		return false;
+	}
+
+	for (size_t t = 0; t < nthreads; ++t)
+	{
+		contexts[t] = (random_fill_context){
+			.begin = begin,
+			.n = n,
+			.elem_size = elem_size,
+			.bound = bound,
+			.seed = seed,
+			.first_chunk = (nchunks * t) / nthreads,
+			.last_chunk = (nchunks * (t + 1u)) / nthreads
+		};
+	}
+
+	// the caller takes the first range, a thread that fails to start has
+	// its range done by the caller afterwards
+	for (size_t t = 1; t < nthreads; ++t)
+		started[t] = thrd_create(&threads[t], random_fill_worker, &contexts[t]) == thrd_success;
+
+	random_fill_worker(&contexts[0]);
+
+	for (size_t t = 1; t < nthreads; ++t)
+	{
+		if (started[t])
+			thrd_join(threads[t], NULL);
+		else
+			random_fill_worker(&contexts[t]);
+	}
+
+	free(contexts);
+	free(threads);
+	free(started);
+	return true;
+}
+
+bool random_fill_u32(uint32_t* begin, uint32_t* end, uint32_t bound,
+					 uint64_t seed, const random_fill_config* config)
+{
+	return random_fill(begin, begin ? (size_t)(end - begin) : 0u, sizeof(uint32_t), bound, seed, config);
+}
+
+bool random_fill_u64(uint64_t* begin, uint64_t* end,
+					 uint64_t seed, const random_fill_config* config)
+{
+	return random_fill(begin, begin ? (size_t)(end - begin) : 0u, sizeof(uint64_t), 0u, seed, config);
+}
@@ -12,18 +12,45 @@ bool scoped_heap_realloc(scoped_heap** ppscpheap, uint8_t factor)
 	size_t old_capacity = scpheap_ptr->capacity * scpheap_ptr->elem_size;
 	size_t new_capacity = factor * old_capacity;
 
-	uint8_t* new_begin = (uint8_t *) malloc(new_capacity);
+	size_t old_count = scpheap_ptr->begin ? scpheap_ptr->capacity : 0u;
+	size_t new_count = new_capacity / scpheap_ptr->elem_size;
+
+	// one spare element past capacity, the bottom-up pop parks its
+	// sifted element there
+	uint8_t* new_begin = (uint8_t *) malloc(new_capacity + scpheap_ptr->elem_size);
 	if (!new_begin)
 		return false;
 
+	size_t* handles = (size_t *) realloc(scpheap_ptr->handles, new_count * sizeof(size_t));
+	if (!handles)
+	{
+		free(new_begin);
+		return false;
+	}
+
+	scpheap_ptr->handles = handles;
+
+	size_t* positions = (size_t *) realloc(scpheap_ptr->positions, new_count * sizeof(size_t));
+	if (!positions)
+	{
+		free(new_begin);
+		return false;
+	}
+
+	scpheap_ptr->positions = positions;
+
+	// the new handles start free, right after the live ones
+	for (size_t index = old_count; index < new_count; ++index)
+		handles[index] = positions[index] = index;
+
 	uint8_t* dest = new_begin;
-	size_t dest_size = new_capacity;
+	size_t dest_size = new_capacity + scpheap_ptr->elem_size;
 
 	if (scpheap_ptr->begin)
 	{
 		memcpy(dest, scpheap_ptr->begin, old_capacity);
 		dest += old_capacity;
-		dest_size = old_capacity;
+		dest_size -= old_capacity;
 		free(scpheap_ptr->begin);
 	}
 
@@ -31,7 +58,7 @@ bool scoped_heap_realloc(scoped_heap** ppscpheap, uint8_t factor)
 
 	scpheap_ptr->begin = new_begin;
 	scpheap_ptr->end = new_begin + (size * scpheap_ptr->elem_size);
-	scpheap_ptr->capacity = new_capacity / scpheap_ptr->elem_size;
+	scpheap_ptr->capacity = new_count;
 
 	return true;
 }
@@ -50,14 +77,11 @@ scoped_heap* scoped_heap_create(const void* src, size_t size,
 	if (!heap)
 		return NULL;
 
-	size_t capacity = heap->capacity = 1u;
-
-	if (src && size)
-		capacity *= size;
+	heap->capacity = (src && size) ? size : 1u;
 
 	if (!scoped_heap_realloc(&heap, SCOPED_HEAP_CAPACITY_FACTOR))
 	{
-		free(heap);
+		scoped_heap_release(&heap);
 		return NULL;
 	}
 
@@ -65,7 +89,8 @@ scoped_heap* scoped_heap_create(const void* src, size_t size,
 	{
 		memcpy(heap->begin, src, size * elem_size);
 		heap->end = heap->begin + (size * elem_size);
-		heap_construct(heap->begin, heap->end, elem_size, cmp);
+		heap_construct_indexed(heap->begin, heap->end, elem_size, cmp,
+							   heap->handles, heap->positions);
 	}
 
 	return heap;
@@ -90,16 +115,24 @@ size_t scoped_heap_size(scoped_heap* scpheap_ptr)
 		return (size_t)(scpheap_ptr->end - scpheap_ptr->begin) / scpheap_ptr->elem_size;
 }
 
-bool scoped_heap_push(scoped_heap* scpheap_ptr, const void* element)
+scoped_heap_handle scoped_heap_top_handle(scoped_heap* scpheap_ptr)
+{
+	if (!scoped_heap_size(scpheap_ptr))
+		return SCOPED_HEAP_INVALID_HANDLE;
+	else
+		return scpheap_ptr->handles[0] + 1;
+}
+
+scoped_heap_handle scoped_heap_push(scoped_heap* scpheap_ptr, const void* element)
 {
 	if (!scpheap_ptr || !element)
-		return false;
+		return SCOPED_HEAP_INVALID_HANDLE;
 
 	size_t size = scoped_heap_size(scpheap_ptr);
 
 	if (size >= scpheap_ptr->capacity)
 		if (!scoped_heap_realloc(&scpheap_ptr, SCOPED_HEAP_CAPACITY_FACTOR))
-			return false;
+			return SCOPED_HEAP_INVALID_HANDLE;
 
 	size_t offset = (size * scpheap_ptr->elem_size);
 	uint8_t* insertion_point = scpheap_ptr->begin + offset;
@@ -107,13 +140,112 @@ bool scoped_heap_push(scoped_heap* scpheap_ptr, const void* element)
 	memcpy(insertion_point, element, scpheap_ptr->elem_size);
 	scpheap_ptr->end += scpheap_ptr->elem_size;
 
+	// the first free handle sits right past the live elements
+	size_t handle = scpheap_ptr->handles[size];
+
 	// ajust heap tree
-	heap_push(scpheap_ptr->begin, scpheap_ptr->end,
-			  scpheap_ptr->elem_size, scpheap_ptr->cmp_fptr);
+	heap_upper_indexed(scpheap_ptr->begin, scpheap_ptr->end, size,
+					   scpheap_ptr->elem_size, scpheap_ptr->cmp_fptr,
+					   scpheap_ptr->handles, scpheap_ptr->positions);
+
+	return handle + 1;
+}
+
+bool scoped_heap_push_range(scoped_heap* scpheap_ptr, const void* src, size_t count,
+							scoped_heap_handle* handles_out)
+{
+	if (!scpheap_ptr || (!src && count))
+		return false;
+
+	size_t size = scoped_heap_size(scpheap_ptr);
+	size_t total = size + count;
+
+	while (total > scpheap_ptr->capacity)
+	{
+		size_t factor = (total + scpheap_ptr->capacity - 1) / scpheap_ptr->capacity;
+		factor = factor < SCOPED_HEAP_CAPACITY_FACTOR ? SCOPED_HEAP_CAPACITY_FACTOR : factor;
+		factor = factor > UINT8_MAX ? UINT8_MAX : factor;
+
+		if (!scoped_heap_realloc(&scpheap_ptr, (uint8_t) factor))
+			return false;
+	}
+
+	size_t elem_size = scpheap_ptr->elem_size;
+
+	memcpy(scpheap_ptr->end, src, count * elem_size);
+	scpheap_ptr->end += count * elem_size;
+
+	// the handles past the old end were free, now they belong to the batch
+	if (handles_out)
+		for (size_t i = 0; i < count; ++i)
+			handles_out[i] = scpheap_ptr->handles[size + i] + 1;
+
+	// k sift-ups cost about k * log2(n) comparisons, a rebuild about 2n
+	size_t log_total = 0u;
+	for (size_t n = total; n >>= 1u; )
+		++log_total;
+
+	if (count * log_total < 2u * total)
+	{
+		for (size_t index = size; index < total; ++index)
+			heap_upper_indexed(scpheap_ptr->begin, scpheap_ptr->end, index,
+							   elem_size, scpheap_ptr->cmp_fptr,
+							   scpheap_ptr->handles, scpheap_ptr->positions);
+	}
+	else
+	{
+		heap_construct_indexed(scpheap_ptr->begin, scpheap_ptr->end,
+							   elem_size, scpheap_ptr->cmp_fptr,
+							   scpheap_ptr->handles, scpheap_ptr->positions);
+	}
+
+	return true;
+}
+
+bool scoped_heap_merge(scoped_heap* dest, scoped_heap* src)
+{
+	if (!dest || !src || dest == src || dest->elem_size != src->elem_size)
+		return false;
+
+	if (!scoped_heap_push_range(dest, src->begin, scoped_heap_size(src), NULL))
+		return false;
 
+	// every handle of src becomes free at once
+	src->end = src->begin;
 	return true;
 }
 
+bool scoped_heap_set_pop_method(scoped_heap* scpheap_ptr, uint8_t pop_method)
+{
+	if (!scpheap_ptr || pop_method > SCOPED_HEAP_POP_BOTTOM_UP)
+		return false;
+
+	scpheap_ptr->pop_method = pop_method;
+	return true;
+}
+
+// moves the top to position size - 1 and refills the root with a
+// bottom-up sift of the old last element
+static void scoped_heap_pop_bottom_up(scoped_heap* scpheap_ptr, size_t size)
+{
+	size_t elem_size = scpheap_ptr->elem_size;
+	size_t last = size - 1;
+
+	uint8_t* scratch = scpheap_ptr->begin + (scpheap_ptr->capacity * elem_size);
+	uint8_t* last_ptr = scpheap_ptr->begin + (last * elem_size);
+	size_t last_handle = scpheap_ptr->handles[last];
+
+	memcpy(scratch, last_ptr, elem_size);
+	memcpy(last_ptr, scpheap_ptr->begin, elem_size);
+
+	scpheap_ptr->handles[last] = scpheap_ptr->handles[0];
+	scpheap_ptr->positions[scpheap_ptr->handles[last]] = last;
+
+	heap_sift_bottom_up_indexed(scpheap_ptr->begin, last, 0, elem_size, scpheap_ptr->cmp_fptr,
+								scratch, last_handle,
+								scpheap_ptr->handles, scpheap_ptr->positions);
+}
+
 void* scoped_heap_pop(scoped_heap* scpheap_ptr)
 {
 	if (!scpheap_ptr || !scpheap_ptr->begin)
@@ -131,8 +263,16 @@ void* scoped_heap_pop(scoped_heap* scpheap_ptr)
 			element = scpheap_ptr->begin;
 			break;
 		default:
-			heap_pop(scpheap_ptr->begin, scpheap_ptr->end,
-				     scpheap_ptr->elem_size, scpheap_ptr->cmp_fptr);
+			if (scpheap_ptr->pop_method == SCOPED_HEAP_POP_BOTTOM_UP)
+				scoped_heap_pop_bottom_up(scpheap_ptr, size);
+			else
+			{
+				heap_index_swap(scpheap_ptr->begin, 0, size - 1, scpheap_ptr->elem_size,
+								scpheap_ptr->handles, scpheap_ptr->positions);
+				heap_down_indexed(scpheap_ptr->begin, scpheap_ptr->end - offset, 0,
+								  scpheap_ptr->elem_size, scpheap_ptr->cmp_fptr,
+								  scpheap_ptr->handles, scpheap_ptr->positions);
+			}
 			element = scpheap_ptr->end - offset;
 			break;
 	}
@@ -141,12 +281,87 @@ void* scoped_heap_pop(scoped_heap* scpheap_ptr)
 	return element;
 }
 
+static bool scoped_heap_locate(scoped_heap* scpheap_ptr, scoped_heap_handle handle,
+							   size_t* position_ptr)
+{
+	if (!scpheap_ptr || handle == SCOPED_HEAP_INVALID_HANDLE ||
+		handle > scpheap_ptr->capacity)
+	{
+		return false;
+	}
+
+	size_t position = scpheap_ptr->positions[handle - 1];
+	if (position >= scoped_heap_size(scpheap_ptr))
+		return false;
+
+	*position_ptr = position;
+	return true;
+}
+
+void* scoped_heap_get(scoped_heap* scpheap_ptr, scoped_heap_handle handle)
+{
+	size_t position = 0u;
+	if (!scoped_heap_locate(scpheap_ptr, handle, &position))
+		return NULL;
+
+	return scpheap_ptr->begin + (position * scpheap_ptr->elem_size);
+}
+
+bool scoped_heap_update(scoped_heap* scpheap_ptr, scoped_heap_handle handle,
+						const void* element)
+{
+	size_t position = 0u;
+	if (!scoped_heap_locate(scpheap_ptr, handle, &position))
+		return false;
+
+	if (element)
+		memcpy(scpheap_ptr->begin + (position * scpheap_ptr->elem_size),
+			   element, scpheap_ptr->elem_size);
+
+	size_t moved = heap_upper_indexed(scpheap_ptr->begin, scpheap_ptr->end, position,
+									  scpheap_ptr->elem_size, scpheap_ptr->cmp_fptr,
+									  scpheap_ptr->handles, scpheap_ptr->positions);
+	if (moved == position)
+	{
+		heap_down_indexed(scpheap_ptr->begin, scpheap_ptr->end, position,
+						  scpheap_ptr->elem_size, scpheap_ptr->cmp_fptr,
+						  scpheap_ptr->handles, scpheap_ptr->positions);
+	}
+
+	return true;
+}
+
+bool scoped_heap_erase(scoped_heap* scpheap_ptr, scoped_heap_handle handle)
+{
+	size_t position = 0u;
+	if (!scoped_heap_locate(scpheap_ptr, handle, &position))
+		return false;
+
+	size_t last = scoped_heap_size(scpheap_ptr) - 1;
+
+	// the erased element goes past the end, its handle becomes free
+	if (position != last)
+	{
+		heap_index_swap(scpheap_ptr->begin, position, last, scpheap_ptr->elem_size,
+						scpheap_ptr->handles, scpheap_ptr->positions);
+	}
+
+	scpheap_ptr->end -= scpheap_ptr->elem_size;
+
+	if (position != last)
+		scoped_heap_update(scpheap_ptr, scpheap_ptr->handles[position] + 1, NULL);
+
+	return true;
+}
+
 void scoped_heap_release(scoped_heap** ppscpheap)
 {
 	if (!ppscpheap || !*ppscpheap)
 		return;
 
 	free((*ppscpheap)->begin);
+	free((*ppscpheap)->handles);
+	free((*ppscpheap)->positions);
 	free(*ppscpheap);
 
 	*ppscpheap = NULL;
@@ -0,0 +1,77 @@
+#include "../include/utils.h"
+#include "../include/scoped_heap.h"
+#include "../include/top_k.h"
+
+// heap entry: the user comparator followed by the element, the heap
+// compares entries in reverse so that the worst kept element is the top
+typedef struct top_k_entry_struct
+{
+	comparator cmp;
+	size_t elem_size;
+} top_k_entry;
+
+static bool top_k_entry_cmp(const void* left, const void* right, size_t entry_size)
+{
+	const top_k_entry* first = (const top_k_entry *) left;
+	const top_k_entry* second = (const top_k_entry *) right;
+
+	return first->cmp(second + 1, first + 1, first->elem_size);
+}
+
+bool select_top_k(const void* begin, const void* end, size_t k,
+				  size_t elem_size, comparator cmp, void* out)
+{
+	if (!begin || !end || !elem_size || !cmp || (k && !out))
+		return false;
+
+	const uint8_t* iter = (const uint8_t *) begin;
+	const uint8_t* last = (const uint8_t *) end;
+	size_t n = (size_t)(last - iter) / elem_size;
+
+	k = k < n ? k : n;
+	if (!k)
+		return true;
+
+	size_t align = _Alignof(max_align_t);
+	size_t entry_size = sizeof(top_k_entry) + elem_size;
+	entry_size = ((entry_size + align - 1u) / align) * align;
+
+	scoped_heap* heap = scoped_heap_create(NULL, 0, (uint32_t) entry_size, top_k_entry_cmp);
+	top_k_entry* entry = (top_k_entry *) malloc(entry_size);
+	bool success = heap && entry;
+
+	if (success)
+	{
+		*entry = (top_k_entry){ cmp, elem_size };
+
+		for (; success && iter != last; iter += elem_size)
+		{
+			if (scoped_heap_size(heap) == k)
+			{
+				// rejected by the worst kept element, the common case
+				top_k_entry* worst = (top_k_entry *) heap->begin;
+				if (!cmp(iter, worst + 1, elem_size))
+					continue;
+
+				// the new element takes the top's place, one sift-down
+				memcpy(worst + 1, iter, elem_size);
+				success = scoped_heap_update(heap, scoped_heap_top_handle(heap), NULL);
+				continue;
+			}
+
+			memcpy(entry + 1, iter, elem_size);
+			success = scoped_heap_push(heap, entry) != SCOPED_HEAP_INVALID_HANDLE;
+		}
+	}
+
+	// the heap yields the worst element first, fill out from the back
+	for (size_t i = k; success && i; --i)
+	{
+		const top_k_entry* top = (const top_k_entry *) scoped_heap_pop(heap);
+		memcpy((uint8_t *) out + ((i - 1) * elem_size), top + 1, elem_size);
+	}
+
+	free(entry);
+	scoped_heap_release(&heap);
+	return success;
+}
@@ -0,0 +1,329 @@
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+
+#include "../include/random_utils.h"
+#include "../include/workload.h"
+
+// consecutive duplicates tolerated before the trace key stream gives up
+#define WORKLOAD_MAX_DUPLICATES (64u)
+
+#define WORKLOAD_NOT_LIVE (SIZE_MAX)
+
+// hits of a zipf access that land on a removed key walk this far before
+// falling back to a uniform pick
+#define WORKLOAD_ZIPF_ACCESS_TRIES (8u)
+
+typedef struct workload_key_stream_struct
+{
+	workload_keys config;
+	xoshiro256 rng;
+	uint64_t counter;
+	uint64_t* cluster_bases;
+	uint64_t* cluster_next;
+} workload_key_stream;
+
+typedef struct workload_key_set_struct
+{
+	uint64_t* slots; // UINT64_MAX = empty, keys never have the top bit set
+	size_t mask;
+} workload_key_set;
+
+static const char* workload_keys_names[WORKLOAD_KEYS_COUNT] =
+{
+	"uniform",
+	"sequential",
+	"strided",
+	"clustered",
+	"zipf"
+};
+
+const char* workload_keys_name(uint8_t shape)
+{
+	return shape < WORKLOAD_KEYS_COUNT ? workload_keys_names[shape] : NULL;
+}
+
+// uniform in [0, n), n > 0; the bias of 53 bits over n is negligible here
+static inline uint64_t workload_below(xoshiro256* rng, uint64_t n)
+{
+	uint64_t value = (uint64_t)(xoshiro256_double(rng) * (double) n);
+	return value < n ? value : n - 1u;
+}
+
+// rank in [0, n) with P(r) ~ 1 / (r + 1)^s, inverting the CDF of the
+// continuous power law: O(1) and no table, whatever n is
+static inline uint64_t workload_zipf_rank(xoshiro256* rng, uint64_t n, double s)
+{
+	double u = xoshiro256_double(rng);
+	double top = (double) n + 1.0;
+	double x;
+
+	if (fabs(s - 1.0) < 1e-9)
+		x = exp(u * log(top));
+	else
+		x = pow(u * (pow(top, 1.0 - s) - 1.0) + 1.0, 1.0 / (1.0 - s));
+
+	uint64_t rank = (uint64_t) x - 1u;
+	return rank < n ? rank : n - 1u;
+}
+
+static bool workload_key_stream_init(workload_key_stream* stream, const workload_keys* config, uint64_t seed)
+{
+	*stream = (workload_key_stream){ .config = *config, .rng = xoshiro256_seed(seed) };
+
+	workload_keys* c = &stream->config;
+	c->stride = c->stride ? c->stride : WORKLOAD_DEFAULT_STRIDE;
+	c->clusters = c->clusters ? c->clusters : WORKLOAD_DEFAULT_CLUSTERS;
+	c->zipf_exponent = c->zipf_exponent > 0.0 ? c->zipf_exponent : WORKLOAD_DEFAULT_ZIPF_EXPONENT;
+
+	if (c->shape >= WORKLOAD_KEYS_COUNT)
+		return false;
+
+	if (c->shape != WORKLOAD_KEYS_CLUSTERED)
+		return true;
+
+	stream->cluster_bases = (uint64_t *) malloc(c->clusters * sizeof(uint64_t));
+	stream->cluster_next = (uint64_t *) calloc(c->clusters, sizeof(uint64_t));
+	if (!stream->cluster_bases || !stream->cluster_next)
+		return false;
+
+	uint64_t span = c->range ? c->range : WORKLOAD_KEY_MASK;
+	for (size_t i = 0; i < c->clusters; ++i)
+		stream->cluster_bases[i] = workload_below(&stream->rng, span);
+
+	return true;
+}
+
+static void workload_key_stream_release(workload_key_stream* stream)
+{
+	free(stream->cluster_bases);
+	free(stream->cluster_next);
+	*stream = (workload_key_stream){ 0 };
+}
+
+static uint64_t workload_key_stream_next(workload_key_stream* stream)
+{
+	const workload_keys* c = &stream->config;
+	uint64_t offset = 0u;
+
+	switch (c->shape)
+	{
+		case WORKLOAD_KEYS_UNIFORM:
+			offset = c->range ? workload_below(&stream->rng, c->range) : xoshiro256_next(&stream->rng);
+			break;
+		case WORKLOAD_KEYS_SEQUENTIAL:
+			offset = stream->counter++;
+			break;
+		case WORKLOAD_KEYS_STRIDED:
+			offset = stream->counter++ * c->stride;
+			break;
+		case WORKLOAD_KEYS_CLUSTERED:
+		{
+			// each cluster hands out a consecutive run from its own base
+			size_t cluster = (size_t) workload_below(&stream->rng, c->clusters);
+			offset = stream->cluster_bases[cluster] + stream->cluster_next[cluster]++;
+			break;
+		}
+		case WORKLOAD_KEYS_ZIPF:
+		{
+			// ranks scattered by an odd multiplier, a bijection before the range
+			uint64_t ranks = c->range ? c->range : WORKLOAD_KEY_MASK;
+			offset = workload_zipf_rank(&stream->rng, ranks, c->zipf_exponent) * UINT64_C(0x9E3779B97F4A7C15);
+			break;
+		}
+	}
+
+	if (c->range)
+		offset %= c->range;
+
+	return (c->base + offset) & WORKLOAD_KEY_MASK;
+}
+
+bool workload_generate_keys(uint64_t* keys, size_t n, const workload_keys* config, uint64_t seed)
+{
+	if ((!keys && n) || !config)
+		return false;
+
+	workload_key_stream stream;
+	bool success = workload_key_stream_init(&stream, config, seed);
+
+	for (size_t i = 0; success && i < n; ++i)
+		keys[i] = workload_key_stream_next(&stream);
+
+	workload_key_stream_release(&stream);
+	return success;
+}
+
+static inline size_t workload_key_set_slot(const workload_key_set* set, uint64_t key)
+{
+	uint64_t h = key;
+	h = (h ^ (h >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+	h = (h ^ (h >> 27)) * UINT64_C(0x94D049BB133111EB);
+	return (size_t)(h ^ (h >> 31)) & set->mask;
+}
+
+// false when the key was already there
+static bool workload_key_set_add(workload_key_set* set, uint64_t key)
+{
+	size_t slot = workload_key_set_slot(set, key);
+
+	for (; set->slots[slot] != UINT64_MAX; slot = (slot + 1u) & set->mask)
+		if (set->slots[slot] == key)
+			return false;
+
+	set->slots[slot] = key;
+	return true;
+}
+
+// the next n distinct keys of the stream
+static bool workload_distinct_keys(uint64_t* keys, size_t n, const workload_keys* config, uint64_t seed)
+{
+	size_t capacity = 16u;
+	while (capacity < 2u * n)
+		capacity <<= 1;
+
+	workload_key_set set = { (uint64_t *) malloc(capacity * sizeof(uint64_t)), capacity - 1u };
+	workload_key_stream stream;
+
+	bool success = set.slots && workload_key_stream_init(&stream, config, seed);
+
+	if (set.slots)
+		memset(set.slots, 0xFF, capacity * sizeof(uint64_t));
+
+	for (size_t i = 0; success && i < n; ++i)
+	{
+		size_t duplicates = 0u;
+
+		do
+			keys[i] = workload_key_stream_next(&stream);
+		while (!workload_key_set_add(&set, keys[i]) && ++duplicates < WORKLOAD_MAX_DUPLICATES);
+
+		// the shape cannot produce n distinct keys in its range
+		success = duplicates < WORKLOAD_MAX_DUPLICATES;
+	}
+
+	if (set.slots)
+		workload_key_stream_release(&stream);
+
+	free(set.slots);
+	return success;
+}
+
+bool workload_trace_create(workload_trace* trace, const workload_keys* keys,
+						   const workload_mix* mix, uint64_t seed)
+{
+	if (!trace || !keys || !mix || keys->shape == WORKLOAD_KEYS_ZIPF ||
+		mix->get_ratio < 0.0 || mix->insert_ratio < 0.0 || mix->get_ratio + mix->insert_ratio > 1.0)
+	{
+		return false;
+	}
+
+	*trace = (workload_trace){ 0 };
+
+	// every op takes at most one new key, misses use keys not inserted yet
+	size_t nkeys = mix->preload + mix->nops + 1u;
+	double exponent = mix->zipf_exponent > 0.0 ? mix->zipf_exponent : WORKLOAD_DEFAULT_ZIPF_EXPONENT;
+
+	uint64_t* universe = (uint64_t *) malloc(nkeys * sizeof(uint64_t));
+	size_t* positions = (size_t *) malloc(nkeys * sizeof(size_t));
+	size_t* live = (size_t *) malloc(nkeys * sizeof(size_t));
+
+	trace->preload = (uint64_t *) malloc((mix->preload ? mix->preload : 1u) * sizeof(uint64_t));
+	trace->ops = (workload_op *) malloc((mix->nops ? mix->nops : 1u) * sizeof(workload_op));
+
+	xoshiro256 rng = xoshiro256_seed(seed);
+	xoshiro256_jump(&rng); // not the stream the keys come from
+
+	bool success = universe && positions && live && trace->preload && trace->ops &&
+				   workload_distinct_keys(universe, nkeys, keys, seed);
+
+	if (!success)
+	{
+		free(universe);
+		free(positions);
+		free(live);
+		workload_trace_release(trace);
+		return false;
+	}
+
+	size_t nlive = 0u;
+	size_t next = 0u;
+
+	for (size_t i = 0; i < nkeys; ++i)
+		positions[i] = WORKLOAD_NOT_LIVE;
+
+	for (; next < mix->preload; ++next)
+	{
+		trace->preload[next] = universe[next];
+		positions[next] = nlive;
+		live[nlive++] = next;
+	}
+
+	for (size_t i = 0; i < mix->nops; ++i)
+	{
+		double u = xoshiro256_double(&rng);
+		uint8_t type = u < mix->get_ratio ? WORKLOAD_OP_GET
+										  : u < mix->get_ratio + mix->insert_ratio ? WORKLOAD_OP_INSERT
+																				   : WORKLOAD_OP_REMOVE;
+		size_t index;
+		bool hit = false;
+
+		if (type == WORKLOAD_OP_INSERT)
+		{
+			index = next++;
+			positions[index] = nlive;
+			live[nlive++] = index;
+		}
+		else if (nlive && xoshiro256_double(&rng) < mix->hit_rate)
+		{
+			index = live[workload_below(&rng, nlive)];
+
+			// zipf access: low ranks are the keys inserted first
+			if (mix->access == WORKLOAD_ACCESS_ZIPF)
+			{
+				size_t rank = (size_t) workload_zipf_rank(&rng, next, exponent);
+
+				for (size_t t = 0; t < WORKLOAD_ZIPF_ACCESS_TRIES; ++t, rank = (rank + 1u) % next)
+				{
+					if (positions[rank] != WORKLOAD_NOT_LIVE)
+					{
+						index = rank;
+						break;
+					}
+				}
+			}
+
+			hit = true;
+
+			if (type == WORKLOAD_OP_REMOVE)
+			{
+				size_t last = live[--nlive];
+				live[positions[index]] = last;
+				positions[last] = positions[index];
+				positions[index] = WORKLOAD_NOT_LIVE;
+			}
+		}
+		else
+			index = next + (size_t) workload_below(&rng, nkeys - next);
+
+		trace->ops[i] = (workload_op){ universe[index], type, hit };
+	}
+
+	trace->npreload = mix->preload;
+	trace->nops = mix->nops;
+
+	free(universe);
+	free(positions);
+	free(live);
+	return true;
+}
+
+void workload_trace_release(workload_trace* trace)
+{
+	if (!trace)
+		return;
+
+	free(trace->preload);
+	free(trace->ops);
+	*trace = (workload_trace){ 0 };
+}
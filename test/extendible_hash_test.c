@@ -0,0 +1,276 @@
+#include <stdio.h>
+#include <threads.h>
+
+#include "../include/utils.h"
+#include "../include/random_utils.h"
+#include "../include/extendible_hash.h"
+
+#define TEST_KEYS (50000u)
+#define TEST_OPS (400000u)
+#define TEST_SNAPSHOTS (4u)
+#define TEST_MANY_KEYS (3000000u)
+
+// random inserts, overwrites and removes against a model. Every insert
+// may add at most one segment, plus the spare the first time one splits.
+static bool test_model(size_t segment_slots, hash_function_t hash_fn, uint8_t prob_method,
+					   xoshiro256* rng)
+{
+	extendible_hash* table = extendible_hash_create(segment_slots, hash_fn, prob_method);
+	uint64_t* values = create_vector(TEST_KEYS, sizeof(uint64_t), true); // 0 = absent
+	bool ret = table && values;
+	size_t size = 0u;
+
+	for (size_t i = 0; ret && i < TEST_OPS; ++i)
+	{
+		// remove less often than insert so the table keeps growing
+		ssize_t key = (ssize_t)(xoshiro256_next(rng) % TEST_KEYS);
+		uint64_t op = xoshiro256_next(rng) % 8u;
+
+		if (op < 3u)
+		{
+			const uint64_t* value = (const uint64_t *) extendible_hash_get(key, table);
+			ret = value ? *value == values[key] : !values[key];
+		}
+		else if (op < 7u)
+		{
+			uint64_t value = i + 1u;
+			size_t segments = extendible_hash_get_stats(table).segments;
+
+			ret = extendible_hash_insert(key, &value, sizeof(value), table) &&
+				  extendible_hash_get_stats(table).segments <= segments + 2u;
+
+			size += !values[key];
+			values[key] = value;
+		}
+		else
+		{
+			ret = extendible_hash_remove(key, table) == (values[key] != 0u);
+			size -= values[key] != 0u;
+			values[key] = 0u;
+		}
+
+		ret = ret && extendible_hash_size(table) == size;
+	}
+
+	for (size_t key = 0; ret && key < TEST_KEYS; ++key)
+	{
+		const uint64_t* value = (const uint64_t *) extendible_hash_get((ssize_t) key, table);
+		ret = value ? *value == values[key] : !values[key];
+	}
+
+	// the directory only deepens as much as the live entries need
+	extendible_hash_stats stats = extendible_hash_get_stats(table);
+	ret = ret && stats.segments >= 2u && stats.size == size &&
+		  stats.segments * segment_slots < 8u * (size + segment_slots);
+
+	extendible_hash_release(&table);
+	free(values);
+	return ret && !table;
+}
+
+// sequential keys and a hash that keeps their order: the directory bits
+// still spread them since they come from a separate mix of the key
+static bool test_sequential(void)
+{
+	extendible_hash* table = extendible_hash_create(64u, hash_by_division, HASH_PROBING_METHOD_LINEAR);
+	bool ret = table != NULL;
+
+	for (ssize_t key = 0; ret && key < (ssize_t) TEST_KEYS; ++key)
+		ret = extendible_hash_insert(key, &key, sizeof(key), table);
+
+	for (ssize_t key = 0; ret && key < (ssize_t) TEST_KEYS; ++key)
+	{
+		const ssize_t* value = (const ssize_t *) extendible_hash_get(key, table);
+		ret = value && *value == key && extendible_hash_remove(key, table);
+	}
+
+	ret = ret && !extendible_hash_size(table) && !extendible_hash_get(0, table);
+
+	extendible_hash_release(&table);
+	return ret;
+}
+
+typedef struct test_reader_struct
+{
+	const extendible_hash_snapshot* snapshot;
+	const uint64_t* values;
+	bool ok;
+} test_reader;
+
+static bool test_matches(const extendible_hash_snapshot* snapshot, const uint64_t* values)
+{
+	size_t size = 0u;
+
+	for (size_t key = 0; key < TEST_KEYS; ++key)
+	{
+		const uint64_t* value = (const uint64_t *) extendible_hash_snapshot_get((ssize_t) key, snapshot);
+		if (value ? *value != values[key] : values[key] != 0u)
+			return false;
+
+		size += values[key] != 0u;
+	}
+
+	return extendible_hash_snapshot_size(snapshot) == size;
+}
+
+static int test_read(void* arg)
+{
+	test_reader* reader = (test_reader *) arg;
+	reader->ok = true;
+
+	for (size_t round = 0; reader->ok && round < 8u; ++round)
+		reader->ok = test_matches(reader->snapshot, reader->values);
+
+	return 0;
+}
+
+// millions of random keys through the smallest segments: every split
+// must find a slot for every entry of the segment it empties
+static bool test_many_keys(uint8_t prob_method, xoshiro256* rng)
+{
+	extendible_hash* table = extendible_hash_create(16u, hash_by_fnv, prob_method);
+	ssize_t* keys = create_vector(TEST_MANY_KEYS, sizeof(ssize_t), false);
+	bool ret = table && keys;
+
+	// 63-bit keys, a repeat among a few million is all but impossible
+	for (size_t i = 0; ret && i < TEST_MANY_KEYS; ++i)
+	{
+		keys[i] = (ssize_t)(xoshiro256_next(rng) >> 1);
+		ret = extendible_hash_insert(keys[i], &keys[i], sizeof(ssize_t), table);
+	}
+
+	ret = ret && extendible_hash_size(table) == TEST_MANY_KEYS;
+
+	for (size_t i = 0; ret && i < TEST_MANY_KEYS; ++i)
+	{
+		const ssize_t* value = (const ssize_t *) extendible_hash_get(keys[i], table);
+		ret = value && *value == keys[i];
+	}
+
+	extendible_hash_release(&table);
+	free(keys);
+	return ret;
+}
+
+// snapshots taken along a random run keep reading what the table held at
+// that point, from other threads while the table keeps changing
+static bool test_snapshots(uint8_t prob_method, xoshiro256* rng)
+{
+	extendible_hash* table = extendible_hash_create(64u, hash_by_fnv, prob_method);
+	uint64_t* values = create_vector(TEST_KEYS * (TEST_SNAPSHOTS + 1u), sizeof(uint64_t), true);
+	extendible_hash_snapshot* snapshots[TEST_SNAPSHOTS] = { NULL };
+	test_reader readers[TEST_SNAPSHOTS];
+	thrd_t threads[TEST_SNAPSHOTS];
+	size_t nthreads = 0u;
+	bool ret = table && values;
+
+	// values[0..TEST_KEYS) is the live table, then one frozen copy per
+	// snapshot. Key 0 stays in, only the overwrites below touch it.
+	values[0] = 1u;
+	ret = ret && extendible_hash_insert(0, &values[0], sizeof(uint64_t), table);
+
+	for (size_t s = 0; ret && s <= TEST_SNAPSHOTS; ++s)
+	{
+		for (size_t i = 0; ret && i < TEST_OPS / 8u; ++i)
+		{
+			ssize_t key = (ssize_t)(1u + xoshiro256_next(rng) % (TEST_KEYS - 1u));
+			uint64_t value = xoshiro256_next(rng) | 1u;
+
+			if (xoshiro256_next(rng) % 4u)
+			{
+				ret = extendible_hash_insert(key, &value, sizeof(value), table);
+				values[key] = value;
+			}
+			else
+			{
+				ret = extendible_hash_remove(key, table) == (values[key] != 0u);
+				values[key] = 0u;
+			}
+		}
+
+		if (!ret || s == TEST_SNAPSHOTS)
+			break;
+
+		size_t copies = extendible_hash_get_stats(table).copied_segments;
+
+		snapshots[s] = extendible_hash_snapshot_create(table);
+		memcpy(values + (s + 1u) * TEST_KEYS, values, TEST_KEYS * sizeof(uint64_t));
+
+		// one overwrite copies the one segment it lands in
+		uint64_t value = values[0] + 2u;
+		ret = snapshots[s] && extendible_hash_insert(0, &value, sizeof(value), table) &&
+			  extendible_hash_get_stats(table).copied_segments == copies + 1u;
+		values[0] = value;
+
+		readers[s] = (test_reader){ snapshots[s], values + (s + 1u) * TEST_KEYS, false };
+		ret = ret && thrd_create(&threads[s], test_read, &readers[s]) == thrd_success;
+		nthreads += ret;
+	}
+
+	for (size_t s = 0; s < nthreads; ++s)
+	{
+		thrd_join(threads[s], NULL);
+		ret = ret && readers[s].ok;
+	}
+
+	// dropping the snapshots out of order leaves the table untouched
+	for (size_t s = 0; s < TEST_SNAPSHOTS; s += 2u)
+		extendible_hash_snapshot_release(&snapshots[s]);
+
+	for (size_t key = 0; ret && key < TEST_KEYS; ++key)
+	{
+		const uint64_t* value = (const uint64_t *) extendible_hash_get((ssize_t) key, table);
+		ret = value ? *value == values[key] : !values[key];
+	}
+
+	extendible_hash_release(&table);
+
+	for (size_t s = 1; ret && s < TEST_SNAPSHOTS; s += 2u)
+		ret = test_matches(snapshots[s], values + (s + 1u) * TEST_KEYS);
+
+	for (size_t s = 0; s < TEST_SNAPSHOTS; ++s)
+		extendible_hash_snapshot_release(&snapshots[s]);
+
+	free(values);
+	return ret;
+}
+
+int main(int argc, char** argv)
+{
+	xoshiro256 rng = xoshiro256_seed(0x9E3779B97F4A7C15ULL);
+	uint8_t methods[] = { HASH_PROBING_METHOD_LINEAR, HASH_PROBING_METHOD_QUADRATIC, HASH_PROBING_METHOD_DOUBLE_HASHING };
+	size_t segment_slots[] = { 16u, 256u, 4096u };
+
+	for (size_t m = 0; m < ArrayCount(methods); ++m)
+	{
+		for (size_t s = 0; s < ArrayCount(segment_slots); ++s)
+		{
+			bool success = test_model(segment_slots[s], hash_by_fnv, methods[m], &rng) &&
+						   test_model(segment_slots[s], hash_by_division, methods[m], &rng);
+
+			printf("[+] probe method %u, %zu slots per segment: %s\n", (unsigned) methods[m],
+				   segment_slots[s], success ? "OK" : "FAILED");
+
+			if (!success)
+				return EXIT_FAILURE;
+		}
+	}
+
+	bool success = test_sequential();
+	printf("[+] sequential keys: %s\n", success ? "OK" : "FAILED");
+
+	for (size_t m = 0; success && m < ArrayCount(methods); ++m)
+	{
+		success = test_many_keys(methods[m], &rng);
+		printf("[+] probe method %u, %u keys in 16-slot segments: %s\n", (unsigned) methods[m],
+			   TEST_MANY_KEYS, success ? "OK" : "FAILED");
+	}
+
+	for (size_t m = 0; success && m < ArrayCount(methods); ++m)
+	{
+		success = test_snapshots(methods[m], &rng);
+		printf("[+] probe method %u, snapshots: %s\n", (unsigned) methods[m], success ? "OK" : "FAILED");
+	}
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,92 @@
+#include <stdio.h>
+
+#include "../include/utils.h"
+#include "../include/external_sort.h"
+
+#define TEST_INPUT_PATH  "external_sort_test_input.bin"
+#define TEST_OUTPUT_PATH "external_sort_test_output.bin"
+#define TEST_VECTOR_SIZE (200000u)
+
+static bool write_input(const int* data, size_t n)
+{
+	FILE* file = fopen(TEST_INPUT_PATH, "wb");
+	if (!file)
+		return false;
+
+	bool success = fwrite(data, sizeof(int), n, file) == n;
+	return (fclose(file) == 0) && success;
+}
+
+static bool check_output(const int* expected, size_t n)
+{
+	FILE* file = fopen(TEST_OUTPUT_PATH, "rb");
+	if (!file)
+		return false;
+
+	int* data = create_vector(n + 1, sizeof(int), false);
+	bool success = data && fread(data, sizeof(int), n + 1, file) == n &&
+				   !memcmp(data, expected, n * sizeof(int));
+
+	free(data);
+	fclose(file);
+	return success;
+}
+
+static bool run_case(const int* input, const int* expected, size_t n,
+					 const external_sort_config* config)
+{
+	if (!write_input(input, n))
+		return false;
+
+	bool success = external_sort(TEST_INPUT_PATH, TEST_OUTPUT_PATH, sizeof(int),
+								 less_than_i32, config) &&
+				   check_output(expected, n);
+
+	remove(TEST_INPUT_PATH);
+	remove(TEST_OUTPUT_PATH);
+	return success;
+}
+
+int main(int argc, char** argv)
+{
+	int* input = create_vector(TEST_VECTOR_SIZE, sizeof(int), false);
+	if (!input)
+		return EXIT_FAILURE;
+
+	srand(42u);
+	for (size_t i = 0; i < TEST_VECTOR_SIZE; ++i)
+		input[i] = rand() % 100000;
+
+	int* expected = memdup(input, TEST_VECTOR_SIZE * sizeof(int));
+	if (!expected)
+	{
+		free(input);
+		return EXIT_FAILURE;
+	}
+
+	intro_sort(expected, expected + TEST_VECTOR_SIZE, sizeof(int), less_than_i32);
+
+	external_sort_config configs[] =
+	{
+		// fits in memory, no runs are spilled
+		{ .memory_budget = TEST_VECTOR_SIZE * sizeof(int), .temp_dir = "." },
+		// 49 runs merged in one pass
+		{ .memory_budget = 16384u, .io_buffer_size = 256u, .temp_dir = "." },
+		// fan-in of 3, several merge passes
+		{ .memory_budget = 16384u, .io_buffer_size = 4096u, .temp_dir = "." },
+	};
+
+	bool success = run_case(input, expected, 0u, &configs[0]);
+
+	for (size_t i = 0; success && i < ArrayCount(configs); ++i)
+	{
+		success = run_case(input, expected, TEST_VECTOR_SIZE, &configs[i]);
+		printf("[+] memory budget %zu bytes: %s\n", configs[i].memory_budget,
+			   success ? "OK" : "FAILED");
+	}
+
+	free(input);
+	free(expected);
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,128 @@
+#include <stdio.h>
+
+#include "../include/utils.h"
+#include "../include/random_utils.h"
+#include "../include/hash_aggregate.h"
+
+#define TEST_ROWS (300000u)
+#define TEST_KEY_RANGE (20000u)
+
+// every group of the table against a plain array indexed by key
+static bool test_matches(const hash_aggregate* aggregate, const hash_aggregate_group* model, bool counts_only)
+{
+	size_t size = 0u;
+
+	for (size_t k = 0; k < TEST_KEY_RANGE; ++k)
+	{
+		int64_t key = (int64_t) k - (int64_t)(TEST_KEY_RANGE / 2u);
+		const hash_aggregate_group* group = hash_aggregate_find(key, aggregate);
+
+		if (!model[k].count)
+		{
+			if (group)
+				return false;
+
+			continue;
+		}
+
+		++size;
+
+		if (!group || group->key != key || group->count != model[k].count)
+			return false;
+
+		if (!counts_only && (group->sum != model[k].sum || group->min != model[k].min || group->max != model[k].max))
+			return false;
+	}
+
+	hash_aggregate_group* groups = create_vector(size ? size : 1u, sizeof(hash_aggregate_group), false);
+	bool ret = groups && hash_aggregate_size(aggregate) == size &&
+			   hash_aggregate_export(aggregate, groups) == size;
+
+	free(groups);
+	return ret;
+}
+
+static bool test_aggregate(hash_function_t hash_fn, uint8_t prob_method, xoshiro256* rng)
+{
+	int64_t* keys = create_vector(TEST_ROWS, sizeof(int64_t), false);
+	int64_t* values = create_vector(TEST_ROWS, sizeof(int64_t), false);
+	hash_aggregate_group* model = create_vector(TEST_KEY_RANGE, sizeof(hash_aggregate_group), true);
+	hash_aggregate* serial = hash_aggregate_create(0u, 1u, hash_fn, prob_method);
+	hash_aggregate* counts = hash_aggregate_create(TEST_KEY_RANGE, 8u, hash_fn, prob_method);
+	bool ret = keys && values && model && serial && counts;
+
+	for (size_t i = 0; ret && i < TEST_ROWS; ++i)
+	{
+		// a hot range of keys takes half of the rows
+		size_t k = (size_t)(xoshiro256_next(rng) % ((xoshiro256_next(rng) & 1u) ? 64u : TEST_KEY_RANGE));
+		keys[i] = (int64_t) k - (int64_t)(TEST_KEY_RANGE / 2u);
+		values[i] = (int64_t)(xoshiro256_next(rng) % 2000001u) - 1000000;
+
+		hash_aggregate_group* group = &model[k];
+		group->min = !group->count || values[i] < group->min ? values[i] : group->min;
+		group->max = !group->count || values[i] > group->max ? values[i] : group->max;
+		group->sum += values[i];
+		++group->count;
+	}
+
+	// uneven slices so batches straddle the calls
+	for (size_t first = 0; ret && first < TEST_ROWS; )
+	{
+		size_t n = 1u + (size_t)(xoshiro256_next(rng) % 1000u);
+		n = first + n < TEST_ROWS ? n : TEST_ROWS - first;
+
+		ret = hash_aggregate_update(keys + first, values + first, n, serial) &&
+			  hash_aggregate_update(keys + first, NULL, n, counts);
+		first += n;
+	}
+
+	ret = ret && test_matches(serial, model, false) && test_matches(counts, model, true);
+
+	// thread counts and partition counts must not change the groups
+	size_t nthreads[] = { 1u, 2u, 3u, 8u };
+
+	for (size_t t = 0; ret && t < ArrayCount(nthreads); ++t)
+	{
+		hash_aggregate_config config = { .nthreads = nthreads[t], .cutoff = 1u, .npartitions = t * 5u };
+		hash_aggregate* parallel = hash_aggregate_parallel(keys, values, TEST_ROWS, hash_fn, prob_method, &config);
+
+		ret = parallel && test_matches(parallel, model, false);
+		hash_aggregate_release(&parallel);
+	}
+
+	// two halves merged into a table with another partition count
+	hash_aggregate* first = hash_aggregate_parallel(keys, values, TEST_ROWS / 2u, hash_fn, prob_method, NULL);
+	hash_aggregate* second = hash_aggregate_create(0u, 4u, hash_fn, prob_method);
+
+	ret = ret && first && second &&
+		  hash_aggregate_update(keys + TEST_ROWS / 2u, values + TEST_ROWS / 2u, TEST_ROWS - TEST_ROWS / 2u, second) &&
+		  hash_aggregate_merge(first, second) && test_matches(second, model, false);
+
+	hash_aggregate_release(&first);
+	hash_aggregate_release(&second);
+	hash_aggregate_release(&serial);
+	hash_aggregate_release(&counts);
+	free(keys);
+	free(values);
+	free(model);
+	return ret;
+}
+
+int main(int argc, char** argv)
+{
+	xoshiro256 rng = xoshiro256_seed(0x9E3779B97F4A7C15ULL);
+	uint8_t methods[] = { HASH_PROBING_METHOD_LINEAR, HASH_PROBING_METHOD_QUADRATIC, HASH_PROBING_METHOD_DOUBLE_HASHING };
+
+	for (size_t m = 0; m < ArrayCount(methods); ++m)
+	{
+		bool success = test_aggregate(hash_by_fnv, methods[m], &rng) &&
+					   test_aggregate(hash_by_division, methods[m], &rng);
+
+		printf("[+] probe method %u: %s\n", (unsigned) methods[m], success ? "OK" : "FAILED");
+
+		if (!success)
+			return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,111 @@
+#include <stdio.h>
+
+#include "../include/utils.h"
+#include "../include/random_utils.h"
+#include "../include/hash_cache.h"
+
+#define TEST_CAPACITY (1000u)
+#define TEST_KEYS (20000u)
+#define TEST_OPS (200000u)
+#define TEST_HOT_KEYS (100u)
+
+// random puts and gets against a model of what should be cached: the
+// cache stays bounded, hits return the last value put, and only keys the
+// cache reported as evicted (or never put) miss
+static bool test_model(uint8_t prob_method, xoshiro256* rng)
+{
+	hash_cache* cache = hash_cache_create(TEST_CAPACITY, sizeof(uint64_t), hash_by_fnv, prob_method);
+	uint64_t* values = create_vector(TEST_KEYS, sizeof(uint64_t), true); // 0 = not cached
+	bool ret = cache && values;
+	size_t hot_hits = 0u, hot_gets = 0u;
+
+	for (size_t i = 0; ret && i < TEST_OPS; ++i)
+	{
+		// half of the traffic goes to a few hot keys
+		ssize_t key = (ssize_t)(xoshiro256_next(rng) % ((xoshiro256_next(rng) & 1u) ? TEST_HOT_KEYS : TEST_KEYS));
+
+		if (xoshiro256_next(rng) % 4u)
+		{
+			const uint64_t* value = (const uint64_t *) hash_cache_get(key, cache);
+			ret = value ? *value == values[key] : !values[key];
+
+			hot_gets += key < TEST_HOT_KEYS;
+			hot_hits += key < TEST_HOT_KEYS && value;
+		}
+		else
+		{
+			uint64_t value = i + 1u;
+			hash_cache_eviction evicted;
+
+			ret = hash_cache_put(key, &value, cache, &evicted) && hash_cache_size(cache) <= TEST_CAPACITY;
+
+			if (ret && evicted.evicted)
+			{
+				ret = evicted.key != key && values[evicted.key] &&
+					  *(const uint64_t *) evicted.value == values[evicted.key];
+
+				values[evicted.key] = 0u;
+				free(evicted.value);
+			}
+
+			values[key] = value;
+		}
+	}
+
+	// CLOCK keeps the referenced hot keys far better than their share
+	ret = ret && hot_hits * 10u > hot_gets * 9u;
+
+	hash_cache_release(&cache);
+	free(values);
+	return ret;
+}
+
+// a referenced entry survives a full sweep, an untouched one does not
+static bool test_second_chance(void)
+{
+	hash_cache* cache = hash_cache_create(4u, sizeof(int), hash_by_division, HASH_PROBING_METHOD_LINEAR);
+	bool ret = cache != NULL;
+
+	for (int key = 0; ret && key < 4; ++key)
+		ret = hash_cache_put(key, &key, cache, NULL);
+
+	ret = ret && hash_cache_get(0, cache) && hash_cache_get(2, cache);
+
+	hash_cache_eviction evicted;
+	ret = ret && hash_cache_put(10, &(int){ 10 }, cache, &evicted) && evicted.evicted &&
+		  evicted.key == 1 && *(int *) evicted.value == 1;
+
+	if (evicted.evicted)
+		free(evicted.value);
+
+	ret = ret && hash_cache_put(11, &(int){ 11 }, cache, NULL) &&
+		  hash_cache_get(0, cache) && hash_cache_get(2, cache) && !hash_cache_get(3, cache) &&
+		  hash_cache_get(10, cache) && hash_cache_get(11, cache) && hash_cache_size(cache) == 4u;
+
+	// replacing a cached key never evicts
+	ret = ret && hash_cache_put(0, &(int){ 100 }, cache, &evicted) && !evicted.evicted &&
+		  *(int *) hash_cache_get(0, cache) == 100 && hash_cache_remove(0, cache) &&
+		  hash_cache_size(cache) == 3u;
+
+	hash_cache_release(&cache);
+	return ret;
+}
+
+int main(int argc, char** argv)
+{
+	xoshiro256 rng = xoshiro256_seed(0x9E3779B97F4A7C15ULL);
+
+	bool success = test_second_chance();
+	printf("[+] second chance: %s\n", success ? "OK" : "FAILED");
+
+	uint8_t methods[] = { HASH_PROBING_METHOD_LINEAR, HASH_PROBING_METHOD_QUADRATIC,
+						  HASH_PROBING_METHOD_DOUBLE_HASHING };
+
+	for (size_t i = 0; success && i < ArrayCount(methods); ++i)
+	{
+		success = test_model(methods[i], &rng);
+		printf("[+] bounded cache, probing %u: %s\n", methods[i], success ? "OK" : "FAILED");
+	}
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,129 @@
+#include <stdio.h>
+
+#include "../include/utils.h"
+#include "../include/random_utils.h"
+#include "../include/hash_join.h"
+
+#define TEST_BUILD_ROWS (20000u)
+#define TEST_PROBE_ROWS (50000u)
+
+static bool less_than_pair(const void* first, const void* second, size_t size)
+{
+	(void) size;
+	const hash_join_pair* a = (const hash_join_pair *) first;
+	const hash_join_pair* b = (const hash_join_pair *) second;
+	return a->build < b->build || (a->build == b->build && a->probe < b->probe);
+}
+
+// every pair is a real match, no pair twice, and as many as the key
+// counts of both sides say
+static bool test_pairs(const int64_t* build, const int64_t* probe, hash_join_pair* pairs,
+					   size_t n, size_t expected)
+{
+	if (n != expected)
+		return false;
+
+	intro_sort(pairs, pairs + n, sizeof(hash_join_pair), less_than_pair);
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		if (pairs[i].build >= TEST_BUILD_ROWS || pairs[i].probe >= TEST_PROBE_ROWS ||
+			build[pairs[i].build] != probe[pairs[i].probe])
+			return false;
+
+		if (i && !less_than_pair(&pairs[i - 1u], &pairs[i], sizeof(hash_join_pair)))
+			return false;
+	}
+
+	return true;
+}
+
+static bool test_join(size_t key_range, hash_function_t hash_fn, uint8_t prob_method, xoshiro256* rng)
+{
+	int64_t* build = create_vector(TEST_BUILD_ROWS, sizeof(int64_t), false);
+	int64_t* probe = create_vector(TEST_PROBE_ROWS, sizeof(int64_t), false);
+	size_t* counts = create_vector(2u * key_range, sizeof(size_t), true);
+	bool ret = build && probe && counts;
+
+	// negative keys too, and probe keys outside the build range
+	for (size_t i = 0; ret && i < TEST_BUILD_ROWS; ++i)
+	{
+		size_t k = (size_t)(xoshiro256_next(rng) % key_range);
+		build[i] = (int64_t) k - (int64_t)(key_range / 2u);
+		++counts[k];
+	}
+
+	size_t expected = 0u;
+
+	for (size_t i = 0; ret && i < TEST_PROBE_ROWS; ++i)
+	{
+		size_t k = (size_t)(xoshiro256_next(rng) % (2u * key_range));
+		probe[i] = (int64_t) k - (int64_t)(key_range / 2u);
+		expected += k < key_range ? counts[k] : 0u;
+	}
+
+	hash_join_pair* pairs = create_vector(expected ? expected : 1u, sizeof(hash_join_pair), false);
+	ret = ret && pairs;
+
+	// partition sizes from one big table down to thousands of partitions,
+	// then below what one pass can reach so partitions are split again
+	size_t nthreads[] = { 1u, 2u, 5u };
+	size_t partition_bytes[] = { (size_t) 1u << 30, 0u, 1024u, 40u };
+
+	for (size_t t = 0; ret && t < ArrayCount(nthreads); ++t)
+	{
+		for (size_t b = 0; ret && b < ArrayCount(partition_bytes); ++b)
+		{
+			hash_join_config config = { .nthreads = nthreads[t], .cutoff = 1u, .partition_bytes = partition_bytes[b] };
+			size_t nmatches = 0u;
+
+			ret = hash_join(build, TEST_BUILD_ROWS, probe, TEST_PROBE_ROWS, pairs, expected, &nmatches,
+							hash_fn, prob_method, &config) &&
+				  test_pairs(build, probe, pairs, nmatches, expected);
+		}
+	}
+
+	// a short output buffer still gets the full count
+	size_t nmatches = 0u;
+	ret = ret && (!expected || (!hash_join(build, TEST_BUILD_ROWS, probe, TEST_PROBE_ROWS, pairs, expected / 2u,
+										   &nmatches, hash_fn, prob_method, NULL) &&
+								nmatches == expected));
+
+	// empty sides
+	ret = ret && hash_join(build, 0u, probe, TEST_PROBE_ROWS, pairs, 0u, &nmatches, hash_fn, prob_method, NULL) &&
+		  !nmatches &&
+		  hash_join(build, TEST_BUILD_ROWS, probe, 0u, NULL, 0u, &nmatches, hash_fn, prob_method, NULL) &&
+		  !nmatches;
+
+	free(build);
+	free(probe);
+	free(counts);
+	free(pairs);
+	return ret;
+}
+
+int main(int argc, char** argv)
+{
+	xoshiro256 rng = xoshiro256_seed(0x9E3779B97F4A7C15ULL);
+	uint8_t methods[] = { HASH_PROBING_METHOD_LINEAR, HASH_PROBING_METHOD_QUADRATIC, HASH_PROBING_METHOD_DOUBLE_HASHING };
+
+	// mostly unique build keys, then many duplicates per key
+	size_t key_ranges[] = { 1000000u, 5000u };
+
+	for (size_t m = 0; m < ArrayCount(methods); ++m)
+	{
+		for (size_t r = 0; r < ArrayCount(key_ranges); ++r)
+		{
+			bool success = test_join(key_ranges[r], hash_by_fnv, methods[m], &rng) &&
+						   test_join(key_ranges[r], hash_by_division, methods[m], &rng);
+
+			printf("[+] probe method %u, %zu keys: %s\n", (unsigned) methods[m], key_ranges[r],
+				   success ? "OK" : "FAILED");
+
+			if (!success)
+				return EXIT_FAILURE;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
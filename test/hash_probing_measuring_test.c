@@ -0,0 +1,445 @@
+// clock_gettime, CLOCK_MONOTONIC and sysconf are POSIX
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "../include/mem_utils.h"
+#include "../include/hash_utils.h"
+#include "../include/hash_table.h"
+#include "../include/workload.h"
+
+// probes/op comes from hash_table.nprobes, only kept in this build
+#ifndef HASH_TABLE_COUNT_PROBES
+#error "hash_probing_measuring_test needs HASH_TABLE_COUNT_PROBES"
+#endif
+
+// Drives hash_table_insert/get/remove for every hash function x probing
+// method, on tables sized from half the L1 cache to ten times the LLC and
+// filled to several load factors. One row per combination: ns/op and
+// probes/op for inserts, hits, misses and removes, plus bytes/key.
+// Usage:
+//
+//   hash_probing_measuring_test [--max-bytes=N] [--load-factors=a,b]
+//                               [--hashes=a,b] [--probes=a,b]
+//                               [--lookups=N] [--format=text|csv] [--seed=N]
+//
+// hash_by_digit_analysis needs a table built from the key set and is left
+// to hash_table_measuring_test.
+
+#define BENCH_DEFAULT_SEED (42u)
+#define BENCH_DEFAULT_LOOKUPS ((size_t) 1u << 20)
+#define BENCH_DEFAULT_LOAD_FACTORS "0.25,0.5,0.75,0.9"
+#define BENCH_MAX_LOAD_FACTORS (8u)
+#define BENCH_MIN_CAPACITY (64u)
+#define BENCH_KEY_RANGE (UINT64_C(1) << 40)
+
+// used when sysconf does not know the cache sizes
+#define BENCH_FALLBACK_L1 ((size_t) 32u << 10)
+#define BENCH_FALLBACK_L2 ((size_t) 1u << 20)
+#define BENCH_FALLBACK_LLC ((size_t) 8u << 20)
+
+typedef struct bench_hash_struct
+{
+	const char* name;
+	hash_function_t fn;
+} bench_hash;
+
+typedef struct bench_probe_struct
+{
+	const char* name;
+	uint8_t method;
+} bench_probe;
+
+typedef struct bench_size_struct
+{
+	const char* name;
+	size_t bytes; // of the slot array
+} bench_size;
+
+typedef struct bench_options_struct
+{
+	size_t max_bytes; // 0 = no limit
+	double load_factors[BENCH_MAX_LOAD_FACTORS];
+	size_t nload_factors;
+	const char* hashes; // comma-separated names, NULL = all
+	const char* probes;
+	size_t lookups;
+	const char* format;
+	uint64_t seed;
+} bench_options;
+
+// one timed phase
+typedef struct bench_phase_struct
+{
+	double seconds;
+	size_t probes;
+	size_t ops;
+} bench_phase;
+
+enum { BENCH_INSERT, BENCH_HIT, BENCH_MISS, BENCH_REMOVE, BENCH_PHASES };
+
+static const char* bench_phase_names[BENCH_PHASES] = { "insert", "hit", "miss", "remove" };
+
+static const bench_hash bench_hashes[] =
+{
+	{ "division", hash_by_division },
+	{ "fold", hash_by_fold },
+	{ "mul", hash_by_mul },
+	{ "fnv", hash_by_fnv }
+};
+
+static const bench_probe bench_probes[] =
+{
+	{ "linear", HASH_PROBING_METHOD_LINEAR },
+	{ "quadratic", HASH_PROBING_METHOD_QUADRATIC },
+	{ "double", HASH_PROBING_METHOD_DOUBLE_HASHING }
+};
+
+static double bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static size_t bench_cache_size(int name, size_t fallback)
+{
+	long bytes = sysconf(name);
+	return bytes > 0 ? (size_t) bytes : fallback;
+}
+
+static bool bench_selected(const char* list, const char* name)
+{
+	if (!list)
+		return true;
+
+	size_t len = strlen(name);
+
+	for (const char* iter = list; *iter; )
+	{
+		const char* comma = strchr(iter, ',');
+		size_t item_len = comma ? (size_t)(comma - iter) : strlen(iter);
+
+		if (item_len == len && !strncmp(iter, name, len))
+			return true;
+
+		if (!comma)
+			break;
+
+		iter = comma + 1;
+	}
+
+	return false;
+}
+
+static bool bench_parse_count(const char* text, size_t* value)
+{
+	char* rest = NULL;
+	errno = 0;
+
+	unsigned long long parsed = strtoull(text, &rest, 10);
+	if (rest == text || errno == ERANGE || parsed >= SIZE_MAX)
+		return false;
+
+	*value = (size_t) parsed;
+	return true;
+}
+
+static bool bench_parse_load_factors(const char* text, bench_options* options)
+{
+	options->nload_factors = 0u;
+
+	for (const char* iter = text; *iter; )
+	{
+		char* rest = NULL;
+		double value = strtod(iter, &rest);
+
+		if (rest == iter || options->nload_factors == BENCH_MAX_LOAD_FACTORS ||
+			!(value > 0.0 && value < 1.0))
+		{
+			return false;
+		}
+
+		options->load_factors[options->nload_factors++] = value;
+
+		const char* comma = strchr(iter, ',');
+		if (!comma)
+			break;
+
+		iter = comma + 1;
+	}
+
+	return options->nload_factors > 0;
+}
+
+static bool parse_args(int argc, char** argv, bench_options* options)
+{
+	*options = (bench_options){
+		.lookups = BENCH_DEFAULT_LOOKUPS,
+		.format = "text",
+		.seed = BENCH_DEFAULT_SEED
+	};
+
+	bool ok = bench_parse_load_factors(BENCH_DEFAULT_LOAD_FACTORS, options);
+
+	for (int i = 1; ok && i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		size_t seed = 0u;
+
+		if (!strncmp(arg, "--max-bytes=", 12))
+			ok = bench_parse_count(arg + 12, &options->max_bytes);
+		else if (!strncmp(arg, "--load-factors=", 15))
+			ok = bench_parse_load_factors(arg + 15, options);
+		else if (!strncmp(arg, "--hashes=", 9))
+			options->hashes = arg + 9;
+		else if (!strncmp(arg, "--probes=", 9))
+			options->probes = arg + 9;
+		else if (!strncmp(arg, "--lookups=", 10))
+			ok = bench_parse_count(arg + 10, &options->lookups) && options->lookups;
+		else if (!strncmp(arg, "--format=", 9))
+			options->format = arg + 9;
+		else if (!strncmp(arg, "--seed=", 7))
+		{
+			ok = bench_parse_count(arg + 7, &seed);
+			options->seed = seed;
+		}
+		else
+			ok = false;
+
+		if (!ok)
+			fprintf(stderr, "[EXCEPTION] invalid argument '%s'\n", arg);
+	}
+
+	if (ok && strcmp(options->format, "text") && strcmp(options->format, "csv"))
+	{
+		fprintf(stderr, "[EXCEPTION] unknown format '%s'\n", options->format);
+		return false;
+	}
+
+	return ok;
+}
+
+// the largest power-of-two slot count whose array fits in bytes
+static size_t bench_capacity(size_t bytes)
+{
+	size_t capacity = BENCH_MIN_CAPACITY;
+
+	while ((capacity << 1) * sizeof(hash_entry) <= bytes)
+		capacity <<= 1;
+
+	return capacity;
+}
+
+// hit and miss keys of the trace, the hits are also what gets removed
+static bool bench_split(const workload_trace* trace, uint64_t* hits, size_t* nhits,
+						uint64_t* misses, size_t* nmisses)
+{
+	*nhits = *nmisses = 0u;
+
+	for (size_t i = 0; i < trace->nops; ++i)
+	{
+		if (trace->ops[i].hit)
+			hits[(*nhits)++] = trace->ops[i].key;
+		else
+			misses[(*nmisses)++] = trace->ops[i].key;
+	}
+
+	return true;
+}
+
+static bool bench_row(const bench_hash* hash, const bench_probe* probe, size_t capacity, double load_factor,
+					  const workload_trace* trace, const uint64_t* hits, size_t nhits,
+					  const uint64_t* misses, size_t nmisses, bench_phase* phases, size_t* final_capacity)
+{
+	hash_table* table = hash_table_create(capacity, hash->fn, probe->method);
+	bool ret = table && hash_table_set_max_load_factor(table, load_factor);
+	double t1;
+
+	for (size_t p = 0; p < BENCH_PHASES; ++p)
+		phases[p] = (bench_phase){ 0 };
+
+	// inserts
+	size_t probes = ret ? table->nprobes : 0u;
+	t1 = bench_now();
+
+	for (size_t i = 0; ret && i < trace->npreload; ++i)
+		ret = hash_table_insert((ssize_t) trace->preload[i], &trace->preload[i], sizeof(uint64_t), &table, NULL);
+
+	phases[BENCH_INSERT] = (bench_phase){ bench_now() - t1, ret ? table->nprobes - probes : 0u, trace->npreload };
+
+	// successful lookups, each must find its own value
+	probes = ret ? table->nprobes : 0u;
+	t1 = bench_now();
+
+	for (size_t i = 0; ret && i < nhits; ++i)
+	{
+		const uint64_t* value = (const uint64_t *) hash_table_get((ssize_t) hits[i], table);
+		ret = value && *value == hits[i];
+	}
+
+	phases[BENCH_HIT] = (bench_phase){ bench_now() - t1, ret ? table->nprobes - probes : 0u, nhits };
+
+	// unsuccessful lookups
+	probes = ret ? table->nprobes : 0u;
+	t1 = bench_now();
+
+	for (size_t i = 0; ret && i < nmisses; ++i)
+		ret = hash_table_get((ssize_t) misses[i], table) == NULL;
+
+	phases[BENCH_MISS] = (bench_phase){ bench_now() - t1, ret ? table->nprobes - probes : 0u, nmisses };
+
+	// removes of distinct present keys, a hit key may repeat in the trace
+	size_t nremoves = 0u;
+	probes = ret ? table->nprobes : 0u;
+	t1 = bench_now();
+
+	for (size_t i = 0; ret && i < nhits; ++i)
+		nremoves += hash_table_remove((ssize_t) hits[i], table);
+
+	phases[BENCH_REMOVE] = (bench_phase){ bench_now() - t1, ret ? table->nprobes - probes : 0u, nhits };
+
+	*final_capacity = table ? table->capacity : 0u;
+	ret = ret && nremoves && table->size == trace->npreload - nremoves;
+
+	hash_table_release(&table);
+	return ret;
+}
+
+static void bench_report(const char* format, const bench_hash* hash, const bench_probe* probe,
+						 const bench_size* size, size_t capacity, size_t nkeys,
+						 const bench_phase* phases, bool valid)
+{
+	// slot array plus the memdup'd values, allocator headers not included
+	double bytes_per_key = nkeys ? (double)(capacity * sizeof(hash_entry) + nkeys * sizeof(uint64_t)) / (double) nkeys
+								 : 0.0;
+	double load = capacity ? (double) nkeys / (double) capacity : 0.0;
+	bool csv = !strcmp(format, "csv");
+
+	if (csv)
+		printf("%s,%s,%s,%zu,%.4f", hash->name, probe->name, size->name, capacity, load);
+	else
+		printf("%-9s %-10s %-7s %10zu %5.2f", hash->name, probe->name, size->name, capacity, load);
+
+	for (size_t p = 0; p < BENCH_PHASES; ++p)
+	{
+		double ops = (double)(phases[p].ops ? phases[p].ops : 1u);
+		double ns = phases[p].seconds * 1e9 / ops;
+		double probes = (double) phases[p].probes / ops;
+
+		printf(csv ? ",%.2f,%.3f" : " %9.2f %7.3f", ns, probes);
+	}
+
+	if (csv)
+		printf(",%.2f,%d\n", bytes_per_key, valid);
+	else
+		printf(" %9.2f%s\n", bytes_per_key, valid ? "" : " FAILED");
+
+	fflush(stdout);
+}
+
+int main(int argc, char** argv)
+{
+	bench_options options;
+	if (!parse_args(argc, argv, &options))
+		return EXIT_FAILURE;
+
+	size_t l1 = bench_cache_size(_SC_LEVEL1_DCACHE_SIZE, BENCH_FALLBACK_L1);
+	size_t l2 = bench_cache_size(_SC_LEVEL2_CACHE_SIZE, BENCH_FALLBACK_L2);
+	size_t llc = bench_cache_size(_SC_LEVEL3_CACHE_SIZE, l2 > BENCH_FALLBACK_LLC ? l2 : BENCH_FALLBACK_LLC);
+
+	bench_size sizes[] =
+	{
+		{ "L1/2", l1 / 2u },
+		{ "L2/2", l2 / 2u },
+		{ "LLC/2", llc / 2u },
+		{ "2xLLC", llc * 2u },
+		{ "10xLLC", llc * 10u }
+	};
+
+	if (!strcmp(options.format, "csv"))
+	{
+		printf("hash,probe,size,capacity,load");
+		for (size_t p = 0; p < BENCH_PHASES; ++p)
+			printf(",%s_ns_per_op,%s_probes_per_op", bench_phase_names[p], bench_phase_names[p]);
+
+		printf(",bytes_per_key,valid\n");
+	}
+	else
+	{
+		printf("[+] L1 %zu KiB, L2 %zu KiB, LLC %zu KiB\n", l1 >> 10, l2 >> 10, llc >> 10);
+		printf("%-9s %-10s %-7s %10s %5s", "hash", "probe", "size", "capacity", "load");
+
+		for (size_t p = 0; p < BENCH_PHASES; ++p)
+			printf(" %6s ns/op %7s", bench_phase_names[p], "probes");
+
+		printf(" %9s\n", "bytes/key");
+	}
+
+	bool success = true;
+	size_t last_capacity = 0u;
+
+	for (size_t s = 0; success && s < ArrayCount(sizes); ++s)
+	{
+		size_t capacity = bench_capacity(sizes[s].bytes);
+		if (capacity == last_capacity || (options.max_bytes && capacity * sizeof(hash_entry) > options.max_bytes))
+			continue;
+
+		last_capacity = capacity;
+
+		for (size_t l = 0; success && l < options.nload_factors; ++l)
+		{
+			// the same keys and lookups for every combination of this row group
+			workload_keys keys = { .shape = WORKLOAD_KEYS_UNIFORM, .range = BENCH_KEY_RANGE };
+			workload_mix mix =
+			{
+				.preload = (size_t)(options.load_factors[l] * (double) capacity),
+				.nops = options.lookups,
+				.get_ratio = 1.0,
+				.hit_rate = 0.5
+			};
+
+			workload_trace trace = { 0 };
+			uint64_t* hits = (uint64_t *) malloc(mix.nops * sizeof(uint64_t));
+			uint64_t* misses = (uint64_t *) malloc(mix.nops * sizeof(uint64_t));
+			size_t nhits = 0u, nmisses = 0u;
+
+			success = hits && misses && workload_trace_create(&trace, &keys, &mix, options.seed + s + l) &&
+					  bench_split(&trace, hits, &nhits, misses, &nmisses);
+
+			for (size_t h = 0; success && h < ArrayCount(bench_hashes); ++h)
+			{
+				if (!bench_selected(options.hashes, bench_hashes[h].name))
+					continue;
+
+				for (size_t p = 0; success && p < ArrayCount(bench_probes); ++p)
+				{
+					if (!bench_selected(options.probes, bench_probes[p].name))
+						continue;
+
+					bench_phase phases[BENCH_PHASES];
+					size_t final_capacity = 0u;
+
+					success = bench_row(&bench_hashes[h], &bench_probes[p], capacity, options.load_factors[l],
+										&trace, hits, nhits, misses, nmisses, phases, &final_capacity);
+
+					bench_report(options.format, &bench_hashes[h], &bench_probes[p], &sizes[s],
+								 final_capacity, trace.npreload, phases, success);
+				}
+			}
+
+			workload_trace_release(&trace);
+			free(hits);
+			free(misses);
+		}
+	}
+
+	if (!strcmp(options.format, "text"))
+		printf(success ? "[+] Finished\n" : "FAILURE !\n");
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
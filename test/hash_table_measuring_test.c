@@ -1,3 +1,6 @@
+// clock_gettime and CLOCK_MONOTONIC are POSIX
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -6,26 +9,40 @@
 
 #include "../include/mem_utils.h"
 #include "../include/hash_utils.h"
-#include "../thirdy-party/mtwister/mtwister.h"
+#include "../include/hash_table.h"
+#include "../include/perf_counters.h"
+#include "../include/workload.h"
+#include "../include/random_fill.h"
 
 #define HASH_TABLE_SIZE (100000u)
 #define HASH_TABLE_SENTINEL (0xffu)
+#define HASH_TABLE_DEFAULT_SEED (42u)
+#define HASH_TABLE_KEY_RANGE (2000000000u)
+
+// op traces replayed against hash_table: preload n / 2 keys, then n ops
+#define TRACE_GET_RATIO    (0.60)
+#define TRACE_INSERT_RATIO (0.25)
+#define TRACE_HIT_RATE     (0.90)
 
 typedef struct parsed_data_struct
 {
 	size_t key_set_size;
+	uint64_t seed;
 } parsed_data;
 
 typedef struct hash_table_concept_struct
 {
+	const char* name;
 	uint32_t* table_ptr;
 	hash_function_t hash_fptr;
 	size_t ncollisions;
 } hash_table_concept;
 
 bool parse_args(int arg_cnt, char** argv, parsed_data* parsed_data_ptr);
-void random_fill(uint32_t* begin, uint32_t* end, uint32_t m);
-bool measure(size_t n);
+bool measure(size_t n, uint64_t seed);
+bool measure_collisions(uint32_t* key_vector, size_t n);
+bool replay_traces(size_t n, uint64_t seed);
+void report(const char* name, size_t ncollisions, const perf_counters_sample* sample, size_t n);
 
 int main(int argc, char** argv)
 {
@@ -37,7 +54,7 @@ int main(int argc, char** argv)
 		return EXIT_FAILURE;
 	}
 
-	if (!measure(data.key_set_size))
+	if (!measure(data.key_set_size, data.seed))
 	{
 		fprintf(stderr, "FAILURE !\n");
 		return EXIT_FAILURE;
@@ -66,25 +83,59 @@ bool parse_args(int arg_cnt, char** argv, parsed_data* parsed_data_ptr)
 	if (n == SIZE_MAX || errno == ERANGE)
 		return false;
 
-	*parsed_data_ptr = (parsed_data){ .key_set_size = n };
+	// optional seed, the same seed gives the same keys on every run
+	uint64_t seed = HASH_TABLE_DEFAULT_SEED;
+	if (arg_cnt > 2 && argv[2])
+	{
+		seed = strtoull(argv[2], NULL, 10);
+		if (errno == ERANGE)
+			return false;
+	}
+
+	*parsed_data_ptr = (parsed_data){ .key_set_size = n, .seed = seed };
 	return true;
 }
 
-void random_fill(uint32_t* begin, uint32_t* end, uint32_t m)
+bool measure(size_t n, uint64_t seed)
 {
-	MTRand r = seedRand((unsigned) time(NULL));
-	for (uint32_t* iter = begin; iter != end; ++iter)
-		*iter = (uint32_t)genRandLong(&r) % m;
+	uint64_t* keys = create_vector(n ? n : 1u, sizeof(uint64_t), false);
+	uint32_t* key_vector = create_vector(n ? n : 1u, sizeof(uint32_t), false);
+	bool ret = keys && key_vector;
+
+	perf_counters* counters = perf_counters_create();
+	if (!perf_counters_any(counters))
+		printf("[+] hardware counters unavailable, collisions and timings only\n");
+
+	perf_counters_release(&counters);
+
+	// first-slot collisions of the bare hash functions, one key shape at a time
+	for (uint8_t shape = 0; ret && shape < WORKLOAD_KEYS_COUNT; ++shape)
+	{
+		workload_keys config = { .shape = shape, .range = HASH_TABLE_KEY_RANGE };
+
+		// uniform keys are the bulk of big runs, fill them on every core
+		if (shape == WORKLOAD_KEYS_UNIFORM)
+			ret = random_fill_u32(key_vector, key_vector + n, HASH_TABLE_KEY_RANGE, seed, NULL);
+		else
+		{
+			ret = workload_generate_keys(keys, n, &config, seed);
+			for (size_t i = 0; ret && i < n; ++i)
+				key_vector[i] = (uint32_t) keys[i];
+		}
+
+		printf("[+] %s keys\n", workload_keys_name(shape));
+		ret = ret && measure_collisions(key_vector, n);
+	}
+
+	free(keys);
+	free(key_vector);
+
+	return ret && replay_traces(n, seed);
 }
 
-bool measure(size_t n)
+bool measure_collisions(uint32_t* key_vector, size_t n)
 {
-	uint32_t* key_vector = create_vector(n, sizeof(uint32_t), false);
-	if (!key_vector)
-		return false;
-
 	bool ret = false;
-	random_fill(key_vector, key_vector + n, 2000000000U);
 
 	// create deviation table for 2 deviation functions
 	size_t mdigits = get_digit_count(n, 10u);
@@ -92,7 +143,11 @@ bool measure(size_t n)
 	digit_deviation_pair* dev_table_2 = prehash_by_digit_analisys(mdigits, key_vector, n, hash_deviation_func_2);
 
 	if (!dev_table_1 || !dev_table_2)
+	{
+		free(dev_table_1);
+		free(dev_table_2);
 		return false;
+	}
 
 	uint32_t* table1 = create_vector(HASH_TABLE_SIZE, sizeof(uint32_t), true);
 	uint32_t* table2 = create_vector(HASH_TABLE_SIZE, sizeof(uint32_t), true);
@@ -102,22 +157,28 @@ bool measure(size_t n)
 
 	hash_table_concept hash_tables[] =
 	{
-		(hash_table_concept){ table1, hash_by_division, 0u },
-		(hash_table_concept){ table2, hash_by_fold, 0u },
-		(hash_table_concept){ table3, hash_by_mul, 0u },
+		(hash_table_concept){ "division", table1, hash_by_division, 0u },
+		(hash_table_concept){ "fold", table2, hash_by_fold, 0u },
+		(hash_table_concept){ "mul", table3, hash_by_mul, 0u },
 	};
 
 	size_t hash_tables_size = 3u;
 	size_t digit_analisys_func1_collisions = 0;
 	size_t digit_analisys_func2_collisions = 0;
 
-	if (table1 && table2 && table3 && table4 && table5)
+	// one counter region per method, so misses and cycles are not shared
+	perf_counters* counters = perf_counters_create();
+	perf_counters_sample sample;
+
+	if (table1 && table2 && table3 && table4 && table5 && counters)
 	{
-		for (size_t i = 0; i < n; ++i)
+		for (size_t table_index = 0; table_index < hash_tables_size; ++table_index)
 		{
-			for (size_t table_index = 0; table_index < hash_tables_size; ++table_index)
+			hash_table_concept* target = &hash_tables[table_index];
+
+			perf_counters_begin(counters);
+			for (size_t i = 0; i < n; ++i)
 			{
-				hash_table_concept* target = &hash_tables[table_index];
 				size_t hash_index = target->hash_fptr(key_vector[i], HASH_TABLE_SIZE);
 
 				if (target->table_ptr[hash_index] == HASH_TABLE_SENTINEL)
@@ -125,34 +186,42 @@ bool measure(size_t n)
 				else
 					target->table_ptr[hash_index] = HASH_TABLE_SENTINEL;
 			}
+			perf_counters_end(counters, &sample);
 
-			// Special Case
-			size_t hash_index = hash_by_digit_analysis(key_vector[i], HASH_TABLE_SIZE, mdigits, dev_table_1);
+			report(target->name, target->ncollisions, &sample, n);
+		}
 
-			// hash for table deviation 1
+		// Special Case
+		// hash for table deviation 1
+		perf_counters_begin(counters);
+		for (size_t i = 0; i < n; ++i)
+		{
+			size_t hash_index = hash_by_digit_analysis(key_vector[i], HASH_TABLE_SIZE, mdigits, dev_table_1);
 			if (table4[hash_index] == HASH_TABLE_SENTINEL)
 				++digit_analisys_func1_collisions;
 			else
 				table4[hash_index] = HASH_TABLE_SENTINEL;
+		}
+		perf_counters_end(counters, &sample);
+		report("digit analisys [f1]", digit_analisys_func1_collisions, &sample, n);
 
-			// hash for table deviation 2
-			hash_index = hash_by_digit_analysis(key_vector[i], HASH_TABLE_SIZE, mdigits, dev_table_2);
+		// hash for table deviation 2
+		perf_counters_begin(counters);
+		for (size_t i = 0; i < n; ++i)
+		{
+			size_t hash_index = hash_by_digit_analysis(key_vector[i], HASH_TABLE_SIZE, mdigits, dev_table_2);
 			if (table5[hash_index] == HASH_TABLE_SENTINEL)
 				++digit_analisys_func2_collisions;
 			else
 				table5[hash_index] = HASH_TABLE_SENTINEL;
 		}
-
-		printf("[+] division method = %zu collisions\n", hash_tables[0].ncollisions);
-		printf("[+] fold method = %zu collisions\n", hash_tables[1].ncollisions);
-		printf("[+] mul method = %zu collisions\n", hash_tables[2].ncollisions);
-
-		printf("[+] digit analisys [f1] method = %zu collisions\n", digit_analisys_func1_collisions);
-		printf("[+] digit analisys [f2] method = %zu collisions\n", digit_analisys_func2_collisions);
+		perf_counters_end(counters, &sample);
+		report("digit analisys [f2]", digit_analisys_func2_collisions, &sample, n);
 
 		ret = true;
 	}
 
+	perf_counters_release(&counters);
 	free(dev_table_1);
 	free(dev_table_2);
 	free(table1);
@@ -163,3 +232,133 @@ bool measure(size_t n)
 
 	return ret;
 }
+
+void report(const char* name, size_t ncollisions, const perf_counters_sample* sample, size_t n)
+{
+	printf("[+] %s method = %zu collisions", name, ncollisions);
+
+	// counters per inserted key
+	for (size_t c = 0; c < PERF_COUNTERS_COUNT; ++c)
+	{
+		if (sample->available[c])
+			printf(" | %.3f %s/key", (double) sample->values[c] / (double)(n ? n : 1u), perf_counters_name(c));
+	}
+
+	printf("\n");
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+// runs the trace on a fresh table, false when an op disagrees with it
+static bool replay(const workload_trace* trace, hash_function_t hash_fn, perf_counters* counters,
+				   perf_counters_sample* sample, double* seconds)
+{
+	hash_table* table = hash_table_create(0u, hash_fn, HASH_PROBING_METHOD_LINEAR);
+	bool ret = table != NULL;
+
+	for (size_t i = 0; ret && i < trace->npreload; ++i)
+		ret = hash_table_insert((ssize_t) trace->preload[i], &trace->preload[i], sizeof(uint64_t), &table, NULL);
+
+	perf_counters_begin(counters);
+	double t1 = now();
+
+	for (size_t i = 0; ret && i < trace->nops; ++i)
+	{
+		const workload_op* op = &trace->ops[i];
+		ssize_t key = (ssize_t) op->key;
+
+		switch (op->type)
+		{
+			case WORKLOAD_OP_GET:
+			{
+				const uint64_t* value = (const uint64_t *) hash_table_get(key, table);
+				ret = op->hit ? (value && *value == op->key) : !value;
+				break;
+			}
+			case WORKLOAD_OP_INSERT:
+				ret = hash_table_insert(key, &op->key, sizeof(uint64_t), &table, NULL);
+				break;
+			case WORKLOAD_OP_REMOVE:
+				ret = hash_table_remove(key, table) == op->hit;
+				break;
+		}
+	}
+
+	*seconds = now() - t1;
+	perf_counters_end(counters, sample);
+
+	hash_table_release(&table);
+	return ret;
+}
+
+bool replay_traces(size_t n, uint64_t seed)
+{
+	const char* access_names[] = { "uniform", "zipf" };
+	hash_table_concept hash_functions[] =
+	{
+		(hash_table_concept){ "division", NULL, hash_by_division, 0u },
+		(hash_table_concept){ "fold", NULL, hash_by_fold, 0u },
+		(hash_table_concept){ "mul", NULL, hash_by_mul, 0u },
+	};
+
+	perf_counters* counters = perf_counters_create();
+	perf_counters_sample sample;
+	bool ret = counters != NULL;
+
+	// zipf is a key shape for the collision counts only, traces need
+	// distinct keys and take their skew from the access pattern instead
+	for (uint8_t shape = 0; ret && shape < WORKLOAD_KEYS_COUNT; ++shape)
+	{
+		if (shape == WORKLOAD_KEYS_ZIPF)
+			continue;
+
+		for (uint8_t access = WORKLOAD_ACCESS_UNIFORM; ret && access <= WORKLOAD_ACCESS_ZIPF; ++access)
+		{
+			workload_keys keys = { .shape = shape, .range = HASH_TABLE_KEY_RANGE };
+			workload_mix mix =
+			{
+				.preload = n / 2u,
+				.nops = n,
+				.get_ratio = TRACE_GET_RATIO,
+				.insert_ratio = TRACE_INSERT_RATIO,
+				.hit_rate = TRACE_HIT_RATE,
+				.access = access
+			};
+
+			workload_trace trace = { 0 };
+			ret = workload_trace_create(&trace, &keys, &mix, seed);
+
+			for (size_t h = 0; ret && h < ArrayCount(hash_functions); ++h)
+			{
+				double seconds = 0.0;
+
+				ret = replay(&trace, hash_functions[h].hash_fptr, counters, &sample, &seconds);
+
+				char name[64];
+				snprintf(name, sizeof(name), "trace %s/%s %s", workload_keys_name(shape),
+						 access_names[access], hash_functions[h].name);
+
+				printf("[+] %-32s %8.2f ns/op", name, n ? seconds * 1e9 / (double) n : 0.0);
+
+				for (size_t c = 0; c < PERF_COUNTERS_COUNT; ++c)
+				{
+					if (sample.available[c])
+						printf(" | %.3f %s/op", (double) sample.values[c] / (double)(n ? n : 1u),
+							   perf_counters_name(c));
+				}
+
+				printf("%s\n", ret ? "" : " | FAILED");
+			}
+
+			workload_trace_release(&trace);
+		}
+	}
+
+	perf_counters_release(&counters);
+	return ret;
+}
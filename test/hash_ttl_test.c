@@ -0,0 +1,129 @@
+#include <stdio.h>
+
+#include "../include/utils.h"
+#include "../include/random_utils.h"
+#include "../include/hash_ttl.h"
+
+#define TEST_KEYS (5000u)
+#define TEST_STEPS (200u)
+#define TEST_OPS_PER_STEP (500u)
+#define TEST_MISSING (0u)
+
+// model: deadline per key (TEST_MISSING when absent) and the value put.
+// An expired entry stays in the table until a get, set_deadline or
+// expire_until at a time past its deadline removes it, and the model
+// does the same.
+static bool test_model(xoshiro256* rng)
+{
+	hash_ttl* ttl = hash_ttl_create(0u, sizeof(uint64_t), hash_by_fnv, HASH_PROBING_METHOD_QUADRATIC);
+	uint64_t* deadlines = create_vector(TEST_KEYS, sizeof(uint64_t), true);
+	uint64_t* values = create_vector(TEST_KEYS, sizeof(uint64_t), true);
+	bool ret = ttl && deadlines && values;
+
+	// time starts at 1 so that TEST_MISSING is never a live deadline
+	for (uint64_t now = 1u; ret && now <= TEST_STEPS; ++now)
+	{
+		for (size_t i = 0; ret && i < TEST_OPS_PER_STEP; ++i)
+		{
+			ssize_t key = (ssize_t)(xoshiro256_next(rng) % TEST_KEYS);
+			uint64_t op = xoshiro256_next(rng) % 10u;
+			uint64_t deadline = (op == 0u) ? HASH_TTL_NEVER : now + xoshiro256_next(rng) % 20u;
+
+			// get and set_deadline see an expired entry as missing and drop it
+			if (deadlines[key] != TEST_MISSING && deadlines[key] <= now && op >= 4u && op < 9u)
+				deadlines[key] = TEST_MISSING;
+
+			bool present = deadlines[key] != TEST_MISSING;
+
+			if (op < 4u)
+			{
+				uint64_t value = xoshiro256_next(rng);
+				ret = hash_ttl_put(key, &value, deadline, ttl);
+				deadlines[key] = deadline;
+				values[key] = value;
+			}
+			else if (op < 8u)
+			{
+				const uint64_t* value = (const uint64_t *) hash_ttl_get(key, now, ttl);
+				ret = present ? (value && *value == values[key]) : !value;
+			}
+			else if (op == 8u)
+			{
+				ret = hash_ttl_set_deadline(key, deadline, now, ttl) == present;
+				if (present)
+					deadlines[key] = deadline;
+			}
+			else
+			{
+				ret = hash_ttl_remove(key, ttl) == present;
+				deadlines[key] = TEST_MISSING;
+			}
+		}
+
+		// expiring removes exactly the entries whose deadline passed
+		size_t expired = 0u, live = 0u;
+
+		for (size_t key = 0; key < TEST_KEYS; ++key)
+		{
+			if (deadlines[key] != TEST_MISSING && deadlines[key] <= now)
+			{
+				deadlines[key] = TEST_MISSING;
+				++expired;
+			}
+
+			live += deadlines[key] != TEST_MISSING;
+		}
+
+		ret = ret && hash_ttl_expire_until(now, ttl) == expired && hash_ttl_size(ttl) == live;
+	}
+
+	hash_ttl_release(&ttl);
+	free(deadlines);
+	free(values);
+	return ret;
+}
+
+static bool test_basics(void)
+{
+	hash_ttl* ttl = hash_ttl_create(4u, sizeof(int), hash_by_division, HASH_PROBING_METHOD_LINEAR);
+	bool ret = ttl != NULL;
+
+	ret = ret && hash_ttl_put(1, &(int){ 10 }, 5u, ttl) &&
+		  hash_ttl_put(2, &(int){ 20 }, HASH_TTL_NEVER, ttl) &&
+		  hash_ttl_put(3, &(int){ 30 }, 7u, ttl);
+
+	// 4 <= deadline of nothing, 5 takes key 1
+	ret = ret && hash_ttl_expire_until(4u, ttl) == 0u && hash_ttl_expire_until(5u, ttl) == 1u &&
+		  !hash_ttl_get(1, 5u, ttl) && *(int *) hash_ttl_get(2, 5u, ttl) == 20;
+
+	// pushing the deadline out keeps key 3 alive past its first deadline
+	ret = ret && hash_ttl_set_deadline(3, 100u, 5u, ttl) && hash_ttl_expire_until(50u, ttl) == 0u &&
+		  *(int *) hash_ttl_get(3, 50u, ttl) == 30;
+
+	// an entry expired at now is dropped rather than revived
+	ret = ret && hash_ttl_put(4, &(int){ 40 }, 60u, ttl) && !hash_ttl_set_deadline(4, 200u, 60u, ttl) &&
+		  !hash_ttl_get(4, 50u, ttl) && hash_ttl_size(ttl) == 2u;
+
+	// lazy expiry on get, then nothing left for expire_until
+	ret = ret && !hash_ttl_get(3, 100u, ttl) && hash_ttl_expire_until(1000u, ttl) == 0u &&
+		  hash_ttl_size(ttl) == 1u && *(int *) hash_ttl_get(2, UINT64_MAX - 1u, ttl) == 20;
+
+	hash_ttl_release(&ttl);
+	return ret;
+}
+
+int main(int argc, char** argv)
+{
+	xoshiro256 rng = xoshiro256_seed(0x9E3779B97F4A7C15ULL);
+
+	bool success = test_basics();
+	printf("[+] basics: %s\n", success ? "OK" : "FAILED");
+
+	if (success)
+	{
+		success = test_model(&rng);
+		printf("[+] model: %s\n", success ? "OK" : "FAILED");
+	}
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
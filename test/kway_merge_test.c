@@ -0,0 +1,111 @@
+#include <stdio.h>
+
+#include "../include/utils.h"
+#include "../include/kway_merge.h"
+
+#define TEST_MAX_RUN_SIZE (512u)
+
+typedef struct test_record_struct
+{
+	uint32_t key;
+	uint32_t run;
+	uint32_t position;
+} test_record;
+
+static bool less_than_key(const void* first, const void* second, size_t size)
+{
+	(void) size;
+	return ((const test_record *)first)->key < ((const test_record *)second)->key;
+}
+
+static uint64_t next_random(uint64_t* state)
+{
+	// xorshift64, good enough to build test vectors
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+// merges k runs of random length, few distinct keys so ties are common
+static bool test_merge(size_t k, size_t loser_tree_threshold, uint64_t* state)
+{
+	size_t* offsets = (size_t *) malloc((k + 1u) * sizeof(size_t));
+	kway_source* sources = (kway_source *) malloc((k ? k : 1u) * sizeof(kway_source));
+	if (!offsets || !sources)
+	{
+		free(offsets);
+		free(sources);
+		return false;
+	}
+
+	offsets[0] = 0u;
+	for (size_t run = 0; run < k; ++run)
+		offsets[run + 1u] = offsets[run] + (size_t)(next_random(state) % TEST_MAX_RUN_SIZE);
+
+	size_t n = offsets[k];
+	test_record* input = create_vector(n ? n : 1u, sizeof(test_record), false);
+	test_record* output = create_vector(n ? n : 1u, sizeof(test_record), false);
+	bool ret = false;
+
+	if (input && output)
+	{
+		for (size_t run = 0; run < k; ++run)
+		{
+			uint32_t key = 0u;
+			for (size_t i = offsets[run]; i < offsets[run + 1u]; ++i)
+			{
+				key += (uint32_t)(next_random(state) % 3u);
+				input[i] = (test_record){ key, (uint32_t) run, (uint32_t)(i - offsets[run]) };
+			}
+
+			sources[run] = kway_source_from_memory(input + offsets[run], input + offsets[run + 1u]);
+		}
+
+		kway_memory_sink sink = { (uint8_t *) output, (uint8_t *)(output + n) };
+		kway_merge_config config = { .output_buffer_elems = 100u,
+									 .loser_tree_threshold = loser_tree_threshold };
+
+		ret = kway_merge(sources, k, sizeof(test_record), less_than_key,
+						 kway_sink_memory, &sink, &config) &&
+			  sink.cur == (uint8_t *)(output + n);
+
+		// sorted, and equal keys keep the run order then the position order
+		for (size_t i = 1; ret && i < n; ++i)
+		{
+			const test_record* prev = &output[i - 1u];
+			const test_record* cur = &output[i];
+
+			ret = prev->key < cur->key ||
+				  (prev->key == cur->key &&
+				   (prev->run < cur->run || (prev->run == cur->run && prev->position < cur->position)));
+		}
+	}
+
+	free(offsets);
+	free(sources);
+	free(input);
+	free(output);
+	return ret;
+}
+
+int main(int argc, char** argv)
+{
+	size_t ks[] = { 0u, 1u, 3u, 7u, 8u, 64u, 2000u };
+	uint64_t state = 0x9E3779B97F4A7C15ULL;
+
+	for (size_t i = 0; i < ArrayCount(ks); ++i)
+	{
+		// SIZE_MAX keeps the scoped_heap path, 1 always builds the loser tree
+		bool success = test_merge(ks[i], SIZE_MAX, &state) &&
+					   test_merge(ks[i], 1u, &state) &&
+					   test_merge(ks[i], 0u, &state);
+
+		printf("[+] %zu runs: %s\n", ks[i], success ? "OK" : "FAILED");
+
+		if (!success)
+			return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,121 @@
+#include <stdio.h>
+
+#include "../include/utils.h"
+
+#define TEST_MAX_SIZE (20000u)
+#define TEST_ROUNDS (600u)
+
+typedef struct test_record_struct
+{
+	int32_t key;
+	uint32_t position;
+} test_record;
+
+static bool record_less(const void* first, const void* second, size_t size)
+{
+	(void) size;
+	return ((const test_record *)first)->key < ((const test_record *)second)->key;
+}
+
+static uint64_t next_random(uint64_t* state)
+{
+	// xorshift64, good enough to build test vectors
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+// random, runs, descending, sawtooth and mostly sorted inputs, few
+// distinct keys in half of them so stability is actually exercised
+static void fill(test_record* records, size_t n, size_t pattern, uint64_t* state)
+{
+	uint32_t range = (next_random(state) & 1u) ? 4u : 100000u;
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		int32_t key = 0;
+
+		switch (pattern)
+		{
+			case 0:
+				key = (int32_t)(next_random(state) % range);
+				break;
+			case 1:
+				key = (int32_t)(i / (1u + next_random(state) % 3u));
+				break;
+			case 2:
+				key = (int32_t)(n - i);
+				break;
+			case 3:
+				key = (int32_t)((i / 50u) & 1u ? n - i : i);
+				break;
+			default:
+				key = (i % 100u) ? (int32_t) i : (int32_t)(next_random(state) % range);
+				break;
+		}
+
+		records[i] = (test_record){ key, (uint32_t) i };
+	}
+}
+
+static bool stable_sorted(const test_record* records, size_t n)
+{
+	for (size_t i = 1; i < n; ++i)
+	{
+		if (records[i - 1].key > records[i].key ||
+			(records[i - 1].key == records[i].key && records[i - 1].position > records[i].position))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	uint64_t state = 0x9E3779B97F4A7C15ULL;
+	bool success = true;
+
+	for (size_t round = 0; success && round < TEST_ROUNDS; ++round)
+	{
+		size_t n = (size_t)(next_random(&state) % (round & 1u ? TEST_MAX_SIZE : 300u));
+		size_t buffer_elems = (size_t)(next_random(&state) % (n / 4u + 1u));
+
+		// exactly n records and buffer_elems of scratch, so a read past
+		// either one leaves the allocation and sanitizers catch it
+		test_record* records = create_vector(n ? n : 1u, sizeof(test_record), false);
+		test_record* buffer = create_vector(buffer_elems ? buffer_elems : 1u, sizeof(test_record), false);
+		success = records && buffer;
+
+		if (success)
+		{
+			fill(records, n, round % 5u, &state);
+
+			// full scratch, a buffer too small for some merges, and none at all
+			switch (round % 3u)
+			{
+				case 0:
+					success = merge_sort_stable(records, records + n, sizeof(test_record), record_less);
+					break;
+				case 1:
+					success = merge_sort_stable_buffer(records, records + n, sizeof(test_record), record_less,
+													   buffer, buffer_elems);
+					break;
+				default:
+					success = merge_sort_stable_buffer(records, records + n, sizeof(test_record), record_less,
+													   NULL, 0u);
+					break;
+			}
+
+			success = success && stable_sorted(records, n);
+		}
+
+		free(records);
+		free(buffer);
+	}
+
+	printf("[+] stable merge sort: %s\n", success ? "OK" : "FAILED");
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
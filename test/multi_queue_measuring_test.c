@@ -0,0 +1,241 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <time.h>
+#include <errno.h>
+#include <threads.h>
+
+#include "../include/utils.h"
+#include "../include/multi_queue.h"
+#include "../include/parallel_sort.h"
+
+// rank error is measured on at most this many keys
+#define RANK_ERROR_MAX_SIZE (1000000u)
+
+typedef struct parsed_data_struct
+{
+	size_t nops;
+} parsed_data;
+
+typedef struct worker_data_struct
+{
+	multi_queue* mq;
+	size_t nops;
+	uint64_t seed;
+	size_t npopped;
+} worker_data;
+
+bool parse_args(int arg_cnt, char** argv, parsed_data* parsed_data_ptr);
+bool measure_rank_error(size_t n, size_t nqueues);
+bool measure_contention(size_t nops, size_t max_threads);
+
+int main(int argc, char** argv)
+{
+	parsed_data data = {0};
+
+	if (!parse_args(argc, argv, &data))
+		return EXIT_FAILURE;
+
+	size_t nthreads = parallel_sort_hardware_threads();
+	size_t rank_size = data.nops < RANK_ERROR_MAX_SIZE ? data.nops : RANK_ERROR_MAX_SIZE;
+
+	if (!measure_rank_error(rank_size, nthreads * MULTI_QUEUE_DEFAULT_FACTOR) ||
+		!measure_contention(data.nops, nthreads < 4u ? 4u : nthreads))
+	{
+		fprintf(stderr, "FAILURE !\n");
+		return EXIT_FAILURE;
+	}
+
+	printf("[+] Finished\n");
+	return EXIT_SUCCESS;
+}
+
+bool parse_args(int arg_cnt, char** argv, parsed_data* parsed_data_ptr)
+{
+	if (arg_cnt < 2 || !argv[1])
+		return false;
+
+	size_t n = strtoull(argv[1], NULL, 10);
+	if (n == SIZE_MAX || errno == ERANGE)
+		return false;
+
+	*parsed_data_ptr = (parsed_data){ .nops = n };
+	return true;
+}
+
+static double wall_time(void)
+{
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static uint64_t next_random(uint64_t* state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+// Fenwick tree over the keys still in the queue
+static void fenwick_add(int* tree, size_t n, size_t index, int delta)
+{
+	for (++index; index <= n; index += index & (~index + 1u))
+		tree[index - 1] += delta;
+}
+
+static size_t fenwick_prefix(const int* tree, size_t index)
+{
+	size_t sum = 0u;
+
+	for (; index; index -= index & (~index + 1u))
+		sum += (size_t) tree[index - 1];
+
+	return sum;
+}
+
+bool measure_rank_error(size_t n, size_t nqueues)
+{
+	multi_queue* mq = multi_queue_create(nqueues, sizeof(int), less_than_i32);
+	int* keys = create_vector(n, sizeof(int), false);
+	int* tree = create_vector(n, sizeof(int), true);
+	bool ret = mq && (keys || !n) && (tree || !n);
+
+	if (ret)
+	{
+		uint64_t state = 0x2545F4914F6CDD1DULL;
+
+		for (size_t i = 0; i < n; ++i)
+		{
+			keys[i] = (int) i;
+			fenwick_add(tree, n, i, 1);
+		}
+
+		for (size_t i = n; i > 1; --i)
+		{
+			size_t j = (size_t)(next_random(&state) % i);
+			int tmp = keys[i - 1];
+			keys[i - 1] = keys[j];
+			keys[j] = tmp;
+		}
+
+		for (size_t i = 0; ret && i < n; ++i)
+			ret = multi_queue_push(mq, &keys[i]);
+
+		size_t max_rank = 0u;
+		double rank_sum = 0.0;
+		int key = 0;
+
+		for (size_t i = 0; ret && i < n; ++i)
+		{
+			ret = multi_queue_pop(mq, &key) && key >= 0 && (size_t) key < n;
+			if (!ret)
+				break;
+
+			// rank = how many better keys were still waiting
+			size_t rank = fenwick_prefix(tree, (size_t) key);
+			fenwick_add(tree, n, (size_t) key, -1);
+
+			ret = fenwick_prefix(tree, (size_t) key + 1) == rank;
+			rank_sum += (double) rank;
+			max_rank = rank > max_rank ? rank : max_rank;
+		}
+
+		ret = ret && !multi_queue_pop(mq, &key);
+
+		printf("[+] Rank error for %zu keys on %zu queues: mean %.2f | max %zu\n",
+			   n, nqueues, n ? rank_sum / (double) n : 0.0, max_rank);
+	}
+
+	multi_queue_release(&mq);
+	free(keys);
+	free(tree);
+	return ret;
+}
+
+static int contention_worker(void* arg)
+{
+	worker_data* data = (worker_data *) arg;
+	int key = 0;
+
+	for (size_t i = 0; i < data->nops; ++i)
+	{
+		key = (int)(next_random(&data->seed) & INT32_MAX);
+		multi_queue_push(data->mq, &key);
+
+		if (multi_queue_pop(data->mq, &key))
+			++data->npopped;
+	}
+
+	return 0;
+}
+
+// ops/s of a push+pop mix, nqueues = 1 is a single heap behind one lock
+static bool run_contention(size_t nops, size_t nthreads, size_t nqueues, double* mops)
+{
+	multi_queue* mq = multi_queue_create(nqueues, sizeof(int), less_than_i32);
+	thrd_t* threads = (thrd_t *) malloc(nthreads * sizeof(thrd_t));
+	worker_data* data = (worker_data *) malloc(nthreads * sizeof(worker_data));
+	bool ret = mq && threads && data;
+	size_t started = 0u;
+	uint64_t state = 0x2545F4914F6CDD1DULL;
+
+	// prefilled, so pops measure contention instead of empty queues
+	for (size_t i = 0; ret && i < nops; ++i)
+		ret = multi_queue_push(mq, &(int){ (int)(next_random(&state) & INT32_MAX) });
+
+	double t1 = wall_time();
+
+	for (; ret && started < nthreads; ++started)
+	{
+		data[started] = (worker_data){ mq, nops / nthreads, 0x9E3779B97F4A7C15ULL + started, 0u };
+		ret = thrd_create(&threads[started], contention_worker, &data[started]) == thrd_success;
+	}
+
+	size_t npopped = 0u;
+
+	for (size_t i = 0; i < started; ++i)
+	{
+		thrd_join(threads[i], NULL);
+		npopped += data[i].npopped;
+	}
+
+	double t2 = wall_time();
+
+	if (ret)
+	{
+		// everything that was pushed must still be there
+		int key = 0;
+		while (multi_queue_pop(mq, &key))
+			++npopped;
+
+		size_t nworker_ops = (nops / nthreads) * nthreads;
+		ret = npopped == nops + nworker_ops;
+		*mops = (2.0 * (double) nworker_ops) / ((t2 - t1) * 1e6);
+	}
+
+	multi_queue_release(&mq);
+	free(threads);
+	free(data);
+	return ret;
+}
+
+bool measure_contention(size_t nops, size_t max_threads)
+{
+	for (size_t nthreads = 1; nthreads <= max_threads; nthreads <<= 1)
+	{
+		double locked = 0.0;
+		double relaxed = 0.0;
+
+		if (!run_contention(nops, nthreads, 1u, &locked) ||
+			!run_contention(nops, nthreads, nthreads * MULTI_QUEUE_DEFAULT_FACTOR, &relaxed))
+		{
+			return false;
+		}
+
+		printf("[+] %zu threads: locked heap %.2f Mops/s | multi-queue %.2f Mops/s\n",
+			   nthreads, locked, relaxed);
+	}
+
+	return true;
+}
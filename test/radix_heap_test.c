@@ -0,0 +1,120 @@
+#include <stdio.h>
+
+#include "../include/utils.h"
+#include "../include/scoped_heap.h"
+#include "../include/radix_sort.h"
+#include "../include/radix_heap.h"
+
+#define TEST_OPERATIONS (200000u)
+
+typedef struct test_event_struct
+{
+	uint64_t time;
+	uint32_t id;
+} test_event;
+
+static bool event_less(const void* first, const void* second, size_t size)
+{
+	(void) size;
+	return ((const test_event *)first)->time < ((const test_event *)second)->time;
+}
+
+static uint64_t next_random(uint64_t* state)
+{
+	// xorshift64, good enough to build test vectors
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+// event simulation: every pop schedules up to three later events, the
+// radix heap must hand out the same times as a scoped_heap
+static bool test_simulation(uint64_t* state)
+{
+	radix_heap* heap = radix_heap_create(sizeof(uint32_t));
+	scoped_heap* reference = scoped_heap_create(NULL, 0, sizeof(test_event), event_less);
+	bool ret = heap && reference;
+
+	for (uint32_t id = 0; ret && id < 64u; ++id)
+	{
+		test_event event = { next_random(state) % 1000u, id };
+		ret = radix_heap_push(heap, event.time, &event.id) &&
+			  scoped_heap_push(reference, &event) != SCOPED_HEAP_INVALID_HANDLE;
+	}
+
+	uint32_t next_id = 64u;
+
+	for (size_t op = 0; ret && op < TEST_OPERATIONS && radix_heap_size(heap); ++op)
+	{
+		uint64_t time = 0u;
+		uint32_t id = 0u;
+		test_event* expected = (test_event *) scoped_heap_pop(reference);
+
+		ret = radix_heap_pop(heap, &time, &id) && expected && expected->time == time;
+
+		// keys behind the last popped one are rejected
+		ret = ret && (!time || !radix_heap_push(heap, time - 1u, &id));
+
+		size_t children = (size_t)(next_random(state) % 4u);
+		for (size_t i = 0; ret && i < children; ++i)
+		{
+			// mostly short delays, sometimes far into the future
+			uint64_t delay = next_random(state);
+			delay = (delay & 7u) ? delay % 100u : delay % (1ull << 40);
+
+			test_event event = { time + delay, next_id++ };
+			ret = radix_heap_push(heap, event.time, &event.id) &&
+				  scoped_heap_push(reference, &event) != SCOPED_HEAP_INVALID_HANDLE;
+		}
+	}
+
+	ret = ret && radix_heap_size(heap) == scoped_heap_size(reference);
+
+	radix_heap_release(&heap);
+	scoped_heap_release(&reference);
+	return ret;
+}
+
+static bool test_drain(uint64_t* state)
+{
+	radix_heap* heap = radix_heap_create(0u);
+	bool ret = heap != NULL;
+
+	uint64_t* keys = create_vector(TEST_OPERATIONS, sizeof(uint64_t), false);
+	ret = ret && keys;
+
+	for (size_t i = 0; ret && i < TEST_OPERATIONS; ++i)
+	{
+		keys[i] = next_random(state) >> (i % 64u);
+		ret = radix_heap_push(heap, keys[i], NULL);
+	}
+
+	if (ret)
+		radix_sort_u64(keys, keys + TEST_OPERATIONS, RADIX_SORT_DIGIT_BITS_11);
+
+	for (size_t i = 0; ret && i < TEST_OPERATIONS; ++i)
+	{
+		uint64_t key = 0u;
+		ret = radix_heap_pop(heap, &key, NULL) && key == keys[i];
+	}
+
+	ret = ret && !radix_heap_size(heap) && !radix_heap_pop(heap, NULL, NULL);
+
+	free(keys);
+	radix_heap_release(&heap);
+	return ret;
+}
+
+int main(int argc, char** argv)
+{
+	uint64_t state = 0x9E3779B97F4A7C15ULL;
+
+	bool success = test_simulation(&state);
+	printf("[+] event simulation: %s\n", success ? "OK" : "FAILED");
+
+	success = success && test_drain(&state);
+	printf("[+] drain: %s\n", success ? "OK" : "FAILED");
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,126 @@
+#include <stdio.h>
+
+// small thresholds so the hybrid MSD path runs on small inputs
+#define RADIX_SORT_MSD_THRESHOLD (4096u)
+#define RADIX_SORT_MSD_BUCKET_SIZE (256u)
+
+#include "../include/utils.h"
+#include "../include/radix_sort.h"
+
+#define TEST_VECTOR_SIZE (100000u)
+
+static bool less_than_u64(const void* first, const void* second, size_t size)
+{
+	(void) size;
+	return *(const uint64_t *)first < *(const uint64_t *)second;
+}
+
+static bool less_than_f64(const void* first, const void* second, size_t size)
+{
+	(void) size;
+	return *(const double *)first < *(const double *)second;
+}
+
+static uint64_t next_random(uint64_t* state)
+{
+	// xorshift64, good enough to build test vectors
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+static bool test_i32(uint8_t digit_bits, uint64_t* state)
+{
+	int32_t* keys = create_vector(TEST_VECTOR_SIZE, sizeof(int32_t), false);
+	int32_t* values = create_vector(TEST_VECTOR_SIZE, sizeof(int32_t), false);
+	bool ret = false;
+
+	if (keys && values)
+	{
+		for (size_t i = 0; i < TEST_VECTOR_SIZE; ++i)
+		{
+			keys[i] = (int32_t) next_random(state) >> (i % 16);
+			values[i] = (int32_t) i;
+		}
+
+		int32_t* expected = memdup(keys, TEST_VECTOR_SIZE * sizeof(int32_t));
+
+		if (expected && radix_sort_kv_i32(keys, keys + TEST_VECTOR_SIZE, values, sizeof(int32_t), digit_bits))
+		{
+			ret = is_sorted(keys, keys + TEST_VECTOR_SIZE, sizeof(int32_t), less_than_i32);
+
+			// payloads follow their keys and equal keys keep their order
+			for (size_t i = 0; ret && i < TEST_VECTOR_SIZE; ++i)
+			{
+				ret = expected[values[i]] == keys[i] &&
+					  (!i || keys[i - 1] != keys[i] || values[i - 1] < values[i]);
+			}
+		}
+
+		free(expected);
+	}
+
+	free(keys);
+	free(values);
+	return ret;
+}
+
+static bool test_u64(uint8_t digit_bits, uint64_t* state)
+{
+	uint64_t* keys = create_vector(TEST_VECTOR_SIZE, sizeof(uint64_t), false);
+	if (!keys)
+		return false;
+
+	// the low bits are constant, so most digits are skipped
+	for (size_t i = 0; i < TEST_VECTOR_SIZE; ++i)
+		keys[i] = next_random(state) << 24;
+
+	bool ret = radix_sort_u64(keys, keys + TEST_VECTOR_SIZE, digit_bits) &&
+			   is_sorted(keys, keys + TEST_VECTOR_SIZE, sizeof(uint64_t), less_than_u64);
+
+	free(keys);
+	return ret;
+}
+
+static bool test_f64(uint8_t digit_bits, uint64_t* state)
+{
+	double* keys = create_vector(TEST_VECTOR_SIZE, sizeof(double), false);
+	if (!keys)
+		return false;
+
+	for (size_t i = 0; i < TEST_VECTOR_SIZE; ++i)
+		keys[i] = ((double)(int64_t) next_random(state)) / 1e3;
+
+	bool ret = radix_sort_f64(keys, keys + TEST_VECTOR_SIZE, digit_bits) &&
+			   is_sorted(keys, keys + TEST_VECTOR_SIZE, sizeof(double), less_than_f64);
+
+	free(keys);
+	return ret;
+}
+
+int main(int argc, char** argv)
+{
+	uint8_t digit_bits[] =
+	{
+		RADIX_SORT_DIGIT_BITS_8,
+		RADIX_SORT_DIGIT_BITS_11,
+		RADIX_SORT_DIGIT_BITS_16
+	};
+
+	uint64_t state = 0x9E3779B97F4A7C15ULL;
+
+	for (size_t i = 0; i < ArrayCount(digit_bits); ++i)
+	{
+		bool success = test_i32(digit_bits[i], &state) &&
+					   test_u64(digit_bits[i], &state) &&
+					   test_f64(digit_bits[i], &state);
+
+		printf("[+] %u bit digits: %s\n", digit_bits[i], success ? "OK" : "FAILED");
+
+		if (!success)
+			return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,93 @@
+#include <stdio.h>
+
+#include "../include/utils.h"
+#include "../include/random_fill.h"
+
+#define TEST_SIZE ((size_t) 3u * RANDOM_FILL_CHUNK_SIZE + 1234u)
+
+// reference outputs of the xoshiro256** paper code from state {1, 2, 3, 4}
+static bool test_reference(void)
+{
+	static const uint64_t expected[] = { 11520u, 0u, 1509978240u, 1215971899390074240u };
+
+	xoshiro256 rng = { { 1u, 2u, 3u, 4u } };
+	for (size_t i = 0; i < ArrayCount(expected); ++i)
+		if (xoshiro256_next(&rng) != expected[i])
+			return false;
+
+	return true;
+}
+
+// the fill must not depend on the thread count, chunk c must be stream c
+static bool test_streams(uint32_t bound)
+{
+	uint32_t* single = create_vector(TEST_SIZE, sizeof(uint32_t), false);
+	uint32_t* multi = create_vector(TEST_SIZE, sizeof(uint32_t), false);
+	bool ret = single && multi;
+
+	random_fill_config one = { .nthreads = 1u };
+	random_fill_config many = { .nthreads = 3u, .cutoff = 1u };
+
+	ret = ret && random_fill_u32(single, single + TEST_SIZE, bound, 7u, &one) &&
+		  random_fill_u32(multi, multi + TEST_SIZE, bound, 7u, &many) &&
+		  !memcmp(single, multi, TEST_SIZE * sizeof(uint32_t));
+
+	xoshiro256 rng = xoshiro256_seed(7u);
+	xoshiro256_jump(&rng);
+	xoshiro256_jump(&rng);
+
+	for (size_t i = 2u * RANDOM_FILL_CHUNK_SIZE; ret && i < 3u * RANDOM_FILL_CHUNK_SIZE; ++i)
+	{
+		uint32_t value = bound ? xoshiro256_bounded32(&rng, bound) : (uint32_t)(xoshiro256_next(&rng) >> 32);
+		ret = single[i] == value;
+	}
+
+	// every bucket of a small bound gets close to its share
+	if (ret && bound && bound <= 16u)
+	{
+		size_t counts[16] = { 0 };
+		for (size_t i = 0; i < TEST_SIZE; ++i)
+			++counts[single[i]];
+
+		for (size_t b = 0; ret && b < bound; ++b)
+			ret = counts[b] > (TEST_SIZE / bound) * 9u / 10u && counts[b] < (TEST_SIZE / bound) * 11u / 10u;
+	}
+
+	free(single);
+	free(multi);
+	return ret;
+}
+
+static bool test_u64(void)
+{
+	uint64_t* values = create_vector(TEST_SIZE, sizeof(uint64_t), false);
+	bool ret = values && random_fill_u64(values, values + TEST_SIZE, 99u, NULL);
+
+	xoshiro256 rng = xoshiro256_seed(99u);
+	for (size_t i = 0; ret && i < RANDOM_FILL_CHUNK_SIZE; ++i)
+		ret = values[i] == xoshiro256_next(&rng);
+
+	free(values);
+	return ret && random_fill_u64(NULL, NULL, 1u, NULL);
+}
+
+int main(int argc, char** argv)
+{
+	bool success = test_reference();
+	printf("[+] xoshiro256** reference: %s\n", success ? "OK" : "FAILED");
+
+	uint32_t bounds[] = { 0u, 1u, 10u, 2000000000u };
+	for (size_t i = 0; success && i < ArrayCount(bounds); ++i)
+	{
+		success = test_streams(bounds[i]);
+		printf("[+] streams, bound %u: %s\n", bounds[i], success ? "OK" : "FAILED");
+	}
+
+	if (success)
+	{
+		success = test_u64();
+		printf("[+] u64 fill: %s\n", success ? "OK" : "FAILED");
+	}
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
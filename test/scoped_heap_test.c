@@ -3,8 +3,128 @@
 #include "../include/utils.h"
 #include "../include/scoped_heap.h"
 
+#define HANDLE_TEST_SIZE (1000u)
+
+static bool test_handles(uint8_t pop_method)
+{
+	scoped_heap* minheap = scoped_heap_create(NULL, 0, sizeof(int), less_than_i32);
+	if (!minheap || !scoped_heap_set_pop_method(minheap, pop_method))
+	{
+		scoped_heap_release(&minheap);
+		return false;
+	}
+
+	scoped_heap_handle handles[HANDLE_TEST_SIZE] = { 0 };
+	int expected[HANDLE_TEST_SIZE] = { 0 };
+	bool erased[HANDLE_TEST_SIZE] = { false };
+	bool ret = true;
+
+	for (size_t i = 0; ret && i < HANDLE_TEST_SIZE; ++i)
+	{
+		expected[i] = (int)((i * 7919u) % HANDLE_TEST_SIZE);
+		handles[i] = scoped_heap_push(minheap, &expected[i]);
+		ret = handles[i] != SCOPED_HEAP_INVALID_HANDLE;
+	}
+
+	// move every third priority up or down, erase every fifth element
+	for (size_t i = 0; ret && i < HANDLE_TEST_SIZE; ++i)
+	{
+		if (i % 5 == 0)
+		{
+			ret = scoped_heap_erase(minheap, handles[i]);
+			erased[i] = true;
+		}
+		else if (i % 3 == 0)
+		{
+			expected[i] = (i & 1) ? expected[i] - 5000 : expected[i] + 5000;
+			ret = scoped_heap_update(minheap, handles[i], &expected[i]);
+		}
+		else if (i % 3 == 1)
+		{
+			// in-place change through the handle
+			int* value = (int *) scoped_heap_get(minheap, handles[i]);
+			ret = value && *value == expected[i];
+
+			if (ret)
+			{
+				*value = expected[i] = -expected[i];
+				ret = scoped_heap_update(minheap, handles[i], NULL);
+			}
+		}
+	}
+
+	size_t remaining = 0u;
+	for (size_t i = 0; i < HANDLE_TEST_SIZE; ++i)
+		if (!erased[i])
+			expected[remaining++] = expected[i];
+
+	intro_sort(expected, expected + remaining, sizeof(int), less_than_i32);
+	ret = ret && scoped_heap_size(minheap) == remaining;
+
+	for (size_t i = 0; ret && i < remaining; ++i)
+	{
+		int* top = (int *) scoped_heap_pop(minheap);
+		ret = top && *top == expected[i];
+	}
+
+	ret = ret && !scoped_heap_erase(minheap, handles[1]);
+
+	scoped_heap_release(&minheap);
+	return ret;
+}
+
+static bool drain_sorted(scoped_heap* minheap, size_t expected_size)
+{
+	bool ret = scoped_heap_size(minheap) == expected_size;
+	int last = INT32_MIN;
+
+	for (size_t i = 0; ret && i < expected_size; ++i)
+	{
+		int* top = (int *) scoped_heap_pop(minheap);
+		ret = top && *top >= last;
+		last = top ? *top : last;
+	}
+
+	return ret;
+}
+
+static bool test_bulk(void)
+{
+	int values[HANDLE_TEST_SIZE] = { 0 };
+	scoped_heap_handle handles[HANDLE_TEST_SIZE] = { 0 };
+
+	for (size_t i = 0; i < HANDLE_TEST_SIZE; ++i)
+		values[i] = (int)((i * 7919u) % HANDLE_TEST_SIZE);
+
+	scoped_heap* first = scoped_heap_create(values, 100, sizeof(int), less_than_i32);
+	scoped_heap* second = scoped_heap_create(NULL, 0, sizeof(int), less_than_i32);
+	bool ret = first && second;
+
+	// small batch (sift-ups) then a big one (rebuild)
+	ret = ret && scoped_heap_push_range(first, values + 100, 5, handles);
+	ret = ret && scoped_heap_push_range(first, values + 105, HANDLE_TEST_SIZE - 105, handles + 5);
+
+	for (size_t i = 0; ret && i < HANDLE_TEST_SIZE - 100; ++i)
+	{
+		int* value = (int *) scoped_heap_get(first, handles[i]);
+		ret = value && *value == values[100 + i];
+	}
+
+	ret = ret && scoped_heap_push_range(second, values, HANDLE_TEST_SIZE, NULL);
+	ret = ret && scoped_heap_merge(first, second) && !scoped_heap_size(second);
+	ret = ret && drain_sorted(first, 2u * HANDLE_TEST_SIZE);
+
+	scoped_heap_release(&first);
+	scoped_heap_release(&second);
+	return ret;
+}
+
 int main(int argc, char** argv)
 {
+	if (!test_handles(SCOPED_HEAP_POP_TOP_DOWN) || !test_handles(SCOPED_HEAP_POP_BOTTOM_UP) ||
+		!test_bulk())
+		return EXIT_FAILURE;
+
 	scoped_heap* maxheap = scoped_heap_create(NULL, 0, sizeof(int), greater_than_i32);
 	if (!maxheap)
 		return EXIT_FAILURE;
@@ -1,79 +1,792 @@
+// clock_gettime and CLOCK_MONOTONIC are POSIX
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdbool.h>
 #include <time.h>
 #include <errno.h>
+#include <math.h>
 
 #include "../include/utils.h"
 #include "../include/scoped_heap.h"
+#include "../include/parallel_sort.h"
+#include "../include/radix_sort.h"
+#include "../include/indirect_sort.h"
+#include "../include/top_k.h"
+#include "../include/perf_counters.h"
+#include "../include/random_fill.h"
+
+// Benchmark driver: every selected algorithm runs on every selected input
+// distribution and size, with warm-ups and repetitions timed on the
+// monotonic clock. Hardware counters (perf_event_open) are read around the
+// same timed region when the system allows it. Every run is checked,
+// results go out as text, CSV or JSON. Usage:
+//
+//   sort_measuring_test <size[,size...]> [--reps=N] [--warmup=N]
+//                       [--algorithms=a,b] [--distributions=a,b]
+//                       [--format=text|csv|json] [--output=path] [--seed=N]
+//
+// parallel_sort_tN rows pin the thread count and report their speedup
+// over parallel_sort_t1; the counts above the online cores are skipped.
+
+#define BENCH_DEFAULT_REPETITIONS (5u)
+#define BENCH_DEFAULT_WARMUPS (1u)
+#define BENCH_DEFAULT_SEED (42u)
+#define BENCH_MAX_SIZES (16u)
+
+// insertion sort is quadratic, above this size it would never finish
+#define INSERTION_SORT_MAX_SIZE (20000u)
 
-typedef struct parsed_data_struct
+// how many elements the selection benchmarks keep
+#define SELECTION_K (100u)
+
+// big records need elem_size bytes per key, keep the copy in memory
+#define RECORD_SORT_MAX_SIZE (10000000u)
+#define RECORD_PAYLOAD_SIZE (124u)
+
+// input shapes
+#define SAWTOOTH_TEETH (16u)
+#define FEW_UNIQUE_VALUES (16u)
+#define ZIPF_RANKS (100000u)
+#define ZIPF_EXPONENT (1.0)
+
+typedef struct sort_record_struct
 {
-	size_t vector_size;
-	int* vector;
-} parsed_data;
+	int key;
+	uint32_t position; // input index, lets the check see stability
+	uint8_t payload[RECORD_PAYLOAD_SIZE - sizeof(uint32_t)];
+} sort_record;
 
-bool parse_args(int arg_cnt, char** argv, parsed_data* parsed_data_ptr);
-void random_fill(int* begin, int* end, int m);
-void sort_data(int* begin, int* end);
+// everything a run may touch; input and reference stay untouched
+typedef struct bench_data_struct
+{
+	const int* input;
+	const int* reference; // input sorted and verified once per case
+	int* work;
+	sort_record* records;
+	size_t n;
+	size_t nthreads; // of the algorithm being run, 0 = its default
+} bench_data;
 
-int main(int argc, char** argv)
+typedef struct bench_algorithm_struct
 {
-	parsed_data data = {0};
+	const char* name;
+	size_t max_size;                       // 0 = no limit
+	size_t nthreads;                       // parallel_sort_tN rows, 0 = default
+	bool(*setup)(bench_data* data);        // untimed, prepares work/records
+	bool(*run)(bench_data* data);          // timed
+	bool(*check)(const bench_data* data);
+} bench_algorithm;
 
-	if (!parse_args(argc, argv, &data))
-		return EXIT_FAILURE;
+typedef void(*bench_generator)(int* out, size_t n, uint64_t* state);
+
+typedef struct bench_distribution_struct
+{
+	const char* name;
+	bench_generator generate;
+} bench_distribution;
 
-	random_fill(data.vector, data.vector + data.vector_size, 100000);
-	sort_data(data.vector, data.vector + data.vector_size);
+typedef struct bench_options_struct
+{
+	size_t sizes[BENCH_MAX_SIZES];
+	size_t nsizes;
+	size_t repetitions;
+	size_t warmups;
+	const char* algorithms;    // comma-separated names, NULL = all
+	const char* distributions; // comma-separated names, NULL = all
+	const char* format;
+	const char* output;
+	uint64_t seed;
+} bench_options;
+
+typedef struct bench_result_struct
+{
+	const char* algorithm;
+	const char* distribution;
+	size_t n;
+	size_t repetitions;
+	double median;
+	double p95;
+	double min;
+	double mean;
+	double speedup; // over the 1-thread run, 0 = not a thread-count row
+	perf_counters_sample counters; // summed over the timed repetitions
+	bool valid;
+} bench_result;
+
+static double bench_now(void)
+{
+	// wall time: clock() adds up the CPU time of every thread
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static uint64_t next_random(uint64_t* state)
+{
+	// xorshift64, good enough to build inputs
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+/* input distributions */
+
+// non-negative ints, filled on every core: the 1e9 case spends most of
+// its setup here
+static void generate_random(int* out, size_t n, uint64_t* state)
+{
+	if (!random_fill_u32((uint32_t *) out, (uint32_t *) out + n, (uint32_t) INT32_MAX, *state, NULL))
+	{
+		for (size_t i = 0; i < n; ++i)
+			out[i] = (int)(next_random(state) >> 33);
+	}
 }
 
-bool parse_args(int arg_cnt, char** argv, parsed_data* parsed_data_ptr)
+static void generate_sorted(int* out, size_t n, uint64_t* state)
 {
-	if (arg_cnt < 2 || !argv[1])
+	for (size_t i = 0; i < n; ++i)
+		out[i] = (int) i;
+}
+
+static void generate_reversed(int* out, size_t n, uint64_t* state)
+{
+	for (size_t i = 0; i < n; ++i)
+		out[i] = (int)(n - i);
+}
+
+static void generate_sawtooth(int* out, size_t n, uint64_t* state)
+{
+	size_t period = n / SAWTOOTH_TEETH ? n / SAWTOOTH_TEETH : 1u;
+
+	for (size_t i = 0; i < n; ++i)
+		out[i] = (int)(i % period);
+}
+
+static void generate_few_unique(int* out, size_t n, uint64_t* state)
+{
+	for (size_t i = 0; i < n; ++i)
+		out[i] = (int)(next_random(state) % FEW_UNIQUE_VALUES);
+}
+
+// ranks drawn with P(r) ~ 1 / r^s through the inverse CDF, then scattered
+// over the int range so the hot keys are not also the smallest ones
+static void generate_zipf(int* out, size_t n, uint64_t* state)
+{
+	double* cdf = (double *) malloc(ZIPF_RANKS * sizeof(double));
+	if (!cdf)
+	{
+		generate_random(out, n, state);
+		return;
+	}
+
+	double total = 0.0;
+	for (size_t r = 0; r < ZIPF_RANKS; ++r)
+		cdf[r] = total += 1.0 / pow((double)(r + 1u), ZIPF_EXPONENT);
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		double u = (double)(next_random(state) >> 11) / 9007199254740992.0 * total;
+
+		size_t lo = 0u, hi = ZIPF_RANKS - 1u;
+		while (lo < hi)
+		{
+			size_t mid = (lo + hi) >> 1;
+			if (cdf[mid] < u)
+				lo = mid + 1u;
+			else
+				hi = mid;
+		}
+
+		out[i] = (int)(((uint32_t) lo * 2654435761u) >> 1);
+	}
+
+	free(cdf);
+}
+
+static const bench_distribution bench_distributions[] =
+{
+	{ "random", generate_random },
+	{ "sorted", generate_sorted },
+	{ "reversed", generate_reversed },
+	{ "sawtooth", generate_sawtooth },
+	{ "few_unique", generate_few_unique },
+	{ "zipf", generate_zipf }
+};
+
+/* algorithms */
+
+static bool record_less(const void* first, const void* second, size_t size)
+{
+	(void) size;
+	return ((const sort_record *)first)->key < ((const sort_record *)second)->key;
+}
+
+static uint64_t record_key(const void* elem)
+{
+	return sort_key_from_i64(((const sort_record *)elem)->key);
+}
+
+static bool setup_ints(bench_data* data)
+{
+	if (data->n)
+		memcpy(data->work, data->input, data->n * sizeof(int));
+
+	return true;
+}
+
+static bool setup_records(bench_data* data)
+{
+	if (!data->records)
+		data->records = create_vector(data->n ? data->n : 1u, sizeof(sort_record), false);
+
+	if (!data->records)
 		return false;
 
+	for (size_t i = 0; i < data->n; ++i)
+	{
+		data->records[i].key = data->input[i];
+		data->records[i].position = (uint32_t) i;
+		memset(data->records[i].payload, (uint8_t) data->input[i], sizeof(data->records[i].payload));
+	}
+
+	return true;
+}
+
+static bool check_ints(const bench_data* data)
+{
+	return !data->n || !memcmp(data->work, data->reference, data->n * sizeof(int));
+}
+
+static bool check_records(const bench_data* data)
+{
+	for (size_t i = 0; i < data->n; ++i)
+	{
+		const sort_record* record = &data->records[i];
+
+		if (record->key != data->reference[i] ||
+			record->payload[sizeof(record->payload) - 1] != (uint8_t) record->key)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool check_records_stable(const bench_data* data)
+{
+	for (size_t i = 1; i < data->n; ++i)
+		if (data->records[i - 1].key == data->records[i].key &&
+			data->records[i - 1].position > data->records[i].position)
+			return false;
+
+	return check_records(data);
+}
+
+static bool check_prefix(const bench_data* data)
+{
+	size_t k = data->n < SELECTION_K ? data->n : SELECTION_K;
+	return !k || !memcmp(data->work, data->reference, k * sizeof(int));
+}
+
+static bool check_nth(const bench_data* data)
+{
+	return !data->n || data->work[data->n >> 1] == data->reference[data->n >> 1];
+}
+
+static bool run_heap_sort(bench_data* data)
+{
+	heap_sort(data->work, data->work + data->n, sizeof(int), greater_than_i32);
+	return true;
+}
+
+static bool run_heap_sort_bottom_up(bench_data* data)
+{
+	heap_sort_bottom_up(data->work, data->work + data->n, sizeof(int), greater_than_i32);
+	return true;
+}
+
+static bool run_intro_sort(bench_data* data)
+{
+	intro_sort_i32((int32_t *) data->work, (int32_t *)(data->work + data->n));
+	return true;
+}
+
+static bool run_merge_sort(bench_data* data)
+{
+	return merge_sort_stable(data->work, data->work + data->n, sizeof(int), less_than_i32);
+}
+
+static bool run_radix_sort(bench_data* data)
+{
+	return radix_sort_i32(data->work, data->work + data->n, RADIX_SORT_DIGIT_BITS_11);
+}
+
+static bool run_parallel_sort(bench_data* data)
+{
+	parallel_sort_config config = { .nthreads = data->nthreads };
+	return parallel_sort(data->work, data->work + data->n, sizeof(int), less_than_i32, &config);
+}
+
+static bool run_insertion_sort(bench_data* data)
+{
+	insertion_sort(data->work, data->work + data->n, sizeof(int), less_than_i32);
+	return true;
+}
+
+static bool run_intro_sort_records(bench_data* data)
+{
+	intro_sort(data->records, data->records + data->n, sizeof(sort_record), record_less);
+	return true;
+}
+
+static bool run_merge_sort_records(bench_data* data)
+{
+	return merge_sort_stable(data->records, data->records + data->n, sizeof(sort_record), record_less);
+}
+
+static bool run_indirect_sort_records(bench_data* data)
+{
+	return indirect_sort(data->records, data->records + data->n, sizeof(sort_record), record_key);
+}
+
+static bool run_top_k(bench_data* data)
+{
+	return select_top_k(data->input, data->input + data->n, SELECTION_K,
+						sizeof(int), less_than_i32, data->work);
+}
+
+static bool run_partial_sort(bench_data* data)
+{
+	size_t k = data->n < SELECTION_K ? data->n : SELECTION_K;
+	partial_sort(data->work, data->work + k, data->work + data->n, sizeof(int), less_than_i32);
+	return true;
+}
+
+static bool run_nth_element(bench_data* data)
+{
+	nth_element(data->work, data->work + (data->n >> 1), data->work + data->n,
+				sizeof(int), less_than_i32);
+	return true;
+}
+
+static const bench_algorithm bench_algorithms[] =
+{
+	{ "heap_sort", 0u, 0u, setup_ints, run_heap_sort, check_ints },
+	{ "heap_sort_bottom_up", 0u, 0u, setup_ints, run_heap_sort_bottom_up, check_ints },
+	{ "intro_sort", 0u, 0u, setup_ints, run_intro_sort, check_ints },
+	{ "merge_sort_stable", 0u, 0u, setup_ints, run_merge_sort, check_ints },
+	{ "radix_sort", 0u, 0u, setup_ints, run_radix_sort, check_ints },
+	{ "parallel_sort", 0u, 0u, setup_ints, run_parallel_sort, check_ints },
+	{ "parallel_sort_t1", 0u, 1u, setup_ints, run_parallel_sort, check_ints },
+	{ "parallel_sort_t2", 0u, 2u, setup_ints, run_parallel_sort, check_ints },
+	{ "parallel_sort_t4", 0u, 4u, setup_ints, run_parallel_sort, check_ints },
+	{ "parallel_sort_t8", 0u, 8u, setup_ints, run_parallel_sort, check_ints },
+	{ "parallel_sort_t16", 0u, 16u, setup_ints, run_parallel_sort, check_ints },
+	{ "parallel_sort_t32", 0u, 32u, setup_ints, run_parallel_sort, check_ints },
+	{ "insertion_sort", INSERTION_SORT_MAX_SIZE, 0u, setup_ints, run_insertion_sort, check_ints },
+	{ "intro_sort_records", RECORD_SORT_MAX_SIZE, 0u, setup_records, run_intro_sort_records, check_records },
+	{ "merge_sort_records", RECORD_SORT_MAX_SIZE, 0u, setup_records, run_merge_sort_records, check_records_stable },
+	{ "indirect_sort_records", RECORD_SORT_MAX_SIZE, 0u, setup_records, run_indirect_sort_records, check_records },
+	{ "top_k", 0u, 0u, setup_ints, run_top_k, check_prefix },
+	{ "partial_sort", 0u, 0u, setup_ints, run_partial_sort, check_prefix },
+	{ "nth_element", 0u, 0u, setup_ints, run_nth_element, check_nth }
+};
+
+/* driver */
+
+// true when name is in the comma-separated list (NULL = everything)
+static bool bench_selected(const char* list, const char* name)
+{
+	if (!list)
+		return true;
+
+	size_t len = strlen(name);
+
+	for (const char* iter = list; *iter; )
+	{
+		const char* comma = strchr(iter, ',');
+		size_t item_len = comma ? (size_t)(comma - iter) : strlen(iter);
+
+		if (item_len == len && !strncmp(iter, name, len))
+			return true;
+
+		if (!comma)
+			break;
+
+		iter = comma + 1;
+	}
+
+	return false;
+}
+
+static bool bench_parse_count(const char* text, size_t* value)
+{
 	char* rest = NULL;
+	errno = 0;
 
-	size_t n = strtoull(argv[1], &rest, 10);
-	if (n == SIZE_MAX || errno == ERANGE)
+	unsigned long long parsed = strtoull(text, &rest, 10);
+	if (rest == text || errno == ERANGE || parsed >= SIZE_MAX)
 		return false;
 
-	int* vector = (int *) malloc(n * sizeof(int));
-	if (!vector)
+	*value = (size_t) parsed;
+	return true;
+}
+
+static bool bench_parse_sizes(const char* text, bench_options* options)
+{
+	for (const char* iter = text; *iter; )
+	{
+		if (options->nsizes == BENCH_MAX_SIZES ||
+			!bench_parse_count(iter, &options->sizes[options->nsizes++]))
+		{
+			return false;
+		}
+
+		const char* comma = strchr(iter, ',');
+		if (!comma)
+			break;
+
+		iter = comma + 1;
+	}
+
+	return options->nsizes > 0;
+}
+
+static bool parse_args(int argc, char** argv, bench_options* options)
+{
+	*options = (bench_options){
+		.repetitions = BENCH_DEFAULT_REPETITIONS,
+		.warmups = BENCH_DEFAULT_WARMUPS,
+		.format = "text",
+		.seed = BENCH_DEFAULT_SEED
+	};
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		size_t seed = 0u;
+		bool ok = true;
+
+		if (!strncmp(arg, "--reps=", 7))
+			ok = bench_parse_count(arg + 7, &options->repetitions) && options->repetitions;
+		else if (!strncmp(arg, "--warmup=", 9))
+			ok = bench_parse_count(arg + 9, &options->warmups);
+		else if (!strncmp(arg, "--algorithms=", 13))
+			options->algorithms = arg + 13;
+		else if (!strncmp(arg, "--distributions=", 16))
+			options->distributions = arg + 16;
+		else if (!strncmp(arg, "--format=", 9))
+			options->format = arg + 9;
+		else if (!strncmp(arg, "--output=", 9))
+			options->output = arg + 9;
+		else if (!strncmp(arg, "--seed=", 7))
+		{
+			ok = bench_parse_count(arg + 7, &seed);
+			options->seed = seed;
+		}
+		else
+			ok = bench_parse_sizes(arg, options);
+
+		if (!ok)
+		{
+			fprintf(stderr, "[EXCEPTION] invalid argument '%s'\n", arg);
+			return false;
+		}
+	}
+
+	if (strcmp(options->format, "text") && strcmp(options->format, "csv") &&
+		strcmp(options->format, "json"))
+	{
+		fprintf(stderr, "[EXCEPTION] unknown format '%s'\n", options->format);
 		return false;
+	}
 
-	*parsed_data_ptr = (parsed_data){ .vector = vector, .vector_size = n };
-	return true;
+	return options->nsizes > 0;
+}
+
+static void bench_statistics(double* times, size_t count, bench_result* result)
+{
+	for (size_t i = 1; i < count; ++i)
+	{
+		double t = times[i];
+		size_t j = i;
+
+		for (; j && times[j - 1] > t; --j)
+			times[j] = times[j - 1];
+
+		times[j] = t;
+	}
+
+	double sum = 0.0;
+	for (size_t i = 0; i < count; ++i)
+		sum += times[i];
+
+	// nearest-rank percentiles
+	result->min = times[0];
+	result->median = (count & 1u) ? times[count >> 1]
+								  : (times[(count >> 1) - 1] + times[count >> 1]) / 2.0;
+	result->p95 = times[(size_t) ceil(0.95 * (double) count) - 1u];
+	result->mean = sum / (double) count;
+}
+
+static bool bench_case(const bench_algorithm* algorithm, bench_data* data,
+					   const bench_options* options, perf_counters* counters,
+					   double* times, bench_result* result)
+{
+	bool valid = true;
+	perf_counters_sample sample;
+
+	for (size_t c = 0; c < PERF_COUNTERS_COUNT; ++c)
+		result->counters.available[c] = perf_counters_any(counters);
+
+	for (size_t i = 0; valid && i < options->warmups; ++i)
+		valid = algorithm->setup(data) && algorithm->run(data) && algorithm->check(data);
+
+	for (size_t i = 0; valid && i < options->repetitions; ++i)
+	{
+		valid = algorithm->setup(data);
+
+		perf_counters_begin(counters);
+		double t1 = bench_now();
+		valid = valid && algorithm->run(data);
+		double t2 = bench_now();
+		perf_counters_end(counters, &sample);
+
+		times[i] = t2 - t1;
+
+		// a counter is reported only when every repetition could read it
+		for (size_t c = 0; c < PERF_COUNTERS_COUNT; ++c)
+		{
+			result->counters.values[c] += sample.values[c];
+			result->counters.available[c] = result->counters.available[c] && sample.available[c];
+		}
+		valid = valid && algorithm->check(data);
+	}
+
+	if (valid)
+		bench_statistics(times, options->repetitions, result);
+
+	result->valid = valid;
+	return valid;
+}
+
+// counter per element and repetition, negative when unavailable
+static double bench_counter(const bench_result* result, size_t counter)
+{
+	if (!result->counters.available[counter])
+		return -1.0;
+
+	double elements = (double)(result->n ? result->n : 1u) * (double) result->repetitions;
+	return (double) result->counters.values[counter] / elements;
+}
+
+static void bench_report(FILE* out, const char* format, const bench_result* result, bool first)
+{
+	double ns_per_elem = result->n ? result->median * 1e9 / (double) result->n : 0.0;
+
+	if (!strcmp(format, "csv"))
+	{
+		fprintf(out, "%s,%s,%zu,%zu,%.9f,%.9f,%.9f,%.9f,%.3f,%d,",
+				result->algorithm, result->distribution, result->n, result->repetitions,
+				result->median, result->p95, result->min, result->mean, ns_per_elem, result->valid);
+
+		if (result->speedup > 0.0)
+			fprintf(out, "%.3f", result->speedup);
+
+		// empty cells for the counters that could not be read
+		for (size_t c = 0; c < PERF_COUNTERS_COUNT; ++c)
+		{
+			double value = bench_counter(result, c);
+
+			if (value < 0.0)
+				fprintf(out, ",");
+			else
+				fprintf(out, ",%.4f", value);
+		}
+
+		fprintf(out, "\n");
+	}
+	else if (!strcmp(format, "json"))
+	{
+		fprintf(out, "%s\n\t\t{ \"algorithm\": \"%s\", \"distribution\": \"%s\", \"size\": %zu, "
+					 "\"repetitions\": %zu, \"median_s\": %.9f, \"p95_s\": %.9f, \"min_s\": %.9f, "
+					 "\"mean_s\": %.9f, \"ns_per_elem\": %.3f, \"valid\": %s",
+				first ? "" : ",", result->algorithm, result->distribution, result->n,
+				result->repetitions, result->median, result->p95, result->min, result->mean,
+				ns_per_elem, result->valid ? "true" : "false");
+
+		if (result->speedup > 0.0)
+			fprintf(out, ", \"speedup\": %.3f", result->speedup);
+		else
+			fprintf(out, ", \"speedup\": null");
+
+		for (size_t c = 0; c < PERF_COUNTERS_COUNT; ++c)
+		{
+			double value = bench_counter(result, c);
+			fprintf(out, ", \"%s_per_elem\": ", perf_counters_name(c));
+
+			if (value < 0.0)
+				fprintf(out, "null");
+			else
+				fprintf(out, "%.4f", value);
+		}
+
+		fprintf(out, " }");
+	}
+	else
+	{
+		fprintf(out, "[+] %-22s %-11s %10zu elements: median %.8f s | p95 %.8f s | %.2f ns/elem",
+				result->algorithm, result->distribution, result->n, result->median, result->p95,
+				ns_per_elem);
+
+		if (result->speedup > 0.0)
+			fprintf(out, " | speedup %.2fx", result->speedup);
+
+		for (size_t c = 0; c < PERF_COUNTERS_COUNT; ++c)
+		{
+			double value = bench_counter(result, c);
+			if (value >= 0.0)
+				fprintf(out, " | %.3f %s", value, perf_counters_name(c));
+		}
+
+		fprintf(out, "%s\n", result->valid ? "" : " | FAILED");
+	}
+
+	fflush(out);
 }
 
-void random_fill(int* begin, int* end, int m)
+// fills input and the verified reference of one (distribution, size) case
+static bool bench_prepare(const bench_distribution* distribution, bench_data* data,
+						  int* input, int* reference, uint64_t seed)
 {
-	srand((unsigned)time(NULL));
-	for (int* iter = begin; iter != end; ++iter)
-		*iter = rand() % m;
+	uint64_t state = seed ? seed : BENCH_DEFAULT_SEED;
+	distribution->generate(input, data->n, &state);
+
+	if (data->n)
+		memcpy(reference, input, data->n * sizeof(int));
+
+	// radix and intro sort must agree on the reference, so a bug in either
+	// shows up instead of silently becoming the expected output
+	if (!radix_sort_i32(reference, reference + data->n, RADIX_SORT_DIGIT_BITS_8))
+		return false;
+
+	memcpy(data->work, input, data->n * sizeof(int));
+	intro_sort(data->work, data->work + data->n, sizeof(int), greater_than_i32);
+
+	for (size_t i = 0; i < data->n; ++i)
+		if (data->work[i] != reference[data->n - 1 - i])
+			return false;
+
+	return true;
 }
 
-void sort_data(int* begin, int* end)
+int main(int argc, char** argv)
 {
-	size_t n = (size_t)(end - begin);
-	int* tmp = begin;
-	int* dup = (int *) memdup(begin, n * sizeof(int));
+	bench_options options;
+
+	if (!parse_args(argc, argv, &options))
+		return EXIT_FAILURE;
+
+	FILE* out = options.output ? fopen(options.output, "w") : stdout;
+	if (!out)
+		return EXIT_FAILURE;
+
+	double* times = (double *) malloc(options.repetitions * sizeof(double));
+	perf_counters* counters = perf_counters_create();
+	size_t max_threads = parallel_sort_hardware_threads();
+	bool success = times && counters;
+	bool first = true;
+
+	if (success && !perf_counters_any(counters) && !strcmp(options.format, "text"))
+		fprintf(out, "[+] hardware counters unavailable, timing only\n");
+
+	if (!strcmp(options.format, "csv"))
+	{
+		fprintf(out, "algorithm,distribution,size,repetitions,median_s,p95_s,min_s,mean_s,ns_per_elem,valid,speedup");
+
+		for (size_t c = 0; c < PERF_COUNTERS_COUNT; ++c)
+			fprintf(out, ",%s_per_elem", perf_counters_name(c));
+
+		fprintf(out, "\n");
+	}
+	else if (!strcmp(options.format, "json"))
+		fprintf(out, "{\n\t\"seed\": %llu,\n\t\"results\": [", (unsigned long long) options.seed);
+
+	for (size_t s = 0; success && s < options.nsizes; ++s)
+	{
+		size_t n = options.sizes[s];
+		size_t alloc = n ? n : 1u;
+
+		int* input = create_vector(alloc, sizeof(int), false);
+		int* reference = create_vector(alloc, sizeof(int), false);
+		int* work = create_vector(alloc < SELECTION_K ? SELECTION_K : alloc, sizeof(int), false);
+
+		success = input && reference && work;
+
+		for (size_t d = 0; success && d < ArrayCount(bench_distributions); ++d)
+		{
+			const bench_distribution* distribution = &bench_distributions[d];
+			if (!bench_selected(options.distributions, distribution->name))
+				continue;
+
+			bench_data data = { .input = input, .reference = reference, .work = work, .n = n };
+			success = bench_prepare(distribution, &data, input, reference, options.seed);
+
+			// median of parallel_sort_t1, the rows after it compare to it
+			double single_thread = 0.0;
+
+			for (size_t a = 0; success && a < ArrayCount(bench_algorithms); ++a)
+			{
+				const bench_algorithm* algorithm = &bench_algorithms[a];
+
+				if (!bench_selected(options.algorithms, algorithm->name) ||
+					(algorithm->max_size && n > algorithm->max_size) ||
+					algorithm->nthreads > max_threads)
+				{
+					continue;
+				}
+
+				bench_result result =
+				{
+					.algorithm = algorithm->name,
+					.distribution = distribution->name,
+					.n = n,
+					.repetitions = options.repetitions
+				};
+
+				data.nthreads = algorithm->nthreads;
+				success = bench_case(algorithm, &data, &options, counters, times, &result);
+
+				if (success && algorithm->nthreads == 1u)
+					single_thread = result.median;
+
+				if (success && algorithm->nthreads && single_thread > 0.0 && result.median > 0.0)
+					result.speedup = single_thread / result.median;
+
+				bench_report(out, options.format, &result, first);
+				first = false;
+			}
 
-	time_t t1 = clock();
-	heap_sort(begin, end, sizeof(int), greater_than_i32);
-	time_t t2 = clock();
+			free(data.records);
+		}
 
-	free(tmp);
-	double heap_time = (double)(t2 - t1) / CLOCKS_PER_SEC;
-	printf("[+] Heap-Sort time for %zu elements: %.8f seconds\n", n, heap_time);
+		free(input);
+		free(reference);
+		free(work);
+	}
 
-	t1 = clock();
-	insertion_sort(dup, dup + n, sizeof(int), less_than_i32);
-	t2 = clock();
+	if (!strcmp(options.format, "json"))
+		fprintf(out, "\n\t]\n}\n");
+	else if (!strcmp(options.format, "text"))
+		fprintf(out, success ? "[+] Finished\n" : "FAILURE !\n");
 
-	double isort_time = (double)(t2 - t1) / CLOCKS_PER_SEC;
-	free(dup);
+	if (out != stdout)
+		fclose(out);
 
-	printf("[+] Insertion-Sort time for %zu elements: %.8f seconds\n",n, isort_time);
-	printf("[+] Finished\n");
+	perf_counters_release(&counters);
+	free(times);
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
 }
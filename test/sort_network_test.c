@@ -0,0 +1,161 @@
+#include <stdio.h>
+
+#include "../include/utils.h"
+#include "../include/sort_network.h"
+
+#define TEST_ROUNDS (2000u)
+
+static bool record_less(const void* first, const void* second, size_t size)
+{
+	// 24-byte records keyed by their first int
+	(void) size;
+	return *(const int32_t *)first < *(const int32_t *)second;
+}
+
+static uint64_t next_random(uint64_t* state)
+{
+	// xorshift64, good enough to build test vectors
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+// every 0/1 input of every size: a network sorting all of them sorts anything
+static bool test_zero_one(void)
+{
+	for (size_t n = 0; n <= SORT_NETWORK_MAX_SIZE; ++n)
+	{
+		for (uint32_t bits = 0; bits < (1u << n); ++bits)
+		{
+			int32_t v[SORT_NETWORK_MAX_SIZE];
+			for (size_t i = 0; i < n; ++i)
+				v[i] = (int32_t)((bits >> i) & 1u);
+
+			sort_network_i32(v, n);
+
+			if (!is_sorted(v, v + n, sizeof(int32_t), less_than_i32))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+static bool test_typed(uint64_t* state)
+{
+	for (size_t round = 0; round < TEST_ROUNDS; ++round)
+	{
+		size_t n = round % (SORT_NETWORK_MAX_SIZE + 1u);
+
+		int32_t i32[SORT_NETWORK_MAX_SIZE];
+		int64_t i64[SORT_NETWORK_MAX_SIZE];
+		float f32[SORT_NETWORK_MAX_SIZE];
+		double f64[SORT_NETWORK_MAX_SIZE];
+		int32_t expected[SORT_NETWORK_MAX_SIZE];
+
+		for (size_t i = 0; i < n; ++i)
+		{
+			// small range, plenty of duplicates and both signs
+			int32_t value = (int32_t)(next_random(state) % 11u) - 5;
+			i32[i] = expected[i] = value;
+			i64[i] = (int64_t) value * INT64_C(1000000000000);
+			f32[i] = (float) value / 4.0f;
+			f64[i] = (double) value / 4.0;
+		}
+
+		sort_network_i32(i32, n);
+		sort_network_i64(i64, n);
+		sort_network_f32(f32, n);
+		sort_network_f64(f64, n);
+		if (n)
+			insertion_sort(expected, expected + n, sizeof(int32_t), less_than_i32);
+
+		for (size_t i = 0; i < n; ++i)
+		{
+			if (i32[i] != expected[i] ||
+				i64[i] != (int64_t) expected[i] * INT64_C(1000000000000) ||
+				f32[i] != (float) expected[i] / 4.0f ||
+				f64[i] != (double) expected[i] / 4.0)
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+static bool test_generic(uint64_t* state)
+{
+	int32_t records[SORT_NETWORK_MAX_SIZE][6];
+
+	for (size_t round = 0; round < TEST_ROUNDS; ++round)
+	{
+		size_t n = round % (SORT_NETWORK_MAX_SIZE + 1u);
+
+		for (size_t i = 0; i < n; ++i)
+		{
+			records[i][0] = (int32_t)(next_random(state) % 100u);
+			for (size_t j = 1; j < 6u; ++j)
+				records[i][j] = records[i][0] * (int32_t) j;
+		}
+
+		if (!sort_network(records, n, sizeof(records[0]), record_less) ||
+			!is_sorted(records, records + n, sizeof(records[0]), record_less))
+		{
+			return false;
+		}
+
+		// payloads travel with their keys
+		for (size_t i = 0; i < n; ++i)
+			if (records[i][5] != records[i][0] * 5)
+				return false;
+	}
+
+	return !sort_network(records, SORT_NETWORK_MAX_SIZE + 1u, sizeof(records[0]), record_less);
+}
+
+// intro_sort_i32 partitions down to network-sized leaves, same order as
+// the comparator version
+static bool test_intro_sort_i32(uint64_t* state)
+{
+	size_t n = 100000u;
+	int32_t* values = create_vector(n, sizeof(int32_t), false);
+	int32_t* expected = create_vector(n, sizeof(int32_t), false);
+	bool ret = values && expected;
+
+	for (size_t i = 0; ret && i < n; ++i)
+		values[i] = expected[i] = (int32_t)(next_random(state) % 1000u) - 500;
+
+	if (ret)
+	{
+		intro_sort_i32(values, values + n);
+		intro_sort(expected, expected + n, sizeof(int32_t), less_than_i32);
+		ret = !memcmp(values, expected, n * sizeof(int32_t)) &&
+			  is_sorted(values, values + n, sizeof(int32_t), less_than_i32);
+	}
+
+	free(values);
+	free(expected);
+	return ret;
+}
+
+int main(int argc, char** argv)
+{
+	uint64_t state = 0x9E3779B97F4A7C15ULL;
+
+	bool success = test_zero_one();
+	printf("[+] 0/1 inputs: %s\n", success ? "OK" : "FAILED");
+
+	success = success && test_typed(&state);
+	printf("[+] typed kernels: %s\n", success ? "OK" : "FAILED");
+
+	success = success && test_generic(&state);
+	printf("[+] generic network: %s\n", success ? "OK" : "FAILED");
+
+	success = success && test_intro_sort_i32(&state);
+	printf("[+] intro_sort_i32: %s\n", success ? "OK" : "FAILED");
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <math.h>
+
+#include "../include/utils.h"
+#include "../include/workload.h"
+
+#define TEST_PRELOAD (1000u)
+#define TEST_OPS (4000u)
+
+static bool test_shapes(void)
+{
+	uint64_t keys[64];
+
+	workload_keys sequential = { .shape = WORKLOAD_KEYS_SEQUENTIAL, .base = 10u };
+	workload_keys strided = { .shape = WORKLOAD_KEYS_STRIDED, .stride = 3u, .range = 100u };
+	workload_keys uniform = { .shape = WORKLOAD_KEYS_UNIFORM, .base = 5u, .range = 7u };
+
+	bool ret = workload_generate_keys(keys, ArrayCount(keys), &sequential, 1u);
+	for (size_t i = 0; ret && i < ArrayCount(keys); ++i)
+		ret = keys[i] == 10u + i;
+
+	ret = ret && workload_generate_keys(keys, ArrayCount(keys), &strided, 1u);
+	for (size_t i = 0; ret && i < ArrayCount(keys); ++i)
+		ret = keys[i] == (3u * i) % 100u;
+
+	ret = ret && workload_generate_keys(keys, ArrayCount(keys), &uniform, 1u);
+	for (size_t i = 0; ret && i < ArrayCount(keys); ++i)
+		ret = keys[i] >= 5u && keys[i] < 12u;
+
+	// zipf: the hottest key takes far more than a uniform share
+	workload_keys zipf = { .shape = WORKLOAD_KEYS_ZIPF, .range = 1000000u, .zipf_exponent = 1.0 };
+	uint64_t* many = create_vector(10000u, sizeof(uint64_t), false);
+	ret = ret && many && workload_generate_keys(many, 10000u, &zipf, 3u);
+
+	size_t hottest = 0u;
+	for (size_t i = 0; ret && i < 10000u; ++i)
+		hottest += many[i] == 0u; // rank 0 scatters to key 0
+
+	free(many);
+	return ret && hottest > 100u;
+}
+
+// replays the trace against a plain array of live keys
+static bool test_trace(uint8_t shape, uint8_t access)
+{
+	workload_keys keys = { .shape = shape, .range = 1000000u };
+	workload_mix mix =
+	{
+		.preload = TEST_PRELOAD,
+		.nops = TEST_OPS,
+		.get_ratio = 0.5,
+		.insert_ratio = 0.3,
+		.hit_rate = 0.8,
+		.access = access
+	};
+
+	workload_trace trace, again = { 0 };
+	if (!workload_trace_create(&trace, &keys, &mix, 11u))
+		return false;
+
+	bool ret = workload_trace_create(&again, &keys, &mix, 11u) &&
+			   !memcmp(trace.preload, again.preload, TEST_PRELOAD * sizeof(uint64_t));
+
+	for (size_t i = 0; ret && i < TEST_OPS; ++i)
+		ret = trace.ops[i].key == again.ops[i].key && trace.ops[i].type == again.ops[i].type;
+
+	workload_trace_release(&again);
+
+	uint64_t* live = create_vector(TEST_PRELOAD + TEST_OPS, sizeof(uint64_t), false);
+	size_t nlive = 0u, counts[3] = { 0 }, hits = 0u, lookups = 0u;
+
+	for (size_t i = 0; ret && live && i < TEST_PRELOAD; ++i)
+	{
+		for (size_t j = 0; ret && j < nlive; ++j)
+			ret = live[j] != trace.preload[i];
+
+		live[nlive++] = trace.preload[i];
+	}
+
+	for (size_t i = 0; ret && live && i < TEST_OPS; ++i)
+	{
+		const workload_op* op = &trace.ops[i];
+		size_t found = nlive;
+
+		for (size_t j = 0; j < nlive; ++j)
+			if (live[j] == op->key)
+				found = j;
+
+		// inserts always bring a new key
+		bool expected = op->type != WORKLOAD_OP_INSERT && op->hit;
+		ret = (found < nlive) == expected && op->key <= WORKLOAD_KEY_MASK;
+		++counts[op->type];
+
+		if (op->type == WORKLOAD_OP_INSERT)
+			live[nlive++] = op->key;
+		else
+		{
+			hits += op->hit;
+			++lookups;
+		}
+
+		if (op->type == WORKLOAD_OP_REMOVE && op->hit)
+			live[found] = live[--nlive];
+	}
+
+	// the mix is honoured within a few percent
+	ret = ret && live &&
+		  fabs(counts[WORKLOAD_OP_GET] / (double) TEST_OPS - 0.5) < 0.05 &&
+		  fabs(counts[WORKLOAD_OP_INSERT] / (double) TEST_OPS - 0.3) < 0.05 &&
+		  fabs(hits / (double) lookups - 0.8) < 0.05;
+
+	free(live);
+	workload_trace_release(&trace);
+	return ret;
+}
+
+int main(int argc, char** argv)
+{
+	bool success = test_shapes();
+	printf("[+] key shapes: %s\n", success ? "OK" : "FAILED");
+
+	for (uint8_t shape = 0; success && shape < WORKLOAD_KEYS_COUNT; ++shape)
+	{
+		if (shape == WORKLOAD_KEYS_ZIPF)
+		{
+			workload_trace trace;
+			workload_keys keys = { .shape = shape };
+			workload_mix mix = { .nops = 1u, .get_ratio = 1.0 };
+
+			success = !workload_trace_create(&trace, &keys, &mix, 1u);
+			printf("[+] zipf keys rejected for traces: %s\n", success ? "OK" : "FAILED");
+			continue;
+		}
+
+		success = test_trace(shape, WORKLOAD_ACCESS_UNIFORM) && test_trace(shape, WORKLOAD_ACCESS_ZIPF);
+		printf("[+] %s trace: %s\n", workload_keys_name(shape), success ? "OK" : "FAILED");
+	}
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}